@@ -10,33 +10,29 @@ type t =
   | String of string
 [@@deriving sexp]
 
-let col_readers table =
-  let schema = A.Table.schema table in
+(* Resolved once per schema, then applied to each batch. *)
+let col_readers (schema : A.Schema.t) =
   List.mapi schema.children ~f:(fun col_idx { name; format; _ } ->
+      let column = `Index col_idx in
       match format with
       | Int64 ->
-        (match A.Column.fast_read table col_idx with
-        | Int64 arr -> fun i -> Int (Int64.to_int_exn arr.{i})
-        | Int64_option (ba, valid) ->
-          let valid = A.Valid.of_bigarray valid ~length:(Bigarray.Array1.dim ba) in
+        let accessor = A.Column.prepare schema column I64_ba_opt in
+        fun table ->
+          let ba, valid = A.Column.read accessor table in
           fun i -> if A.Valid.get valid i then Int (Int64.to_int_exn ba.{i}) else Null
-        | _ -> assert false)
       | Float64 ->
-        (match A.Column.fast_read table col_idx with
-        | Double arr -> fun i -> Float arr.{i}
-        | Double_option (ba, valid) ->
-          let valid = A.Valid.of_bigarray valid ~length:(Bigarray.Array1.dim ba) in
+        let accessor = A.Column.prepare schema column F64_ba_opt in
+        fun table ->
+          let ba, valid = A.Column.read accessor table in
           fun i -> if A.Valid.get valid i then Float ba.{i} else Null
-        | _ -> assert false)
       | Utf8_string ->
-        (match A.Column.fast_read table col_idx with
-        | String arr -> fun i -> String arr.(i)
-        | String_option arr ->
+        let accessor = A.Column.prepare schema column Utf8_opt in
+        fun table ->
+          let arr = A.Column.read accessor table in
           fun i ->
             (match arr.(i) with
             | None -> Null
             | Some str -> String str)
-        | _ -> assert false)
       | dt -> raise_s [%message "unsupported column type" name (dt : A.Datatype.t)])
 
 let () =
@@ -46,9 +42,20 @@ let () =
     | _ -> Printf.failwithf "usage: %s file.parquet" Caml.Sys.argv.(0) ()
   in
   let prev_time = ref (Time_ns.now ()) in
+  let prepared = ref None in
   A.Parquet_reader.iter_batches filename ~batch_size:8192 ~f:(fun table ->
       let num_rows = A.Table.num_rows table in
-      let col_readers = col_readers table in
+      let fingerprint = A.Table.schema_fingerprint table in
+      let col_readers =
+        match !prepared with
+        | Some (prepared_fingerprint, col_readers) when prepared_fingerprint = fingerprint
+          -> col_readers
+        | _ ->
+          let col_readers = col_readers (A.Table.schema table) in
+          prepared := Some (fingerprint, col_readers);
+          col_readers
+      in
+      let col_readers = List.map col_readers ~f:(fun col_reader -> col_reader table) in
       for row_idx = 0 to num_rows - 1 do
         let values = List.map col_readers ~f:(fun col_reader -> col_reader row_idx) in
         if debug then print_s ([%sexp_of: t list] values)
@@ -0,0 +1,120 @@
+open Core_kernel
+module W = Arrow_c_api.Wrapper
+module C = Ffi_bindings.C (Ffi_bench_generated)
+
+let time f =
+  let start = Time_ns.now () in
+  let result = f () in
+  Time_ns.diff (Time_ns.now ()) start, result
+
+let median spans =
+  let sorted = List.sort spans ~compare:Time_ns.Span.compare in
+  List.nth_exn sorted (List.length sorted / 2)
+
+(* Compares the ctypes stubs with the direct externals on the per row entry points,
+   the results are reported per call. *)
+let () =
+  let calls, runs =
+    match Caml.Sys.argv with
+    | [| _exe |] -> 10_000_000, 5
+    | [| _exe; calls |] -> Int.of_string calls, 5
+    | [| _exe; calls; runs |] -> Int.of_string calls, Int.of_string runs
+    | _ -> Printf.failwithf "usage: %s [calls] [runs]" Caml.Sys.argv.(0) ()
+  in
+  let table = W.Writer.create_table ~cols:[ W.Writer.int [| 1; 2; 3 |] ~name:"x" ] in
+  (* The ctypes side works on its own table, built through the ctypes stubs. *)
+  let ctypes_table =
+    let builder = C.Int64Builder.create () in
+    List.iter [ 1L; 2L; 3L ] ~f:(C.Int64Builder.append builder);
+    let name = Ctypes.CArray.of_string "x" in
+    let table =
+      C.make_table
+        Ctypes.(CArray.of_list (ptr void) [ builder ] |> CArray.start)
+        Ctypes.(CArray.of_list (ptr char) [ CArray.start name ] |> CArray.start)
+        1
+    in
+    C.Int64Builder.free builder;
+    table
+  in
+  let sum = ref 0 in
+  let bench name ~ctypes ~direct =
+    let per_call f =
+      let span = List.init runs ~f:(fun _ -> fst (time f)) |> median in
+      Time_ns.Span.to_ns span /. Float.of_int calls
+    in
+    let ctypes = per_call ctypes in
+    let direct = per_call direct in
+    Stdio.printf
+      "%-22s ctypes %6.1fns direct %6.1fns saving %6.1fns/call\n%!"
+      name
+      ctypes
+      direct
+      (ctypes -. direct)
+  in
+  bench
+    "table_num_rows"
+    ~ctypes:(fun () ->
+      for _ = 1 to calls do
+        sum := !sum + Int64.to_int_exn (C.Table.num_rows ctypes_table)
+      done)
+    ~direct:(fun () ->
+      for _ = 1 to calls do
+        sum := !sum + W.Table.num_rows table
+      done);
+  (* Each run appends to a fresh builder so that both sides grow the same buffers. *)
+  bench
+    "double_builder_append"
+    ~ctypes:(fun () ->
+      let builder = C.DoubleBuilder.create () in
+      for i = 1 to calls do
+        C.DoubleBuilder.append builder (Float.of_int i)
+      done;
+      C.DoubleBuilder.free builder)
+    ~direct:(fun () ->
+      let builder = W.DoubleBuilder.create () in
+      for i = 1 to calls do
+        W.DoubleBuilder.append builder (Float.of_int i)
+      done);
+  bench
+    "int64_builder_append"
+    ~ctypes:(fun () ->
+      let builder = C.Int64Builder.create () in
+      for i = 1 to calls do
+        C.Int64Builder.append builder (Int64.of_int i)
+      done;
+      C.Int64Builder.free builder)
+    ~direct:(fun () ->
+      let builder = W.Int64Builder.create () in
+      for i = 1 to calls do
+        W.Int64Builder.append builder (Int64.of_int i)
+      done);
+  bench
+    "string_builder_append"
+    ~ctypes:(fun () ->
+      let builder = C.StringBuilder.create () in
+      for _ = 1 to calls do
+        C.StringBuilder.append builder "foobar"
+      done;
+      C.StringBuilder.free builder)
+    ~direct:(fun () ->
+      let builder = W.StringBuilder.create () in
+      for _ = 1 to calls do
+        W.StringBuilder.append builder "foobar"
+      done);
+  let builder = W.Int64Builder.create () in
+  W.Int64Builder.append builder 42L;
+  let ctypes_builder = C.Int64Builder.create () in
+  C.Int64Builder.append ctypes_builder 42L;
+  bench
+    "int64_builder_length"
+    ~ctypes:(fun () ->
+      for _ = 1 to calls do
+        sum := !sum + Int64.to_int_exn (C.Int64Builder.length ctypes_builder)
+      done)
+    ~direct:(fun () ->
+      for _ = 1 to calls do
+        sum := !sum + Int64.to_int_exn (W.Int64Builder.length builder)
+      done);
+  C.Int64Builder.free ctypes_builder;
+  C.Table.free ctypes_table;
+  Stdio.printf "checksum %d\n" !sum
@@ -0,0 +1,46 @@
+open! Ctypes
+
+(* The ctypes stubs replaced by direct externals in [Wrapper], only bound here
+   to measure the difference in [ffi_bench]. *)
+module C (F : Cstubs.FOREIGN) = struct
+  open! F
+
+  module Table = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let num_rows = foreign "table_num_rows" (t @-> returning int64_t)
+    let free = foreign "free_table" (t @-> returning void)
+  end
+
+  module DoubleBuilder = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let create = foreign "create_double_builder" (void @-> returning t)
+    let append = foreign "append_double_builder" (t @-> float @-> returning void)
+    let free = foreign "free_double_builder" (t @-> returning void)
+  end
+
+  module Int64Builder = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let create = foreign "create_int64_builder" (void @-> returning t)
+    let append = foreign "append_int64_builder" (t @-> int64_t @-> returning void)
+    let free = foreign "free_int64_builder" (t @-> returning void)
+    let length = foreign "length_int64_builder" (t @-> returning int64_t)
+  end
+
+  module StringBuilder = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let create = foreign "create_string_builder" (void @-> returning t)
+    let append = foreign "append_string_builder" (t @-> string @-> returning void)
+    let free = foreign "free_string_builder" (t @-> returning void)
+  end
+
+  let make_table =
+    foreign "make_table" (ptr (ptr void) @-> ptr (ptr char) @-> int @-> returning Table.t)
+end
@@ -0,0 +1,27 @@
+(* The stubs only need the C prototypes, declared here rather than including
+   arrow_c_api.h so that they build without the arrow headers. *)
+let prototypes =
+  [ "int64_t table_num_rows(void*);"
+  ; "void free_table(void*);"
+  ; "void *create_double_builder(void);"
+  ; "void append_double_builder(void*, double);"
+  ; "void free_double_builder(void*);"
+  ; "void *create_int64_builder(void);"
+  ; "void append_int64_builder(void*, int64_t);"
+  ; "void free_int64_builder(void*);"
+  ; "int64_t length_int64_builder(void*);"
+  ; "void *create_string_builder(void);"
+  ; "void append_string_builder(void*, char*);"
+  ; "void free_string_builder(void*);"
+  ; "void *make_table(void**, char**, int);"
+  ]
+
+let () =
+  let fmt file = Format.formatter_of_out_channel (open_out file) in
+  let fmt_c = fmt "ffi_bench_stubs.c" in
+  let fmt_ml = fmt "ffi_bench_generated.ml" in
+  Format.fprintf fmt_c "#include <stdint.h>@.";
+  List.iter (Format.fprintf fmt_c "%s@.") prototypes;
+  Cstubs.write_c fmt_c ~prefix:"ffi_bench_" (module Bindings.C);
+  Cstubs.write_ml fmt_ml ~prefix:"ffi_bench_" (module Bindings.C);
+  flush_all ()
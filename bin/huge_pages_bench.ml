@@ -0,0 +1,47 @@
+open Core_kernel
+module A = Arrow_c_api
+
+let time f =
+  let start = Time_ns.now () in
+  let result = f () in
+  Time_ns.diff (Time_ns.now ()) start, result
+
+let median spans =
+  let sorted = List.sort spans ~compare:Time_ns.Span.compare in
+  List.nth_exn sorted (List.length sorted / 2)
+
+let run filename ~runs =
+  let read_spans, scan_spans =
+    List.init runs ~f:(fun _ ->
+        let read_span, table = time (fun () -> A.File_reader.table filename) in
+        let num_cols = List.length (A.Table.schema table).children in
+        let scan_span, () =
+          time (fun () ->
+              for col_idx = 0 to num_cols - 1 do
+                ignore (A.Column.fast_read table col_idx : A.Column.t)
+              done)
+        in
+        read_span, scan_span)
+    |> List.unzip
+  in
+  median read_spans, median scan_spans
+
+let () =
+  let filename, runs =
+    match Caml.Sys.argv with
+    | [| _exe; filename |] -> filename, 5
+    | [| _exe; filename; runs |] -> filename, Int.of_string runs
+    | _ -> Printf.failwithf "usage: %s file.parquet [runs]" Caml.Sys.argv.(0) ()
+  in
+  List.iter
+    [ "4KiB pages", 0; "huge pages", 2 * 1024 * 1024 ]
+    ~f:(fun (name, threshold) ->
+      A.Memory.set_huge_page_threshold threshold;
+      let read, fast_read = run filename ~runs in
+      Stdio.printf
+        "%-10s read %s fast_read %s max memory %dMB\n%!"
+        name
+        (Time_ns.Span.to_string_hum read)
+        (Time_ns.Span.to_string_hum fast_read)
+        (A.Memory.max_memory () / 1024 / 1024);
+      Gc.full_major ())
@@ -0,0 +1,37 @@
+open Core_kernel
+module A = Arrow_c_api
+
+let backends = [ "pread", `Pread; "mmap", `Mmap; "uring", `Uring; "direct", `Direct ]
+
+let read_table filename ~io =
+  match String.rsplit2 filename ~on:'.' with
+  | Some (_, "feather") -> A.Feather_reader.table ~io filename
+  | Some (_, "parquet") -> A.Parquet_reader.table ~io filename
+  | _ -> Printf.failwithf "unsupported file %s" filename ()
+
+let () =
+  let filename, runs =
+    match Caml.Sys.argv with
+    | [| _exe; filename |] -> filename, 5
+    | [| _exe; filename; runs |] -> filename, Int.of_string runs
+    | _ -> Printf.failwithf "usage: %s file.parquet [runs]" Caml.Sys.argv.(0) ()
+  in
+  if not (A.Io.uring_available ())
+  then Stdio.printf "io_uring is not available, uring falls back to pread\n%!";
+  List.iter backends ~f:(fun (name, io) ->
+      let spans =
+        List.init runs ~f:(fun _ ->
+            let start = Time_ns.now () in
+            let table = read_table filename ~io in
+            let span = Time_ns.diff (Time_ns.now ()) start in
+            ignore (A.Table.num_rows table : int);
+            span)
+      in
+      let sorted = List.sort spans ~compare:Time_ns.Span.compare in
+      let median = List.nth_exn sorted (runs / 2) in
+      let best = List.hd_exn sorted in
+      Stdio.printf
+        "%-6s best %s median %s\n%!"
+        name
+        (Time_ns.Span.to_string_hum best)
+        (Time_ns.Span.to_string_hum median))
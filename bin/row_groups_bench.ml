@@ -0,0 +1,53 @@
+open Core_kernel
+module A = Arrow_c_api
+
+let time f =
+  let start = Time_ns.now () in
+  let result = f () in
+  Time_ns.diff (Time_ns.now ()) start, result
+
+let median spans =
+  let sorted = List.sort spans ~compare:Time_ns.Span.compare in
+  List.nth_exn sorted (List.length sorted / 2)
+
+(* A tall and narrow file: three columns and many row groups. *)
+let write_tall_file filename ~num_rows =
+  let table =
+    A.Table.create
+      [ A.Table.col (Array.init num_rows ~f:Fn.id) Int ~name:"id"
+      ; A.Table.col
+          (Array.init num_rows ~f:(fun i -> Float.of_int i *. 0.5))
+          Float
+          ~name:"px"
+      ; A.Table.col (Array.init num_rows ~f:(fun i -> i % 1_000)) Int ~name:"qty"
+      ]
+  in
+  A.Table.write_parquet table filename ~chunk_size:(1024 * 1024)
+
+let () =
+  let filename, runs =
+    match Caml.Sys.argv with
+    | [| _exe; filename |] -> filename, 5
+    | [| _exe; filename; runs |] -> filename, Int.of_string runs
+    | [| _exe; "--generate"; filename; num_rows |] ->
+      write_tall_file filename ~num_rows:(Int.of_string num_rows);
+      filename, 5
+    | _ ->
+      Printf.failwithf
+        "usage: %s file.parquet [runs] | --generate file.parquet num_rows"
+        Caml.Sys.argv.(0)
+        ()
+  in
+  List.iter
+    [ "columns", `Columns; "row groups", `Row_groups; "both", `Both ]
+    ~f:(fun (name, parallelism) ->
+      let spans =
+        List.init runs ~f:(fun _ ->
+            let span, table =
+              time (fun () -> A.Parquet_reader.table filename ~use_threads:true ~parallelism)
+            in
+            ignore (A.Table.num_rows table : int);
+            Gc.full_major ();
+            span)
+      in
+      Stdio.printf "%-10s %s\n%!" name (Time_ns.Span.to_string_hum (median spans)))
@@ -0,0 +1,78 @@
+open Core_kernel
+module V = Arrow_c_api.Valid
+
+let time f =
+  let start = Time_ns.now () in
+  let result = f () in
+  Time_ns.diff (Time_ns.now ()) start, result
+
+let median spans =
+  let sorted = List.sort spans ~compare:Time_ns.Span.compare in
+  List.nth_exn sorted (List.length sorted / 2)
+
+(* Reference implementations using the bit by bit accessors. *)
+let loop_and t1 t2 =
+  let res = V.create_all_valid (V.length t1) in
+  for i = 0 to V.length t1 - 1 do
+    V.set res i (V.get t1 i && V.get t2 i)
+  done;
+  res
+
+let loop_not t =
+  let res = V.create_all_valid (V.length t) in
+  for i = 0 to V.length t - 1 do
+    V.set res i (not (V.get t i))
+  done;
+  res
+
+let loop_num_true t =
+  let res = ref 0 in
+  for i = 0 to V.length t - 1 do
+    if V.get t i then incr res
+  done;
+  !res
+
+let loop_iter_set_bits t ~f =
+  for i = 0 to V.length t - 1 do
+    if V.get t i then f i
+  done
+
+let () =
+  let length, runs =
+    match Caml.Sys.argv with
+    | [| _exe |] -> 10_000_000, 5
+    | [| _exe; length |] -> Int.of_string length, 5
+    | [| _exe; length; runs |] -> Int.of_string length, Int.of_string runs
+    | _ -> Printf.failwithf "usage: %s [length] [runs]" Caml.Sys.argv.(0) ()
+  in
+  let t1 = V.of_bool_array (Array.init length ~f:(fun i -> i % 3 = 0)) in
+  let t2 = V.of_bool_array (Array.init length ~f:(fun i -> i % 7 <> 0)) in
+  let sum = ref 0 in
+  let bench name ~loop ~native =
+    let spans f = List.init runs ~f:(fun _ -> fst (time f)) |> median in
+    let loop = spans loop in
+    let native = spans native in
+    Stdio.printf
+      "%-14s loop %s native %s speedup %.1fx\n%!"
+      name
+      (Time_ns.Span.to_string_hum loop)
+      (Time_ns.Span.to_string_hum native)
+      (Time_ns.Span.( // ) loop native)
+  in
+  bench
+    "and"
+    ~loop:(fun () -> ignore (loop_and t1 t2 : V.t))
+    ~native:(fun () -> ignore (V.and_ t1 t2 : V.t));
+  bench
+    "not"
+    ~loop:(fun () -> ignore (loop_not t1 : V.t))
+    ~native:(fun () -> ignore (V.not t1 : V.t));
+  bench
+    "num_true"
+    ~loop:(fun () -> ignore (loop_num_true t1 : int))
+    ~native:(fun () -> ignore (V.num_true t1 : int));
+  bench
+    "iter_set_bits"
+    ~loop:(fun () -> loop_iter_set_bits t1 ~f:(fun i -> sum := !sum + i))
+    ~native:(fun () -> V.iter_set_bits t1 ~f:(fun i -> sum := !sum + i));
+  Stdio.printf "checksum %d\n" !sum
@@ -39,9 +39,24 @@ let boolable =
     Ast_pattern.(pstr nil)
     (fun x -> x)
 
+let enum =
+  Attribute.declare
+    "arrow.enum"
+    Attribute.Context.label_declaration
+    Ast_pattern.(pstr nil)
+    (fun x -> x)
+
+let nested =
+  Attribute.declare
+    "arrow.nested"
+    Attribute.Context.label_declaration
+    Ast_pattern.(pstr nil)
+    (fun x -> x)
+
 module Attr = struct
   type t =
-    { kind : [ `intable | `stringable | `sexpable | `floatable | `boolable ]
+    { kind :
+        [ `intable | `stringable | `sexpable | `floatable | `boolable | `enum | `nested ]
     ; is_option : bool
     }
 end
@@ -52,52 +67,51 @@ let attribute field ~loc =
   let stringable = Attribute.get stringable field in
   let sexpable = Attribute.get sexpable field in
   let boolable = Attribute.get boolable field in
+  let enum = Attribute.get enum field in
+  let nested = Attribute.get nested field in
   let is_option =
     match field.pld_type.ptyp_desc with
     | Ptyp_constr ({ txt = Lident "option"; _ }, [ _ ]) -> true
     | _ -> false
   in
-  match intable, floatable, stringable, sexpable, boolable with
-  | Some _, None, None, None, None -> Some { Attr.kind = `intable; is_option }
-  | None, Some _, None, None, None -> Some { Attr.kind = `floatable; is_option }
-  | None, None, Some _, None, None -> Some { Attr.kind = `stringable; is_option }
-  | None, None, None, Some _, None -> Some { Attr.kind = `sexpable; is_option }
-  | None, None, None, None, Some _ -> Some { Attr.kind = `boolable; is_option }
-  | None, None, None, None, None -> None
-  | _ ->
+  let kinds =
+    List.filter_map
+      [ intable, `intable
+      ; floatable, `floatable
+      ; stringable, `stringable
+      ; sexpable, `sexpable
+      ; boolable, `boolable
+      ; enum, `enum
+      ; nested, `nested
+      ]
+      ~f:(fun (attr, kind) -> Option.map attr ~f:(fun _ -> kind))
+  in
+  match kinds with
+  | [ kind ] -> Some { Attr.kind; is_option }
+  | [] -> None
+  | _ :: _ :: _ ->
     raise_errorf
-      "cannot have more than one of intable, floatable, boolable, sexpable, or stringable"
+      "cannot have more than one of intable, floatable, boolable, sexpable, enum, \
+       nested, or stringable"
       ~loc
 
 let lident ~loc str = Loc.make ~loc (Lident str)
 
-let fresh_label =
-  let counter = ref 0 in
-  fun ~loc ->
-    Int.incr counter;
-    let label = Printf.sprintf "_lbl_%d" !counter in
-    ppat_var (Loc.make ~loc label) ~loc, pexp_ident (lident ~loc label) ~loc
-
-let closure_of_fn (fn : expression -> expression) ~loc : expression =
-  let loc = { loc with loc_ghost = true } in
-  let arg_pat, arg_expr = fresh_label ~loc in
-  pexp_fun Nolabel ~loc None arg_pat (fn arg_expr)
-
 let open_runtime expr ~loc =
   [%expr
     let open! Ppx_arrow_runtime in
     [%e expr]]
 
-(* If a field has type [A.B.t] return [A.B.fn_name] as an expr. *)
-let fn_from_field_module field ~fn_name ~loc =
+(* If a field has type [A.B.t] return [A.B.(fn_name "t")] as an expr. *)
+let fn_from_field_type field ~fn_name ~loc =
   let ident =
     match field.pld_type.ptyp_desc with
     | Ptyp_constr
         ({ txt = Lident "option"; _ }, [ { ptyp_desc = Ptyp_constr ({ txt; _ }, []); _ } ])
     | Ptyp_constr ({ loc = _; txt }, []) ->
       (match txt with
-      | Lident _ -> lident ~loc fn_name
-      | Ldot (modl, _) -> Ldot (modl, fn_name) |> Loc.make ~loc
+      | Lident tname -> lident ~loc (fn_name tname)
+      | Ldot (modl, tname) -> Ldot (modl, fn_name tname) |> Loc.make ~loc
       | Lapply _ -> raise_errorf ~loc "'%s' apply not supported" (Longident.name txt))
     | _ ->
       raise_errorf
@@ -108,11 +122,50 @@ let fn_from_field_module field ~fn_name ~loc =
   in
   pexp_ident ident ~loc
 
+(* If a field has type [A.B.t] return [A.B.fn_name] as an expr. *)
+let fn_from_field_module field ~fn_name ~loc =
+  fn_from_field_type field ~fn_name:(fun _tname -> fn_name) ~loc
+
 (* Generated function names. *)
 let arrow_read tname = "arrow_read_" ^ tname
 let arrow_write tname = "arrow_write_" ^ tname
 let arrow_of_table tname = "arrow_" ^ tname ^ "_of_table"
 let arrow_table_of tname = "arrow_table_of_" ^ tname
+let arrow_code_of tname = "arrow_code_of_" ^ tname
+let arrow_of_code tname = "arrow_" ^ tname ^ "_of_code"
+let arrow_columns tname = "arrow_" ^ tname ^ "_columns"
+let arrow_getter tname = "arrow_" ^ tname ^ "_getter"
+let arrow_setter tname = "arrow_" ^ tname ^ "_setter"
+
+(* Variants with only constant constructors are encoded as an int8 column holding the
+   constructor index in declaration order, reordering the constructors hence changes
+   the on-disk encoding. *)
+let max_enum_constructors = 127
+
+let enum_constructors td =
+  match td.ptype_kind with
+  | Ptype_variant cds ->
+    let { Location.loc; txt = tname } = td.ptype_name in
+    if not (List.is_empty td.ptype_params)
+    then raise_errorf "parametered types are not supported" ~loc;
+    List.iter cds ~f:(fun cd ->
+        match cd.pcd_args, cd.pcd_res with
+        | Pcstr_tuple [], None -> ()
+        | _ ->
+          raise_errorf
+            ~loc:cd.pcd_loc
+            "only variants with constant constructors are supported, '%s' has \
+             arguments"
+            cd.pcd_name.txt);
+    if List.length cds > max_enum_constructors
+    then
+      raise_errorf
+        ~loc
+        "'%s' has more than %d constructors"
+        tname
+        max_enum_constructors;
+    Some cds
+  | Ptype_abstract | Ptype_record _ | Ptype_open -> None
 
 module Signature : sig
   val gen
@@ -142,20 +195,48 @@ end = struct
     let write_type = write_type td ~loc in
     let table_of_type = table_of_type td ~loc in
     let of_table_type = of_table_type td ~loc in
-    match kind with
-    | `both ->
+    let columns_type = [%type: prefix:string -> string list] in
+    let getter_type =
+      [%type:
+        Arrow_c_api.Table.t
+        -> prefix:string
+        -> int
+        -> [%t Ppxlib.core_type_of_type_declaration td]]
+    in
+    let setter_type =
+      [%type:
+        int
+        -> prefix:string
+        -> [%t Ppxlib.core_type_of_type_declaration td] Ppx_arrow_runtime.Setter.t]
+    in
+    let code_of_type = [%type: [%t Ppxlib.core_type_of_type_declaration td] -> int] in
+    let of_code_type = [%type: int -> [%t Ppxlib.core_type_of_type_declaration td]] in
+    match kind, enum_constructors td with
+    | `both, Some _ ->
+      [ psig_value ~name:(arrow_code_of tname) ~type_:code_of_type
+      ; psig_value ~name:(arrow_of_code tname) ~type_:of_code_type
+      ]
+    | `read, Some _ -> [ psig_value ~name:(arrow_of_code tname) ~type_:of_code_type ]
+    | `write, Some _ -> [ psig_value ~name:(arrow_code_of tname) ~type_:code_of_type ]
+    | `both, None ->
       [ psig_value ~name:(arrow_read tname) ~type_:read_type
       ; psig_value ~name:(arrow_write tname) ~type_:write_type
       ; psig_value ~name:(arrow_of_table tname) ~type_:of_table_type
       ; psig_value ~name:(arrow_table_of tname) ~type_:table_of_type
+      ; psig_value ~name:(arrow_columns tname) ~type_:columns_type
+      ; psig_value ~name:(arrow_getter tname) ~type_:getter_type
+      ; psig_value ~name:(arrow_setter tname) ~type_:setter_type
       ]
-    | `read ->
+    | `read, None ->
       [ psig_value ~name:(arrow_read tname) ~type_:read_type
       ; psig_value ~name:(arrow_of_table tname) ~type_:of_table_type
+      ; psig_value ~name:(arrow_columns tname) ~type_:columns_type
+      ; psig_value ~name:(arrow_getter tname) ~type_:getter_type
       ]
-    | `write ->
+    | `write, None ->
       [ psig_value ~name:(arrow_write tname) ~type_:write_type
       ; psig_value ~name:(arrow_table_of tname) ~type_:table_of_type
+      ; psig_value ~name:(arrow_setter tname) ~type_:setter_type
       ]
 
   let gen kind =
@@ -168,22 +249,15 @@ module Structure : sig
     :  [ `read | `write | `both ]
     -> (structure, rec_flag * type_declaration list) Deriving.Generator.t
 end = struct
-  let expr_of_tds ~loc ~record tds =
-    let exprs =
-      List.map tds ~f:(fun td ->
-          let { Location.loc; txt = _ } = td.ptype_name in
-          if not (List.is_empty td.ptype_params)
-          then raise_errorf "parametered types are not supported" ~loc;
-          let expr arg_t =
-            match td.ptype_kind with
-            | Ptype_abstract -> raise_errorf ~loc "abstract types not supported"
-            | Ptype_variant _ -> raise_errorf ~loc "variant types not supported"
-            | Ptype_record fields -> record fields ~loc arg_t
-            | Ptype_open -> raise_errorf ~loc "open types not supported"
-          in
-          closure_of_fn expr ~loc)
-    in
-    pexp_tuple ~loc exprs
+  let record_fields td =
+    let { Location.loc; txt = _ } = td.ptype_name in
+    if not (List.is_empty td.ptype_params)
+    then raise_errorf "parametered types are not supported" ~loc;
+    match td.ptype_kind with
+    | Ptype_abstract -> raise_errorf ~loc "abstract types not supported"
+    | Ptype_variant _ -> raise_errorf ~loc "variant types not supported"
+    | Ptype_record fields -> fields
+    | Ptype_open -> raise_errorf ~loc "open types not supported"
 
   let extract_ident ident ~loc =
     let rec loop = function
@@ -204,6 +278,10 @@ end = struct
       | Some { kind = `stringable | `sexpable; is_option = true } -> "String_option_col"
       | Some { kind = `boolable; is_option = false } -> "Bool_col"
       | Some { kind = `boolable; is_option = true } -> "Bool_option_col"
+      | Some { kind = `enum; is_option = false } -> "Enum_col"
+      | Some { kind = `enum; is_option = true } -> "Enum_option_col"
+      | Some { kind = `nested; is_option = _ } ->
+        raise_errorf ~loc "nested field '%s' has no runtime column" field.pld_name.txt
       | None ->
         (match field.pld_type.ptyp_desc with
         | Ptyp_constr ({ loc = _; txt }, []) ->
@@ -224,157 +302,313 @@ end = struct
     in
     pexp_ident (Loc.make (Ldot (Lident modl, fn_name)) ~loc) ~loc
 
-  let read_or_of_table fields ~loc args ~which =
-    let record_fields =
+  (* Nested records are flattened as in [Builder.C.c_flatten], the columns of a field
+     [f] of type [Inner.t] are named [f_<inner column>]. When the field is an option, an
+     additional non-nullable boolean column named [f] marks the rows where the record is
+     present. *)
+  let nested field ~loc =
+    match attribute field ~loc with
+    | Some { kind = `nested; is_option } -> Some is_option
+    | Some _ | None -> None
+
+  let pat str ~loc = ppat_var (Loc.make ~loc str) ~loc
+
+  let column_name field ~loc =
+    [%expr __arrow_prefix ^ [%e estring ~loc field.pld_name.txt]]
+
+  let nested_prefix field ~loc =
+    [%expr __arrow_prefix ^ [%e estring ~loc (field.pld_name.txt ^ "_")]]
+
+  let present_var field = "__arrow_present_" ^ field.pld_name.txt
+
+  let decode field expr ~loc =
+    let apply_fn ~fn_name ~is_option =
+      let fn = fn_from_field_module field ~fn_name ~loc in
+      if is_option
+      then [%expr Option.map ~f:[%e fn] [%e expr]]
+      else [%expr [%e fn] [%e expr]]
+    in
+    match attribute field ~loc with
+    | Some { kind = `boolable; is_option } -> apply_fn ~fn_name:"of_bool" ~is_option
+    | Some { kind = `stringable; is_option } -> apply_fn ~fn_name:"of_string" ~is_option
+    | Some { kind = `sexpable; is_option } ->
+      let typ_ = field.pld_type in
+      if is_option
+      then [%expr Sexp.of_string [%e expr] |> Option.map ~f:[%of_sexp: [%t typ_]]]
+      else [%expr Sexp.of_string [%e expr] |> [%of_sexp: [%t typ_]]]
+    | Some { kind = `floatable; is_option } -> apply_fn ~fn_name:"of_float" ~is_option
+    | Some { kind = `intable; is_option } -> apply_fn ~fn_name:"of_int_exn" ~is_option
+    | Some { kind = `enum; is_option } ->
+      let fn = fn_from_field_type field ~fn_name:arrow_of_code ~loc in
+      if is_option
+      then [%expr Option.map ~f:[%e fn] [%e expr]]
+      else [%expr [%e fn] [%e expr]]
+    | Some { kind = `nested; is_option = _ } | None -> expr
+
+  let encode field value ~loc =
+    let apply_fn ~fn_name ~is_option =
+      let fn = fn_from_field_module field ~fn_name ~loc in
+      if is_option
+      then [%expr Option.map ~f:[%e fn] [%e value]]
+      else [%expr [%e fn] [%e value]]
+    in
+    match attribute field ~loc with
+    | Some { kind = `boolable; is_option } -> apply_fn ~fn_name:"to_bool" ~is_option
+    | Some { kind = `stringable; is_option } -> apply_fn ~fn_name:"to_string" ~is_option
+    | Some { kind = `sexpable; is_option } ->
+      let typ_ = field.pld_type in
+      if is_option
+      then [%expr Option.map ~f:[%sexp_of: [%t typ_]] [%e value] |> Sexp.to_string]
+      else [%expr [%sexp_of: [%t typ_]] [%e value] |> Sexp.to_string]
+    | Some { kind = `floatable; is_option } -> apply_fn ~fn_name:"to_float" ~is_option
+    | Some { kind = `intable; is_option } -> apply_fn ~fn_name:"to_int_exn" ~is_option
+    | Some { kind = `enum; is_option } ->
+      let fn = fn_from_field_type field ~fn_name:arrow_code_of ~loc in
+      if is_option
+      then [%expr Option.map ~f:[%e fn] [%e value]]
+      else [%expr [%e fn] [%e value]]
+    | Some { kind = `nested; is_option = _ } | None -> value
+
+  (* [arrow_<t>_columns ~prefix] lists the flattened column names. *)
+  let columns_fn fields ~loc =
+    let columns =
       List.map fields ~f:(fun field ->
-          let get = runtime_fn field ~fn_name:"get" ~loc in
-          let expr = [%expr [%e get] [%e evar field.pld_name.txt ~loc] idx] in
-          let apply_fn ~fn_name ~is_option =
-            let fn = fn_from_field_module field ~fn_name ~loc in
+          let column = column_name field ~loc in
+          match nested field ~loc with
+          | Some is_option ->
+            let columns = fn_from_field_type field ~fn_name:arrow_columns ~loc in
+            let columns = [%expr [%e columns] ~prefix:[%e nested_prefix field ~loc]] in
+            if is_option then [%expr [%e column] :: [%e columns]] else columns
+          | None -> [%expr [ [%e column] ]])
+    in
+    [%expr fun ~prefix:__arrow_prefix -> Caml.List.concat [%e elist ~loc columns]]
+
+  (* [arrow_<t>_getter table ~prefix] extracts all the columns once and returns a
+     function building the record for a given row. *)
+  let getter_fn td fields ~loc =
+    let create_columns =
+      List.concat_map fields ~f:(fun field ->
+          let var = field.pld_name.txt in
+          match nested field ~loc with
+          | Some is_option ->
+            let getter = fn_from_field_type field ~fn_name:arrow_getter ~loc in
+            let expr =
+              [%expr [%e getter] __arrow_table ~prefix:[%e nested_prefix field ~loc]]
+            in
+            let getter = value_binding ~loc ~pat:(pat var ~loc) ~expr in
             if is_option
-            then [%expr Option.map ~f:[%e fn] [%e expr]]
-            else [%expr [%e fn] [%e expr]]
-          in
+            then (
+              let expr =
+                [%expr Bool_col.of_table __arrow_table [%e column_name field ~loc]]
+              in
+              [ value_binding ~loc ~pat:(pat (present_var field) ~loc) ~expr; getter ])
+            else [ getter ]
+          | None ->
+            let of_table = runtime_fn field ~fn_name:"of_table" ~loc in
+            let expr = [%expr [%e of_table] __arrow_table [%e column_name field ~loc]] in
+            [ value_binding ~loc ~pat:(pat var ~loc) ~expr ])
+    in
+    let record_fields =
+      List.map fields ~f:(fun field ->
+          let var = evar field.pld_name.txt ~loc in
           let expr =
-            match attribute field ~loc with
-            | Some { kind = `boolable; is_option } ->
-              apply_fn ~fn_name:"of_bool" ~is_option
-            | Some { kind = `stringable; is_option } ->
-              apply_fn ~fn_name:"of_string" ~is_option
-            | Some { kind = `sexpable; is_option } ->
-              let typ_ = field.pld_type in
-              if is_option
-              then [%expr Sexp.of_string [%e expr] |> Option.map ~f:[%of_sexp: [%t typ_]]]
-              else [%expr Sexp.of_string [%e expr] |> [%of_sexp: [%t typ_]]]
-            | Some { kind = `floatable; is_option } ->
-              apply_fn ~fn_name:"of_float" ~is_option
-            | Some { kind = `intable; is_option } ->
-              apply_fn ~fn_name:"of_int_exn" ~is_option
-            | None -> expr
+            match nested field ~loc with
+            | Some false -> [%expr [%e var] __arrow_idx]
+            | Some true ->
+              let present = evar (present_var field) ~loc in
+              [%expr
+                if Bool_col.get [%e present] __arrow_idx
+                then Some ([%e var] __arrow_idx)
+                else None]
+            | None ->
+              let get = runtime_fn field ~fn_name:"get" ~loc in
+              decode field [%expr [%e get] [%e var] __arrow_idx] ~loc
           in
           lident field.pld_name.txt ~loc, expr)
     in
-    let pat str = ppat_var (Loc.make ~loc str) ~loc in
-    let create_columns =
-      List.map fields ~f:(fun field ->
-          let name_as_string = estring ~loc field.pld_name.txt in
-          let of_table = runtime_fn field ~fn_name:"of_table" ~loc in
-          let expr = [%expr [%e of_table] table [%e name_as_string]] in
-          value_binding ~loc ~pat:(pat field.pld_name.txt) ~expr)
-    in
-    let input_table_expr =
-      match which with
-      | `read ->
-        let col_names =
-          List.map fields ~f:(fun field -> estring ~loc field.pld_name.txt)
-        in
-        [%expr
-          Arrow_c_api.File_reader.table
-            ~columns:(`names [%e elist col_names ~loc])
-            [%e args]]
-      | `of_table -> args
+    let typ_ = Ppxlib.core_type_of_type_declaration td in
+    let body =
+      [%expr fun __arrow_idx : [%t typ_] -> [%e pexp_record record_fields ~loc None]]
+      |> pexp_let ~loc Nonrecursive create_columns
+      |> open_runtime ~loc
     in
-    [%expr
-      Caml.Array.init (Arrow_c_api.Table.num_rows table) (fun idx ->
-          [%e pexp_record record_fields ~loc None])]
-    |> pexp_let ~loc Nonrecursive create_columns
-    |> pexp_let
-         ~loc
-         Nonrecursive
-         [ value_binding ~loc ~pat:(pat "table") ~expr:input_table_expr ]
-    |> open_runtime ~loc
-
-  let read_fields = read_or_of_table ~which:`read
-  let of_table_fields = read_or_of_table ~which:`of_table
-
-  let write_or_table_of fields ~loc args ~which =
-    let pat str = ppat_var (Loc.make ~loc str) ~loc in
+    [%expr fun __arrow_table ~prefix:__arrow_prefix -> [%e body]]
+
+  (* [arrow_<t>_setter len ~prefix] allocates the columns for [len] rows, the returned
+     setter writes the fields of a record directly in these columns. *)
+  let setter_fn td fields ~loc =
     let create_columns =
-      List.map fields ~f:(fun field ->
-          let init = runtime_fn field ~fn_name:"init" ~loc in
-          let expr = [%expr [%e init] __arrow_len] in
-          value_binding ~loc ~pat:(pat field.pld_name.txt) ~expr)
+      List.concat_map fields ~f:(fun field ->
+          let var = field.pld_name.txt in
+          match nested field ~loc with
+          | Some is_option ->
+            let setter = fn_from_field_type field ~fn_name:arrow_setter ~loc in
+            let expr =
+              [%expr [%e setter] __arrow_len ~prefix:[%e nested_prefix field ~loc]]
+            in
+            let setter = value_binding ~loc ~pat:(pat var ~loc) ~expr in
+            if is_option
+            then (
+              let expr = [%expr Bool_col.init __arrow_len] in
+              [ value_binding ~loc ~pat:(pat (present_var field) ~loc) ~expr; setter ])
+            else [ setter ]
+          | None ->
+            let init = runtime_fn field ~fn_name:"init" ~loc in
+            let expr = [%expr [%e init] __arrow_len] in
+            [ value_binding ~loc ~pat:(pat var ~loc) ~expr ])
     in
-    let set_columns =
+    let set_values =
       List.map fields ~f:(fun field ->
-          let set = runtime_fn field ~fn_name:"set" ~loc in
-          let array = evar field.pld_name.txt ~loc in
+          let var = evar field.pld_name.txt ~loc in
           let value =
-            pexp_field
-              [%expr [%e args].(__arrow_idx)]
-              (lident ~loc field.pld_name.txt)
-              ~loc
+            pexp_field [%expr __arrow_v] (lident ~loc field.pld_name.txt) ~loc
           in
-          let apply_fn ~fn_name ~is_option =
-            let fn = fn_from_field_module field ~fn_name ~loc in
-            if is_option
-            then [%expr Option.map ~f:[%e fn] [%e value]]
-            else [%expr [%e fn] [%e value]]
-          in
-          let value =
-            match attribute field ~loc with
-            | Some { kind = `boolable; is_option } ->
-              apply_fn ~fn_name:"to_bool" ~is_option
-            | Some { kind = `stringable; is_option } ->
-              apply_fn ~fn_name:"to_string" ~is_option
-            | Some { kind = `sexpable; is_option } ->
-              let typ_ = field.pld_type in
-              if is_option
-              then
-                [%expr Option.map ~f:[%sexp_of: [%t typ_]] [%e value] |> Sexp.to_string]
-              else [%expr [%sexp_of: [%t typ_]] [%e value] |> Sexp.to_string]
-            | Some { kind = `floatable; is_option } ->
-              apply_fn ~fn_name:"to_float" ~is_option
-            | Some { kind = `intable; is_option } ->
-              apply_fn ~fn_name:"to_int_exn" ~is_option
-            | None -> value
-          in
-          [%expr [%e set] [%e array] __arrow_idx [%e value]])
+          match nested field ~loc with
+          | Some false -> [%expr [%e var].Setter.set __arrow_idx [%e value]]
+          | Some true ->
+            let present = evar (present_var field) ~loc in
+            [%expr
+              match [%e value] with
+              | None ->
+                Bool_col.set [%e present] __arrow_idx false;
+                [%e var].Setter.set_default __arrow_idx
+              | Some __arrow_nested ->
+                Bool_col.set [%e present] __arrow_idx true;
+                [%e var].Setter.set __arrow_idx __arrow_nested]
+          | None ->
+            let set = runtime_fn field ~fn_name:"set" ~loc in
+            [%expr [%e set] [%e var] __arrow_idx [%e encode field value ~loc]])
     in
-    let col_list =
+    let set_defaults =
       List.map fields ~f:(fun field ->
-          let name_as_string = estring ~loc field.pld_name.txt in
-          let writer_col = runtime_fn field ~fn_name:"writer_col" ~loc in
-          let array = evar field.pld_name.txt ~loc in
-          [%expr [%e writer_col] [%e array] [%e name_as_string]])
+          let var = evar field.pld_name.txt ~loc in
+          match nested field ~loc with
+          | Some false -> [%expr [%e var].Setter.set_default __arrow_idx]
+          | Some true ->
+            let present = evar (present_var field) ~loc in
+            [%expr
+              Bool_col.set [%e present] __arrow_idx false;
+              [%e var].Setter.set_default __arrow_idx]
+          | None ->
+            let set = runtime_fn field ~fn_name:"set" ~loc in
+            let default = runtime_fn field ~fn_name:"default" ~loc in
+            [%expr [%e set] [%e var] __arrow_idx [%e default]])
     in
-    match which with
-    | `table_of ->
+    let cols =
+      List.map fields ~f:(fun field ->
+          let var = evar field.pld_name.txt ~loc in
+          match nested field ~loc with
+          | Some is_option ->
+            let cols = [%expr [%e var].Setter.cols ()] in
+            if is_option
+            then (
+              let present = evar (present_var field) ~loc in
+              let column = column_name field ~loc in
+              [%expr Bool_col.writer_col [%e present] [%e column] :: [%e cols]])
+            else cols
+          | None ->
+            let writer_col = runtime_fn field ~fn_name:"writer_col" ~loc in
+            [%expr [ [%e writer_col] [%e var] [%e column_name field ~loc] ]])
+    in
+    let typ_ = Ppxlib.core_type_of_type_declaration td in
+    let body =
       [%expr
-        for __arrow_idx = 0 to __arrow_len - 1 do
-          [%e esequence set_columns ~loc]
-        done;
-        Arrow_c_api.Writer.create_table ~cols:[%e elist col_list ~loc]]
+        { Setter.set =
+            (fun __arrow_idx (__arrow_v : [%t typ_]) -> [%e esequence set_values ~loc])
+        ; set_default = (fun __arrow_idx -> [%e esequence set_defaults ~loc])
+        ; cols = (fun () -> Caml.List.concat [%e elist cols ~loc])
+        }]
       |> pexp_let ~loc Nonrecursive create_columns
-      |> pexp_let
-           ~loc
-           Nonrecursive
-           [ value_binding
-               ~loc
-               ~pat:(pat "__arrow_len")
-               ~expr:[%expr Caml.Array.length [%e args]]
-           ]
       |> open_runtime ~loc
-    | `write ->
-      closure_of_fn ~loc (fun filename ->
-          [%expr
-            for __arrow_idx = 0 to __arrow_len - 1 do
-              [%e esequence set_columns ~loc]
-            done;
-            Arrow_c_api.Writer.write [%e filename] ~cols:[%e elist col_list ~loc]]
-          |> pexp_let ~loc Nonrecursive create_columns
-          |> pexp_let
-               ~loc
-               Nonrecursive
-               [ value_binding
-                   ~loc
-                   ~pat:(pat "__arrow_len")
-                   ~expr:[%expr Caml.Array.length [%e args]]
-               ]
-          |> open_runtime ~loc)
-
-  let write_fields = write_or_table_of ~which:`write
-  let table_of_fields = write_or_table_of ~which:`table_of
+    in
+    [%expr fun __arrow_len ~prefix:__arrow_prefix -> [%e body]]
+
+  let read_fn tname ~loc =
+    let columns = evar (arrow_columns tname) ~loc in
+    let getter = evar (arrow_getter tname) ~loc in
+    [%expr
+      fun __arrow_filename ->
+        let __arrow_table =
+          Arrow_c_api.File_reader.table
+            ~columns:(`names ([%e columns] ~prefix:""))
+            __arrow_filename
+        in
+        Caml.Array.init
+          (Arrow_c_api.Table.num_rows __arrow_table)
+          ([%e getter] __arrow_table ~prefix:"")]
+
+  let of_table_fn tname ~loc =
+    let getter = evar (arrow_getter tname) ~loc in
+    [%expr
+      fun __arrow_table ->
+        Caml.Array.init
+          (Arrow_c_api.Table.num_rows __arrow_table)
+          ([%e getter] __arrow_table ~prefix:"")]
+
+  let setter_cols tname ~loc =
+    let setter = evar (arrow_setter tname) ~loc in
+    [%expr
+      let __arrow_setter =
+        [%e setter] (Caml.Array.length __arrow_values) ~prefix:""
+      in
+      Caml.Array.iteri __arrow_setter.Ppx_arrow_runtime.Setter.set __arrow_values;
+      __arrow_setter.Ppx_arrow_runtime.Setter.cols ()]
+
+  let write_fn tname ~loc =
+    [%expr
+      fun __arrow_values __arrow_filename ->
+        Arrow_c_api.Writer.write __arrow_filename ~cols:[%e setter_cols tname ~loc]]
+
+  let table_of_fn tname ~loc =
+    [%expr
+      fun __arrow_values ->
+        Arrow_c_api.Writer.create_table ~cols:[%e setter_cols tname ~loc]]
+
+  (* The encoding and decoding are plain matches on immediates, they compile to jump
+     tables and do not allocate. *)
+  let enum_bindings td cds ~kind =
+    let { Location.loc; txt = tname } = td.ptype_name in
+    let typ_ = Ppxlib.core_type_of_type_declaration td in
+    let constr cd = lident ~loc cd.pcd_name.txt in
+    let code_of =
+      let cases =
+        List.mapi cds ~f:(fun code cd ->
+            case
+              ~lhs:(ppat_construct ~loc (constr cd) None)
+              ~guard:None
+              ~rhs:(eint ~loc code))
+      in
+      [%expr fun (__arrow_v : [%t typ_]) -> [%e pexp_match ~loc [%expr __arrow_v] cases]]
+    in
+    let of_code =
+      let cases =
+        List.mapi cds ~f:(fun code cd ->
+            case
+              ~lhs:(pint ~loc code)
+              ~guard:None
+              ~rhs:(pexp_construct ~loc (constr cd) None))
+      in
+      let default =
+        case
+          ~lhs:[%pat? __arrow_code]
+          ~guard:None
+          ~rhs:
+            [%expr
+              Ppx_arrow_runtime.invalid_enum_code
+                ~type_name:[%e estring ~loc tname]
+                __arrow_code]
+      in
+      [%expr
+        fun __arrow_code : [%t typ_] ->
+          [%e pexp_match ~loc [%expr __arrow_code] (cases @ [ default ])]]
+    in
+    let binding name expr = value_binding ~loc ~pat:(pvar ~loc name) ~expr in
+    let code_of = binding (arrow_code_of tname) code_of in
+    let of_code = binding (arrow_of_code tname) of_code in
+    match kind with
+    | `both -> [ code_of; of_code ]
+    | `read -> [ of_code ]
+    | `write -> [ code_of ]
 
   let gen kind =
     let attributes =
@@ -382,41 +616,62 @@ end = struct
       ; Attribute.T floatable
       ; Attribute.T stringable
       ; Attribute.T boolable
+      ; Attribute.T enum
+      ; Attribute.T nested
       ]
     in
-    Deriving.Generator.make_noarg ~attributes (fun ~loc ~path:_ (rec_flag, tds) ->
-        let mk_pat mk_ =
-          let pats =
-            List.map tds ~f:(fun td ->
-                let { Location.loc; txt = tname } = td.ptype_name in
-                let name = mk_ tname in
-                ppat_var ~loc (Loc.make name ~loc))
-          in
-          ppat_tuple ~loc pats
-        in
+    Deriving.Generator.make_noarg ~attributes (fun ~loc:_ ~path:_ (rec_flag, tds) ->
         let tds = List.map tds ~f:name_type_params_in_td in
-        let read_expr = expr_of_tds ~loc ~record:read_fields in
-        let write_expr = expr_of_tds ~loc ~record:write_fields in
-        let table_of_expr = expr_of_tds ~loc ~record:table_of_fields in
-        let of_table_expr = expr_of_tds ~loc ~record:of_table_fields in
-        let bindings =
-          match kind with
-          | `both ->
-            [ value_binding ~loc ~pat:(mk_pat arrow_read) ~expr:(read_expr tds)
-            ; value_binding ~loc ~pat:(mk_pat arrow_write) ~expr:(write_expr tds)
-            ; value_binding ~loc ~pat:(mk_pat arrow_of_table) ~expr:(of_table_expr tds)
-            ; value_binding ~loc ~pat:(mk_pat arrow_table_of) ~expr:(table_of_expr tds)
-            ]
-          | `read ->
-            [ value_binding ~loc ~pat:(mk_pat arrow_read) ~expr:(read_expr tds)
-            ; value_binding ~loc ~pat:(mk_pat arrow_of_table) ~expr:(of_table_expr tds)
-            ]
-          | `write ->
-            [ value_binding ~loc ~pat:(mk_pat arrow_write) ~expr:(write_expr tds)
-            ; value_binding ~loc ~pat:(mk_pat arrow_table_of) ~expr:(table_of_expr tds)
-            ]
+        let enum_items =
+          List.filter_map tds ~f:(fun td ->
+              Option.map (enum_constructors td) ~f:(fun cds ->
+                  let { Location.loc; txt = _ } = td.ptype_name in
+                  pstr_value ~loc Nonrecursive (enum_bindings td cds ~kind)))
+        in
+        let records =
+          List.filter_map tds ~f:(fun td ->
+              match enum_constructors td with
+              | Some _ -> None
+              | None -> Some (td, record_fields td))
         in
-        [ pstr_value ~loc (really_recursive rec_flag tds) bindings ])
+        let binding td name expr =
+          let { Location.loc; txt = _ } = td.ptype_name in
+          value_binding ~loc ~pat:(pat (name td.ptype_name.txt) ~loc) ~expr
+        in
+        (* The columns, getters and setters of types defined together can refer to each
+           other, the functions working on whole arrays are defined on top of them. *)
+        let accessors =
+          List.concat_map records ~f:(fun (td, fields) ->
+              let { Location.loc; txt = _ } = td.ptype_name in
+              let columns = binding td arrow_columns (columns_fn fields ~loc) in
+              let getter = binding td arrow_getter (getter_fn td fields ~loc) in
+              let setter = binding td arrow_setter (setter_fn td fields ~loc) in
+              match kind with
+              | `both -> [ columns; getter; setter ]
+              | `read -> [ columns; getter ]
+              | `write -> [ setter ])
+        in
+        let array_fns =
+          List.concat_map records ~f:(fun (td, _fields) ->
+              let { Location.loc; txt = tname } = td.ptype_name in
+              let read = binding td arrow_read (read_fn tname ~loc) in
+              let of_table = binding td arrow_of_table (of_table_fn tname ~loc) in
+              let write = binding td arrow_write (write_fn tname ~loc) in
+              let table_of = binding td arrow_table_of (table_of_fn tname ~loc) in
+              match kind with
+              | `both -> [ read; write; of_table; table_of ]
+              | `read -> [ read; of_table ]
+              | `write -> [ write; table_of ])
+        in
+        let record_tds = List.map records ~f:fst in
+        match records with
+        | [] -> enum_items
+        | (td, _) :: _ ->
+          let { Location.loc; txt = _ } = td.ptype_name in
+          enum_items
+          @ [ pstr_value ~loc (really_recursive rec_flag record_tds) accessors
+            ; pstr_value ~loc Nonrecursive array_fns
+            ])
 end
 
 let arrow =
@@ -8,16 +8,28 @@ module type Col_intf = sig
   type elem
 
   val init : int -> t
+  val default : elem
   val of_table : Arrow_c_api.Table.t -> string -> t
   val writer_col : t -> string -> W.col
   val get : t -> int -> elem
   val set : t -> int -> elem -> unit
 end
 
+(* The columns of a record, as generated by [@@deriving arrow]. [set_default] is used
+   for nested records that are absent. *)
+module Setter = struct
+  type 'a t =
+    { set : int -> 'a -> unit
+    ; set_default : int -> unit
+    ; cols : unit -> W.col list
+    }
+end
+
 module Int_col : Col_intf with type elem = int = struct
   type t = (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t
   type elem = int
 
+  let default = 0
   let init len = Bigarray.Array1.create Int64 C_layout len
   let of_table table name = C.read_i64_ba table ~column:(`Name name)
   let writer_col t name = W.int64_ba t ~name
@@ -29,6 +41,7 @@ module Int_option_col : Col_intf with type elem = int option = struct
   type t = (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t
   type elem = int option
 
+  let default = None
   let init len =
     let ba = Bigarray.Array1.create Int64 C_layout len in
     let v = Valid.create_all_valid len in
@@ -48,10 +61,51 @@ module Int_option_col : Col_intf with type elem = int option = struct
       ba.{idx} <- Int64.of_int v
 end
 
+(* Constant constructor variants are stored as their int8 code, the conversion from and
+   to the variant is done by the functions generated by [@@deriving arrow] on the
+   variant type. *)
+module Enum_col : Col_intf with type elem = int = struct
+  type t = (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t
+  type elem = int
+
+  let default = 0
+  let init len = Bigarray.Array1.create Int8_signed C_layout len
+  let of_table table name = C.read_i8_ba table ~column:(`Name name)
+  let writer_col t name = W.int8_ba t ~name
+  let get t idx = t.{idx}
+  let set t idx v = t.{idx} <- v
+end
+
+module Enum_option_col : Col_intf with type elem = int option = struct
+  type t = (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t
+  type elem = int option
+
+  let default = None
+  let init len =
+    let ba = Bigarray.Array1.create Int8_signed C_layout len in
+    let v = Valid.create_all_valid len in
+    ba, v
+
+  let of_table table name = C.read_i8_ba_opt table ~column:(`Name name)
+  let writer_col (ba, valid) name = W.int8_ba_opt ba valid ~name
+  let get (ba, valid) idx = if Valid.get valid idx then Some ba.{idx} else None
+
+  let set (ba, valid) idx v =
+    match v with
+    | None -> Valid.set valid idx false
+    | Some v ->
+      Valid.set valid idx true;
+      ba.{idx} <- v
+end
+
+let invalid_enum_code ~type_name code =
+  Printf.failwithf "ppx_arrow: invalid code %d for type %s" code type_name ()
+
 module Float_col : Col_intf with type elem = float = struct
   type t = (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t
   type elem = float
 
+  let default = 0.
   let init len = Bigarray.Array1.create Float64 C_layout len
   let of_table table name = C.read_f64_ba table ~column:(`Name name)
   let writer_col t name = W.float64_ba t ~name
@@ -63,6 +117,7 @@ module Float_option_col : Col_intf with type elem = float option = struct
   type t = (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t
   type elem = float option
 
+  let default = None
   let init len =
     let ba = Bigarray.Array1.create Float64 C_layout len in
     let v = Valid.create_all_valid len in
@@ -84,6 +139,7 @@ module Bool_col : Col_intf with type elem = bool = struct
   type t = Valid.t
   type elem = bool
 
+  let default = false
   let init = Valid.create_all_valid
   let of_table table name = C.read_bitset table ~column:(`Name name)
   let writer_col t name = W.bitset t ~name
@@ -99,6 +155,7 @@ module Bool_option_col : Col_intf with type elem = bool option = struct
 
   type elem = bool option
 
+  let default = None
   let init len =
     { content = Valid.create_all_valid len; valid = Valid.create_all_valid len }
 
@@ -122,6 +179,7 @@ module String_col : Col_intf with type elem = string = struct
   type t = string array
   type elem = string
 
+  let default = ""
   let init len = Array.create ~len ""
   let of_table table name = C.read_utf8 table ~column:(`Name name)
   let writer_col t name = W.utf8 t ~name
@@ -133,6 +191,7 @@ module String_option_col : Col_intf with type elem = string option = struct
   type elem = string option
   type t = elem array
 
+  let default = None
   let init len = Array.create ~len None
   let of_table table name = C.read_utf8_opt table ~column:(`Name name)
   let writer_col t name = W.utf8_opt t ~name
@@ -144,6 +203,7 @@ module Date_col : Col_intf with type elem = Core_kernel.Date.t = struct
   type elem = Core_kernel.Date.t
   type t = elem array
 
+  let default = Core_kernel.Date.unix_epoch
   let init len = Array.create ~len Core_kernel.Date.unix_epoch
   let of_table table name = C.read_date table ~column:(`Name name)
   let writer_col t name = W.date t ~name
@@ -155,6 +215,7 @@ module Date_option_col : Col_intf with type elem = Core_kernel.Date.t option = s
   type elem = Core_kernel.Date.t option
   type t = elem array
 
+  let default = None
   let init len = Array.create ~len None
   let of_table table name = C.read_date_opt table ~column:(`Name name)
   let writer_col t name = W.date_opt t ~name
@@ -166,6 +227,7 @@ module Time_ns_col : Col_intf with type elem = Core_kernel.Time_ns.t = struct
   type elem = Core_kernel.Time_ns.t
   type t = elem array
 
+  let default = Core_kernel.Time_ns.epoch
   let init len = Array.create ~len Core_kernel.Time_ns.epoch
   let of_table table name = C.read_time_ns table ~column:(`Name name)
   let writer_col t name = W.time_ns t ~name
@@ -178,6 +240,7 @@ struct
   type elem = Core_kernel.Time_ns.t option
   type t = elem array
 
+  let default = None
   let init len = Array.create ~len None
   let of_table table name = C.read_time_ns_opt table ~column:(`Name name)
   let writer_col t name = W.time_ns_opt t ~name
@@ -189,6 +252,7 @@ module Span_col : Col_intf with type elem = Core_kernel.Time_ns.Span.t = struct
   type elem = Core_kernel.Time_ns.Span.t
   type t = elem array
 
+  let default = Core_kernel.Time_ns.Span.zero
   let init len = Array.create ~len Core_kernel.Time_ns.Span.zero
   let of_table table name = C.read_span_ns table ~column:(`Name name)
   let writer_col t name = W.span_ns t ~name
@@ -201,6 +265,7 @@ struct
   type elem = Core_kernel.Time_ns.Span.t option
   type t = elem array
 
+  let default = None
   let init len = Array.create ~len None
   let of_table table name = C.read_span_ns_opt table ~column:(`Name name)
   let writer_col t name = W.span_ns_opt t ~name
@@ -212,6 +277,7 @@ module Ofday_col : Col_intf with type elem = Core_kernel.Time_ns.Ofday.t = struc
   type elem = Core_kernel.Time_ns.Ofday.t
   type t = elem array
 
+  let default = Core_kernel.Time_ns.Ofday.start_of_day
   let init len = Array.create ~len Core_kernel.Time_ns.Ofday.start_of_day
   let of_table table name = C.read_ofday_ns table ~column:(`Name name)
   let writer_col t name = W.ofday_ns t ~name
@@ -224,6 +290,7 @@ struct
   type elem = Core_kernel.Time_ns.Ofday.t option
   type t = elem array
 
+  let default = None
   let init len = Array.create ~len None
   let of_table table name = C.read_ofday_ns_opt table ~column:(`Name name)
   let writer_col t name = W.ofday_ns_opt t ~name
@@ -53,6 +53,7 @@ module C (F : Cstubs.FOREIGN) = struct
     let slice = foreign "table_slice" (t @-> int64_t @-> int64_t @-> returning t)
     let num_rows = foreign "table_num_rows" (t @-> returning int64_t)
     let schema = foreign "table_schema" (t @-> returning (ptr ArrowSchema.t))
+    let schema_fingerprint = foreign "table_schema_fingerprint" (t @-> returning int64_t)
     let free = foreign "free_table" (t @-> returning void)
     let to_string = foreign "table_to_string" (t @-> returning string)
 
@@ -76,7 +77,9 @@ module C (F : Cstubs.FOREIGN) = struct
         (t @-> string @-> ptr int @-> int @-> returning (ptr ArrowArray.t))
 
     let parquet_write =
-      foreign "parquet_write_table" (string @-> t @-> int @-> int @-> returning void)
+      foreign
+        "parquet_write_table"
+        (string @-> t @-> int @-> int @-> ptr (ptr char) @-> int @-> returning void)
 
     let feather_write =
       foreign "feather_write_table" (string @-> t @-> int @-> int @-> returning void)
@@ -89,6 +92,107 @@ module C (F : Cstubs.FOREIGN) = struct
 
     let get_column = foreign "table_get_column" (t @-> string @-> returning ChunkedArray.t)
     let add_all_columns = foreign "table_add_all_columns" (t @-> t @-> returning t)
+
+    let filter =
+      foreign "table_filter" (t @-> ptr void @-> int64_t @-> returning t)
+
+    let utf8_predicate =
+      foreign
+        "utf8_predicate"
+        (t
+        @-> string
+        @-> int
+        @-> int
+        @-> ptr (ptr char)
+        @-> int
+        @-> ptr void
+        @-> returning void)
+
+    let utf8_length =
+      foreign "utf8_length" (t @-> string @-> int @-> ptr int32_t @-> returning void)
+
+    let hash_rows =
+      foreign
+        "table_hash_rows"
+        (t @-> ptr (ptr char) @-> ptr int @-> int @-> ptr int64_t @-> returning void)
+
+    let partition_by_hash =
+      foreign
+        "table_partition_by_hash"
+        (t @-> ptr (ptr char) @-> ptr int @-> int @-> int @-> ptr t @-> returning void)
+
+    let distinct =
+      foreign
+        "table_distinct"
+        (t @-> ptr (ptr char) @-> ptr int @-> int @-> int @-> returning t)
+
+    let top_k =
+      foreign
+        "table_top_k"
+        (t
+        @-> string
+        @-> int
+        @-> int64_t
+        @-> int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> int
+        @-> returning t)
+
+    let rolling =
+      foreign
+        "table_rolling"
+        (t
+        @-> string
+        @-> int
+        @-> int64_t
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> int
+        @-> returning t)
+  end
+
+  let io_uring_available = foreign "arrow_io_uring_available" (void @-> returning int)
+
+  module Bitmap = struct
+    let binary_op =
+      foreign
+        "bitmap_binary_op"
+        (ptr void @-> ptr void @-> int64_t @-> int @-> ptr void @-> returning void)
+
+    let invert = foreign "bitmap_invert" (ptr void @-> int64_t @-> ptr void @-> returning void)
+
+    let count_set_bits =
+      foreign "bitmap_count_set_bits" (ptr void @-> int64_t @-> int64_t @-> returning int64_t)
+
+    let find_next_set =
+      foreign "bitmap_find_next_set" (ptr void @-> int64_t @-> int64_t @-> returning int64_t)
+
+    let compress =
+      foreign
+        "bitmap_compress"
+        (ptr void @-> int64_t @-> ptr void @-> int @-> ptr void @-> returning int64_t)
+
+    let expand =
+      foreign
+        "bitmap_expand"
+        (ptr void @-> int64_t @-> ptr void @-> int @-> ptr void @-> returning void)
+  end
+
+  module Memory = struct
+    let set_huge_page_threshold =
+      foreign "arrow_set_huge_page_threshold" (int64_t @-> returning void)
+
+    let bytes_allocated = foreign "arrow_bytes_allocated" (void @-> returning int64_t)
+    let max_memory = foreign "arrow_max_memory" (void @-> returning int64_t)
+
+    let huge_page_allocations =
+      foreign "arrow_huge_page_allocations" (void @-> returning int64_t)
   end
 
   module Parquet_reader = struct
@@ -102,7 +206,14 @@ module C (F : Cstubs.FOREIGN) = struct
     let read_table =
       foreign
         "parquet_read_table"
-        (string @-> ptr int @-> int @-> int @-> int64_t @-> returning Table.t)
+        (string
+        @-> ptr int
+        @-> int
+        @-> int
+        @-> int64_t
+        @-> int
+        @-> int
+        @-> returning Table.t)
 
     let open_ =
       foreign
@@ -112,6 +223,163 @@ module C (F : Cstubs.FOREIGN) = struct
     let next = foreign "parquet_reader_next" (t @-> returning Table.t)
     let close = foreign "parquet_reader_close" (t @-> returning void)
     let free = foreign "parquet_reader_free" (t @-> returning void)
+
+    let lookup_int64 =
+      foreign
+        "parquet_lookup_int64"
+        (string
+        @-> string
+        @-> ptr int64_t
+        @-> int
+        @-> ptr int
+        @-> int
+        @-> int
+        @-> int
+        @-> returning Table.t)
+
+    let lookup_utf8 =
+      foreign
+        "parquet_lookup_utf8"
+        (string
+        @-> string
+        @-> ptr (ptr char)
+        @-> int
+        @-> ptr int
+        @-> int
+        @-> int
+        @-> int
+        @-> returning Table.t)
+
+    let sample =
+      foreign
+        "parquet_sample"
+        (string
+        @-> ptr int
+        @-> int
+        @-> int64_t
+        @-> double
+        @-> string
+        @-> int64_t
+        @-> int
+        @-> int
+        @-> returning Table.t)
+  end
+
+  module Lazy_table = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let open_ = foreign "lazy_table_open" (string @-> int @-> int @-> int @-> returning t)
+    let schema = foreign "lazy_table_schema" (t @-> returning (ptr ArrowSchema.t))
+    let num_rows = foreign "lazy_table_num_rows" (t @-> returning int64_t)
+
+    let read =
+      foreign
+        "lazy_table_read"
+        (t @-> ptr int @-> int @-> int64_t @-> int64_t @-> returning Table.t)
+
+    let free = foreign "lazy_table_free" (t @-> returning void)
+  end
+
+  module Text_writer = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+
+    let open_ =
+      foreign
+        "text_writer_open"
+        (string @-> int @-> int @-> char @-> int @-> string @-> returning t)
+
+    let write = foreign "text_writer_write" (t @-> Table.t @-> returning void)
+    let close = foreign "text_writer_close" (t @-> returning void)
+    let free = foreign "text_writer_free" (t @-> returning void)
+  end
+
+  module Ipc_stream = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let open_ = foreign "ipc_stream_writer_open" (string @-> int @-> returning t)
+    let append = foreign "ipc_stream_writer_append" (t @-> Table.t @-> returning void)
+    let flush = foreign "ipc_stream_writer_flush" (t @-> returning void)
+    let close = foreign "ipc_stream_writer_close" (t @-> returning void)
+    let free = foreign "ipc_stream_writer_free" (t @-> returning void)
+    let read_table = foreign "ipc_stream_read_table" (string @-> int @-> returning Table.t)
+  end
+
+  module Resampler = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+
+    let create =
+      foreign
+        "resampler_create"
+        (string
+        @-> int
+        @-> int64_t
+        @-> ptr int64_t
+        @-> ptr int64_t
+        @-> int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> int
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> int
+        @-> returning t)
+
+    let push = foreign "resampler_push" (t @-> Table.t @-> returning Table.t)
+    let finish = foreign "resampler_finish" (t @-> returning Table.t)
+    let free = foreign "resampler_free" (t @-> returning void)
+
+    let resample =
+      foreign
+        "table_resample"
+        (Table.t
+        @-> string
+        @-> int
+        @-> int64_t
+        @-> ptr int64_t
+        @-> ptr int64_t
+        @-> int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> int
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> ptr int
+        @-> ptr (ptr char)
+        @-> int
+        @-> returning Table.t)
+  end
+
+  module Sketch = struct
+    type t = unit ptr
+
+    let t : t typ = ptr void
+    let create = foreign "sketch_create" (double @-> int @-> returning t)
+
+    let update =
+      foreign "sketch_update" (t @-> Table.t @-> string @-> int @-> returning void)
+
+    let merge = foreign "sketch_merge" (t @-> t @-> returning void)
+    let serialize = foreign "sketch_serialize" (t @-> ptr int64_t @-> returning (ptr char))
+    let deserialize = foreign "sketch_deserialize" (ptr char @-> int64_t @-> returning t)
+    let count = foreign "sketch_count" (t @-> returning int64_t)
+    let null_count = foreign "sketch_null_count" (t @-> returning int64_t)
+    let min = foreign "sketch_min" (t @-> returning double)
+    let max = foreign "sketch_max" (t @-> returning double)
+    let quantile = foreign "sketch_quantile" (t @-> double @-> returning double)
+    let distinct_count = foreign "sketch_distinct_count" (t @-> returning double)
+    let free = foreign "sketch_free" (t @-> returning void)
   end
 
   module Arrow_reader = struct
@@ -122,11 +390,29 @@ module C (F : Cstubs.FOREIGN) = struct
     let schema = foreign "feather_schema" (string @-> returning (ptr ArrowSchema.t))
 
     let read_table =
-      foreign "feather_read_table" (string @-> ptr int @-> int @-> returning Table.t)
+      foreign "feather_read_table" (string @-> ptr int @-> int @-> int @-> returning Table.t)
   end
 
-  let csv_read_table = foreign "csv_read_table" (string @-> returning Table.t)
-  let json_read_table = foreign "json_read_table" (string @-> returning Table.t)
+  let csv_read_table =
+    foreign
+      "csv_read_table"
+      (string @-> int @-> ptr (ptr char) @-> ptr (ptr char) @-> int @-> returning Table.t)
+  let json_read_table = foreign "json_read_table" (string @-> int @-> returning Table.t)
+
+  let convert_to_parquet =
+    foreign
+      "convert_to_parquet"
+      (string
+      @-> string
+      @-> int
+      @-> ptr (ptr char)
+      @-> ptr (ptr char)
+      @-> int
+      @-> int64_t
+      @-> int
+      @-> int
+      @-> ptr int64_t
+      @-> returning void)
 
   let free_chunked_column =
     foreign "free_chunked_column" (ptr ArrowArray.t @-> int @-> returning void)
@@ -144,6 +430,8 @@ module C (F : Cstubs.FOREIGN) = struct
       @-> ptr ArrowSchema.t
       @-> int
       @-> int
+      @-> ptr (ptr char)
+      @-> int
       @-> returning void)
 
   let feather_write_file =
@@ -14,10 +14,34 @@
 // return nullptr;
 
 #include "arrow_c_api.h"
-
+#include "arrow_io.h"
+#include "arrow_memory.h"
+#include "arrow_sketch.h"
+
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<cmath>
+#include<condition_variable>
+#include<deque>
+#include<functional>
 #include<iostream>
-
+#include<limits>
+#include<mutex>
+#include<numeric>
+#include<random>
+#include<regex>
+#include<thread>
+#include<unordered_map>
+#include<unordered_set>
+
+#include<cerrno>
+#include<cstring>
+#include<unistd.h>
+
+#include<caml/alloc.h>
 #include<caml/bigarray.h>
+#include<caml/memory.h>
 #include<caml/mlvalues.h>
 #include<caml/threads.h>
 #include<caml/fail.h>
@@ -66,10 +90,16 @@ void status_exn(arrow::Status &st) {
   }
 }
 
+// Compute functions allocate their results using [memory_pool].
+arrow::compute::ExecContext *exec_context() {
+  static arrow::compute::ExecContext ctx(memory_pool());
+  return &ctx;
+}
+
 struct ArrowSchema *arrow_schema(char *filename) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
+  auto file = arrow::io::ReadableFile::Open(filename, memory_pool());
   std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
   auto reader = arrow::ipc::RecordBatchFileReader::Open(infile);
   std::shared_ptr<arrow::Schema> schema = ok_exn(reader)->schema();
@@ -84,7 +114,7 @@ struct ArrowSchema *arrow_schema(char *filename) {
 struct ArrowSchema *feather_schema(char *filename) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
+  auto file = arrow::io::ReadableFile::Open(filename, memory_pool());
   std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
   auto reader = arrow::ipc::feather::Reader::Open(infile);
   std::shared_ptr<arrow::Schema> schema = ok_exn(reader)->schema();
@@ -100,10 +130,10 @@ struct ArrowSchema *parquet_schema(char *filename, int64_t *num_rows) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
   arrow::Status st;
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
+  auto file = arrow::io::ReadableFile::Open(filename, memory_pool());
   std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
   std::unique_ptr<parquet::arrow::FileReader> reader;
-  st = parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader);
+  st = parquet::arrow::OpenFile(infile, memory_pool(), &reader);
   status_exn(st);
   std::shared_ptr<arrow::Schema> schema;
   st = reader->GetSchema(&schema);
@@ -280,6 +310,10 @@ struct ArrowArray *table_chunked_column_(TablePtr *table, char *column_name, int
     expected_type = arrow::Type::DURATION;
     expected_type_str = "duration";
   }
+  else if (dt == 10) {
+    expected_type = arrow::Type::INT8;
+    expected_type_str = "int8";
+  }
   else {
     throw std::invalid_argument(std::string("unknown datatype ") + std::to_string(dt));
   }
@@ -388,6 +422,422 @@ arrow::Compression::type compression_of_int(int compression) {
   return compression_;
 }
 
+/* Value hashing.
+   This is a plain XXH64, the hashes end up being persisted in the bloom filters
+   stored in parquet files so this must not depend on the platform or on the
+   standard library implementation: inputs are read as little-endian words and
+   integers are hashed through their little-endian encoding. */
+const uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t xxh_rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t xxh_read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return arrow::BitUtil::FromLittleEndian(v);
+}
+
+inline uint32_t xxh_read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return arrow::BitUtil::FromLittleEndian(v);
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+  acc += input * XXH_PRIME64_2;
+  acc = xxh_rotl64(acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val) {
+  acc ^= xxh_round(0, val);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t xxh64(const uint8_t *p, int64_t len, uint64_t seed) {
+  const uint8_t *end = p + len;
+  uint64_t h;
+  if (len >= 32) {
+    const uint8_t *limit = end - 32;
+    uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+    uint64_t v2 = seed + XXH_PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - XXH_PRIME64_1;
+    do {
+      v1 = xxh_round(v1, xxh_read64(p)); p += 8;
+      v2 = xxh_round(v2, xxh_read64(p)); p += 8;
+      v3 = xxh_round(v3, xxh_read64(p)); p += 8;
+      v4 = xxh_round(v4, xxh_read64(p)); p += 8;
+    } while (p <= limit);
+    h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+    h = xxh_merge_round(h, v1);
+    h = xxh_merge_round(h, v2);
+    h = xxh_merge_round(h, v3);
+    h = xxh_merge_round(h, v4);
+  }
+  else {
+    h = seed + XXH_PRIME64_5;
+  }
+  h += (uint64_t)len;
+  while (p + 8 <= end) {
+    h ^= xxh_round(0, xxh_read64(p));
+    h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= (uint64_t)xxh_read32(p) * XXH_PRIME64_1;
+    h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (*p) * XXH_PRIME64_5;
+    h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+    ++p;
+  }
+  h ^= h >> 33;
+  h *= XXH_PRIME64_2;
+  h ^= h >> 29;
+  h *= XXH_PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t hash_int64(int64_t v) {
+  uint64_t le = arrow::BitUtil::ToLittleEndian(static_cast<uint64_t>(v));
+  return xxh64((const uint8_t*)&le, sizeof(le), 0);
+}
+
+inline uint64_t hash_bytes(arrow::util::string_view v) {
+  return xxh64((const uint8_t*)v.data(), v.size(), 0);
+}
+
+/* Integer like columns (ints, dates, timestamps, durations...) are accessed
+   through their value widened to int64, binary like columns through a view on
+   their bytes. */
+typedef int64_t (*IntValueFn)(const arrow::Array&, int64_t);
+
+template<class T>
+int64_t int_value(const arrow::Array &array, int64_t i) {
+  return static_cast<int64_t>(static_cast<const arrow::NumericArray<T>&>(array).Value(i));
+}
+
+IntValueFn int_value_fn(arrow::Type::type id) {
+  switch (id) {
+    case arrow::Type::INT8: return int_value<arrow::Int8Type>;
+    case arrow::Type::INT16: return int_value<arrow::Int16Type>;
+    case arrow::Type::INT32: return int_value<arrow::Int32Type>;
+    case arrow::Type::INT64: return int_value<arrow::Int64Type>;
+    case arrow::Type::UINT8: return int_value<arrow::UInt8Type>;
+    case arrow::Type::UINT16: return int_value<arrow::UInt16Type>;
+    case arrow::Type::UINT32: return int_value<arrow::UInt32Type>;
+    case arrow::Type::UINT64: return int_value<arrow::UInt64Type>;
+    case arrow::Type::DATE32: return int_value<arrow::Date32Type>;
+    case arrow::Type::DATE64: return int_value<arrow::Date64Type>;
+    case arrow::Type::TIME32: return int_value<arrow::Time32Type>;
+    case arrow::Type::TIME64: return int_value<arrow::Time64Type>;
+    case arrow::Type::TIMESTAMP: return int_value<arrow::TimestampType>;
+    case arrow::Type::DURATION: return int_value<arrow::DurationType>;
+    default: return nullptr;
+  }
+}
+
+bool is_binary_like(arrow::Type::type id) {
+  return id == arrow::Type::STRING || id == arrow::Type::BINARY
+    || id == arrow::Type::LARGE_STRING || id == arrow::Type::LARGE_BINARY;
+}
+
+arrow::util::string_view binary_value(const arrow::Array &array, int64_t i) {
+  arrow::Type::type id = array.type_id();
+  if (id == arrow::Type::LARGE_STRING || id == arrow::Type::LARGE_BINARY)
+    return static_cast<const arrow::LargeBinaryArray&>(array).GetView(i);
+  return static_cast<const arrow::BinaryArray&>(array).GetView(i);
+}
+
+int64_t units_per_day(arrow::TimeUnit::type unit) {
+  switch (unit) {
+    case arrow::TimeUnit::SECOND: return 86400LL;
+    case arrow::TimeUnit::MILLI: return 86400LL * 1000;
+    case arrow::TimeUnit::MICRO: return 86400LL * 1000 * 1000;
+    case arrow::TimeUnit::NANO: return 86400LL * 1000 * 1000 * 1000;
+  }
+  return 0;
+}
+
+int64_t units_per_day(parquet::LogicalType::TimeUnit::unit unit) {
+  switch (unit) {
+    case parquet::LogicalType::TimeUnit::MILLIS: return 86400LL * 1000;
+    case parquet::LogicalType::TimeUnit::MICROS: return 86400LL * 1000 * 1000;
+    case parquet::LogicalType::TimeUnit::NANOS: return 86400LL * 1000 * 1000 * 1000;
+    default: return 0;
+  }
+}
+
+// The unit a parquet column stores its values in relative to the unit of the
+// arrow column it is written from or read back as, e.g. timestamp[s] columns
+// are stored as milliseconds and date64 ones as days.
+struct StoredUnit {
+  int64_t arrow_per_day = 1;
+  int64_t stored_per_day = 1;
+
+  // Converts [v] the way the parquet writer does, returns false on overflow.
+  bool convert(int64_t v, int64_t *out) const {
+    if (stored_per_day >= arrow_per_day)
+      return !__builtin_mul_overflow(v, stored_per_day / arrow_per_day, out);
+    *out = v / (arrow_per_day / stored_per_day);
+    return true;
+  }
+};
+
+// Returns false when the stored unit of [descr] is unknown.
+bool stored_unit(const arrow::DataType &type,
+                 const parquet::ColumnDescriptor &descr,
+                 StoredUnit *unit) {
+  const std::shared_ptr<const parquet::LogicalType> &logical_type = descr.logical_type();
+  switch (type.id()) {
+    case arrow::Type::TIMESTAMP:
+      if (!logical_type->is_timestamp()) return false;
+      unit->arrow_per_day = units_per_day(static_cast<const arrow::TimestampType&>(type).unit());
+      unit->stored_per_day =
+        units_per_day(static_cast<const parquet::TimestampLogicalType&>(*logical_type).time_unit());
+      break;
+    case arrow::Type::TIME32:
+    case arrow::Type::TIME64:
+      if (!logical_type->is_time()) return false;
+      unit->arrow_per_day = units_per_day(static_cast<const arrow::TimeType&>(type).unit());
+      unit->stored_per_day =
+        units_per_day(static_cast<const parquet::TimeLogicalType&>(*logical_type).time_unit());
+      break;
+    case arrow::Type::DATE64:
+      if (!logical_type->is_date()) return false;
+      unit->arrow_per_day = units_per_day(arrow::TimeUnit::MILLI);
+      break;
+    default:
+      break;
+  }
+  return unit->arrow_per_day != 0 && unit->stored_per_day != 0;
+}
+
+// Calls [f] on the hash of each non-null value of [array], integer values are
+// hashed in [unit] so that the hashes do not depend on the arrow unit.
+template<class F>
+void for_each_value_hash(const arrow::ChunkedArray &array, const StoredUnit &unit, F f) {
+  arrow::Type::type id = array.type()->id();
+  IntValueFn int_fn = int_value_fn(id);
+  if (int_fn == nullptr && !is_binary_like(id)) {
+    throw std::invalid_argument(std::string("cannot hash values of type ") + array.type()->ToString());
+  }
+  for (auto &chunk : array.chunks()) {
+    int64_t chunk_len = chunk->length();
+    for (int64_t i = 0; i < chunk_len; ++i) {
+      if (chunk->IsNull(i)) continue;
+      if (int_fn) {
+        // Overflowing values cannot be looked up, see [stored_values].
+        int64_t v;
+        unit.convert(int_fn(*chunk, i), &v);
+        f(hash_int64(v));
+      }
+      else f(hash_bytes(binary_value(*chunk, i)));
+    }
+  }
+}
+
+/* Lookup indexes.
+   Arrow 4/5 cannot write the parquet bloom filters nor the page indexes, so we
+   store our own bloom filters in the file key-value metadata instead, one entry
+   per indexed column holding a filter per row group. Together with the row group
+   min/max statistics this lets the lookup functions only decode the row groups
+   that may contain one of the requested values. */
+const std::string bloom_filter_key_prefix = "ocaml_arrow.bloom_filter.";
+const char bloom_filter_magic[4] = {'O', 'A', 'B', '1'};
+
+class BloomFilter {
+ public:
+  BloomFilter(int64_t num_rows, int64_t num_values) : num_rows_(num_rows), num_hashes_(7) {
+    words_.assign(std::max<int64_t>(1, (num_values * bits_per_value + 63) / 64), 0);
+  }
+
+  void insert(uint64_t h) {
+    uint64_t num_bits = words_.size() * 64;
+    uint64_t delta = xxh_rotl64(h, 32) | 1;
+    for (uint32_t i = 0; i < num_hashes_; ++i) {
+      uint64_t bit = h % num_bits;
+      words_[bit / 64] |= 1ULL << (bit % 64);
+      h += delta;
+    }
+  }
+
+  bool may_contain(uint64_t h) const {
+    uint64_t num_bits = words_.size() * 64;
+    uint64_t delta = xxh_rotl64(h, 32) | 1;
+    for (uint32_t i = 0; i < num_hashes_; ++i) {
+      uint64_t bit = h % num_bits;
+      if (!(words_[bit / 64] & (1ULL << (bit % 64)))) return false;
+      h += delta;
+    }
+    return true;
+  }
+
+  int64_t num_rows() const { return num_rows_; }
+
+  // Layout: num_rows (int64), num_hashes (uint32), num_words (uint64), words,
+  // all little-endian.
+  void serialize(std::string *out) const {
+    append_le(out, num_rows_);
+    append_le(out, num_hashes_);
+    append_le(out, (uint64_t)words_.size());
+    for (uint64_t word : words_) append_le(out, word);
+  }
+
+  static std::vector<BloomFilter> deserialize_all(const std::string &str) {
+    std::vector<BloomFilter> filters;
+    const char *p = str.data();
+    const char *end = p + str.size();
+    auto read = [&](void *dst, size_t len) {
+      if ((size_t)(end - p) < len) throw std::invalid_argument("truncated bloom filter");
+      memcpy(dst, p, len);
+      p += len;
+    };
+    auto read_le = [&](auto *dst) {
+      read(dst, sizeof(*dst));
+      *dst = arrow::BitUtil::FromLittleEndian(*dst);
+    };
+    char magic[4];
+    read(magic, sizeof(magic));
+    if (memcmp(magic, bloom_filter_magic, sizeof(magic)))
+      throw std::invalid_argument("unexpected bloom filter version");
+    uint32_t num_filters;
+    read_le(&num_filters);
+    for (uint32_t i = 0; i < num_filters; ++i) {
+      BloomFilter filter(0, 0);
+      uint64_t num_words;
+      read_le(&filter.num_rows_);
+      read_le(&filter.num_hashes_);
+      read_le(&num_words);
+      if (num_words == 0 || num_words > (uint64_t)(end - p) / sizeof(uint64_t))
+        throw std::invalid_argument("invalid bloom filter size");
+      filter.words_.resize(num_words);
+      for (auto &word : filter.words_) read_le(&word);
+      filters.push_back(std::move(filter));
+    }
+    return filters;
+  }
+
+  static std::string serialize_all(const std::vector<BloomFilter> &filters) {
+    std::string out(bloom_filter_magic, sizeof(bloom_filter_magic));
+    append_le(&out, (uint32_t)filters.size());
+    for (auto &filter : filters) filter.serialize(&out);
+    return out;
+  }
+
+ private:
+  template<class T>
+  static void append_le(std::string *out, T v) {
+    v = arrow::BitUtil::ToLittleEndian(v);
+    out->append((const char*)&v, sizeof(v));
+  }
+
+  // ~1% false positive rate with 7 hashes.
+  static const int64_t bits_per_value = 10;
+  int64_t num_rows_;
+  uint32_t num_hashes_;
+  std::vector<uint64_t> words_;
+};
+
+// Returns the parquet file key-value metadata for [table]: its schema metadata
+// with a bloom filter for each of [columns] and each row group, row groups
+// being of [row_group_size] rows as done by [parquet::arrow::FileWriter].
+// Values are hashed in the unit of their column in [descr], the parquet
+// schema of the file, as this is the only unit lookups can recover.
+// Filters left over from a previous write, tables read from parquet files
+// getting the file metadata as schema metadata, are always removed as they
+// would not match the new row groups.
+std::shared_ptr<const arrow::KeyValueMetadata> file_metadata_with_bloom_filters(
+    const arrow::Table &table,
+    const parquet::SchemaDescriptor &descr,
+    int64_t row_group_size,
+    char **columns,
+    int ncolumns) {
+  auto metadata = std::make_shared<arrow::KeyValueMetadata>();
+  auto prev_metadata = table.schema()->metadata();
+  if (prev_metadata) {
+    for (int64_t i = 0; i < prev_metadata->size(); ++i) {
+      if (prev_metadata->key(i).compare(0, bloom_filter_key_prefix.size(), bloom_filter_key_prefix) != 0)
+        metadata->Append(prev_metadata->key(i), prev_metadata->value(i));
+    }
+  }
+  int64_t num_rows = table.num_rows();
+  row_group_size = std::max<int64_t>(1, row_group_size);
+  for (int col_idx = 0; col_idx < ncolumns; ++col_idx) {
+    auto array = table.GetColumnByName(std::string(columns[col_idx]));
+    if (!array) {
+      throw std::invalid_argument(std::string("cannot find column ") + columns[col_idx]);
+    }
+    StoredUnit unit;
+    int leaf_idx = descr.ColumnIndex(std::string(columns[col_idx]));
+    if (leaf_idx >= 0 && !stored_unit(*array->type(), *descr.Column(leaf_idx), &unit)) {
+      unit = StoredUnit();
+    }
+    std::vector<BloomFilter> filters;
+    for (int64_t offset = 0; offset < num_rows; offset += row_group_size) {
+      int64_t length = std::min(row_group_size, num_rows - offset);
+      auto slice = array->Slice(offset, length);
+      BloomFilter filter(length, length - slice->null_count());
+      for_each_value_hash(*slice, unit, [&](uint64_t h) { filter.insert(h); });
+      filters.push_back(std::move(filter));
+    }
+    metadata->Append(bloom_filter_key_prefix + columns[col_idx], BloomFilter::serialize_all(filters));
+  }
+  if (metadata->size() == 0) return nullptr;
+  return metadata;
+}
+
+// The bloom filters only go to the file key-value metadata: the writer is
+// opened the same way as [parquet::arrow::WriteTable] does, but with this
+// metadata rather than the one derived from the arrow schema.
+void write_parquet(std::shared_ptr<arrow::Table> table,
+                   std::shared_ptr<arrow::io::OutputStream> outfile,
+                   int64_t chunk_size,
+                   int compression,
+                   char **bloom_filter_columns,
+                   int n_bloom_filter_columns) {
+  auto properties =
+    parquet::WriterProperties::Builder()
+      .version(parquet::ParquetVersion::PARQUET_2_0)
+      ->compression(compression_of_int(compression))
+      ->build();
+  auto arrow_properties = parquet::default_arrow_writer_properties();
+  // WriteTable caps the row group size the same way.
+  int64_t row_group_size = std::min(chunk_size, properties->max_row_group_length());
+  std::shared_ptr<parquet::SchemaDescriptor> descr;
+  arrow::Status st = parquet::arrow::ToParquetSchema(table->schema().get(),
+                                                     *properties,
+                                                     *arrow_properties,
+                                                     &descr);
+  status_exn(st);
+  auto metadata = file_metadata_with_bloom_filters(
+    *table, *descr, row_group_size, bloom_filter_columns, n_bloom_filter_columns);
+  auto schema_node =
+    std::static_pointer_cast<parquet::schema::GroupNode>(descr->schema_root());
+  std::unique_ptr<parquet::arrow::FileWriter> writer;
+  st = parquet::arrow::FileWriter::Make(
+    memory_pool(),
+    parquet::ParquetFileWriter::Open(outfile, schema_node, properties, metadata),
+    table->schema(),
+    arrow_properties,
+    &writer);
+  status_exn(st);
+  st = writer->WriteTable(*table, chunk_size);
+  status_exn(st);
+  st = writer->Close();
+  status_exn(st);
+}
+
 TablePtr *create_table(struct ArrowArray *array, struct ArrowSchema *schema) {
   OCAML_BEGIN_PROTECT_EXN
 
@@ -399,10 +849,7 @@ TablePtr *create_table(struct ArrowArray *array, struct ArrowSchema *schema) {
   return nullptr;
 }
 
-void parquet_write_file(char *filename, struct ArrowArray *array, struct ArrowSchema *schema, int chunk_size, int compression) {
-  // It is important for this shared pointer to only go out of scope after getting
-  // the ocaml lock back as the table release can use ocaml callbacks defined in
-  // [schema]/[array].
+void parquet_write_file(char *filename, struct ArrowArray *array, struct ArrowSchema *schema, int chunk_size, int compression, char **bloom_filter_columns, int n_bloom_filter_columns) {
   std::shared_ptr<arrow::Table> table;
   OCAML_BEGIN_PROTECT_EXN
   auto file = arrow::io::FileOutputStream::Open(filename);
@@ -412,13 +859,7 @@ void parquet_write_file(char *filename, struct ArrowArray *array, struct ArrowSc
   table = std::move(ok_exn(table_));
   {
     caml_lock_guard lock;
-    arrow::Compression::type compression_ = compression_of_int(compression);
-    arrow::Status st = parquet::arrow::WriteTable(*table,
-                                                  arrow::default_memory_pool(),
-                                                  outfile,
-                                                  chunk_size,
-                                                  parquet::WriterProperties::Builder().version(parquet::ParquetVersion::PARQUET_2_0)->compression(compression_)->build());
-    status_exn(st);
+    write_parquet(table, outfile, chunk_size, compression, bloom_filter_columns, n_bloom_filter_columns);
   }
 
   OCAML_END_PROTECT_EXN
@@ -464,18 +905,12 @@ void feather_write_file(char *filename, struct ArrowArray *array, struct ArrowSc
   OCAML_END_PROTECT_EXN
 }
 
-void parquet_write_table(char *filename, TablePtr *table, int chunk_size, int compression) {
+void parquet_write_table(char *filename, TablePtr *table, int chunk_size, int compression, char **bloom_filter_columns, int n_bloom_filter_columns) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
   auto file = arrow::io::FileOutputStream::Open(filename);
   auto outfile = ok_exn(file);
-  arrow::Compression::type compression_ = compression_of_int(compression);
-  arrow::Status st = parquet::arrow::WriteTable(**table,
-                                                arrow::default_memory_pool(),
-                                                outfile,
-                                                chunk_size,
-                                                parquet::WriterProperties::Builder().version(parquet::ParquetVersion::PARQUET_2_0)->compression(compression_)->build());
-  status_exn(st);
+  write_parquet(*table, outfile, chunk_size, compression, bloom_filter_columns, n_bloom_filter_columns);
 
   OCAML_END_PROTECT_EXN
 }
@@ -494,22 +929,59 @@ void feather_write_table(char *filename, TablePtr *table, int chunk_size, int co
   OCAML_END_PROTECT_EXN
 }
 
-ParquetReader *parquet_reader_open(char *filename, int *col_idxs, int ncols, int use_threads, int mmap, int buffer_size, int batch_size) {
+// Opens a parquet file using the [io] backend, see [open_random_access].
+std::unique_ptr<parquet::arrow::FileReader> open_parquet(const char *filename,
+                                                         int io,
+                                                         int use_threads,
+                                                         parquet::ReaderProperties prop = parquet::ReaderProperties(memory_pool()),
+                                                         parquet::ArrowReaderProperties arrow_prop = parquet::default_arrow_reader_properties()) {
+  // Pre-buffering issues the column chunk reads concurrently rather than one
+  // after the other, this is what makes io_uring worth it. It also coalesces
+  // neighbouring column chunks into large reads for direct io.
+  if (io == io_uring || io == io_direct) arrow_prop.set_pre_buffer(true);
+  std::unique_ptr<parquet::ParquetFileReader> preader =
+    parquet::ParquetFileReader::Open(open_random_access(filename, io), prop);
+  std::unique_ptr<parquet::arrow::FileReader> reader;
+  arrow::Status st =
+    parquet::arrow::FileReader::Make(memory_pool(), std::move(preader), arrow_prop, &reader);
+  status_exn(st);
+  if (use_threads >= 0) reader->set_use_threads(use_threads);
+  return reader;
+}
+
+int arrow_io_uring_available() {
+  return io_uring_available();
+}
+
+void arrow_set_huge_page_threshold(int64_t threshold) {
+  set_huge_page_threshold(threshold);
+}
+
+int64_t arrow_bytes_allocated() {
+  return memory_pool()->bytes_allocated();
+}
+
+int64_t arrow_max_memory() {
+  return memory_pool()->max_memory();
+}
+
+int64_t arrow_huge_page_allocations() {
+  return huge_page_allocations();
+}
+
+ParquetReader *parquet_reader_open(char *filename, int *col_idxs, int ncols, int use_threads, int io, int buffer_size, int batch_size) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
   arrow::Status st;
-  parquet::ReaderProperties prop = parquet::default_reader_properties();
+  parquet::ReaderProperties prop = parquet::ReaderProperties(memory_pool());
   parquet::ArrowReaderProperties arrow_prop = parquet::default_arrow_reader_properties();
   if (buffer_size > 0) {
     prop.enable_buffered_stream();
     prop.set_buffer_size(buffer_size);
   }
   if (batch_size > 0) arrow_prop.set_batch_size(batch_size);
-  std::unique_ptr<parquet::ParquetFileReader> preader = parquet::ParquetFileReader::OpenFile(filename, mmap, prop);
-  std::unique_ptr<parquet::arrow::FileReader> reader;
-  st = parquet::arrow::FileReader::Make(arrow::default_memory_pool(), std::move(preader), arrow_prop, &reader);
-  status_exn(st);
-  if (use_threads >= 0) reader->set_use_threads(use_threads);
+  std::unique_ptr<parquet::arrow::FileReader> reader =
+    open_parquet(filename, io, use_threads, prop, arrow_prop);
   std::unique_ptr<arrow::RecordBatchReader> batch_reader;
   std::vector<int> all_groups(reader->num_row_groups());
   std::iota(all_groups.begin(), all_groups.end(), 0);
@@ -556,151 +1028,2854 @@ void parquet_reader_free(ParquetReader *pr) {
   delete pr;
 }
 
-TablePtr *parquet_read_table(char *filename, int *col_idxs, int ncols, int use_threads, int64_t only_first) {
+/* Lazy tables: the schema is available right away and each column is only
+   decoded on first access, per row group for parquet files and as a whole for
+   feather files. Decoded data is cached in the handle. */
+LazyTable *lazy_table_open(char *filename, int format, int use_threads, int io) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
   arrow::Status st;
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
-  std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
-  std::unique_ptr<parquet::arrow::FileReader> reader;
-  st = parquet::arrow::OpenFile(infile, arrow::default_memory_pool(), &reader);
-  status_exn(st);
-  if (use_threads >= 0) reader->set_use_threads(use_threads);
-  std::shared_ptr<arrow::Table> table;
-  if (only_first < 0) {
-    if (ncols)
-      st = reader->ReadTable(std::vector<int>(col_idxs, col_idxs+ncols), &table);
-    else
-      st = reader->ReadTable(&table);
+  LazyTable *t = new LazyTable();
+  std::unique_ptr<LazyTable> guard(t);
+  if (format == 0) {
+    t->parquet_reader = open_parquet(filename, io, use_threads);
+    st = t->parquet_reader->GetSchema(&t->schema);
     status_exn(st);
+    auto metadata = t->parquet_reader->parquet_reader()->metadata();
+    t->row_group_offsets.push_back(0);
+    for (int rg = 0; rg < metadata->num_row_groups(); ++rg)
+      t->row_group_offsets.push_back(t->row_group_offsets.back() + metadata->RowGroup(rg)->num_rows());
   } else {
-    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
-    for (int row_group_idx = 0; row_group_idx < reader->num_row_groups(); ++row_group_idx) {
-      std::unique_ptr<arrow::RecordBatchReader> batch_reader;
-      if (ncols)
-        st = reader->GetRecordBatchReader({row_group_idx}, std::vector<int>(col_idxs, col_idxs+ncols), &batch_reader);
-      else
-        st = reader->GetRecordBatchReader({row_group_idx}, &batch_reader);
-      status_exn(st);
-      std::shared_ptr<arrow::RecordBatch> batch;
-      while (only_first > 0) {
-        st = batch_reader->ReadNext(&batch);
+    auto reader = arrow::ipc::feather::Reader::Open(open_random_access(filename, io));
+    t->feather_reader = ok_exn(reader);
+    t->schema = t->feather_reader->schema();
+    t->row_group_offsets = {0, 0};
+  }
+  t->cache.resize(t->schema->num_fields());
+  for (auto &column : t->cache) column.resize(t->row_group_offsets.size() - 1);
+  if (t->feather_reader && t->schema->num_fields() > 0) {
+    // The number of rows is only known once a column has been read, the
+    // first one is kept in the cache.
+    std::shared_ptr<arrow::Table> table;
+    st = t->feather_reader->Read(std::vector<int>{0}, &table);
+    status_exn(st);
+    t->cache[0][0] = table->column(0);
+    t->row_group_offsets[1] = table->num_rows();
+  }
+  return guard.release();
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+struct ArrowSchema *lazy_table_schema(LazyTable *t) {
+  struct ArrowSchema *out = (struct ArrowSchema*)malloc(sizeof *out);
+  arrow::ExportSchema(*t->schema, out);
+  return out;
+}
+
+int64_t lazy_table_num_rows(LazyTable *t) {
+  return t->row_group_offsets.back();
+}
+
+// Returns the rows [offset, offset + length) of [col_idxs], or of all the
+// columns when [ncols] is 0. Only the row groups overlapping this range get
+// decoded.
+TablePtr *lazy_table_read(LazyTable *t, int *col_idxs, int ncols, int64_t offset, int64_t length) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  arrow::Status st;
+  std::lock_guard<std::mutex> lock(t->mutex);
+  int64_t num_rows = t->row_group_offsets.back();
+  if (offset < 0 || offset > num_rows) throw std::invalid_argument("offset out of bounds");
+  if (length < 0 || offset + length > num_rows) length = num_rows - offset;
+  std::vector<int> columns(col_idxs, col_idxs + ncols);
+  if (ncols == 0) {
+    columns.resize(t->schema->num_fields());
+    std::iota(columns.begin(), columns.end(), 0);
+  }
+  for (int col_idx : columns) {
+    if (col_idx < 0 || col_idx >= t->schema->num_fields())
+      throw std::invalid_argument("column index out of bounds " + std::to_string(col_idx));
+  }
+  int num_groups = t->row_group_offsets.size() - 1;
+  int first_rg = std::upper_bound(t->row_group_offsets.begin(), t->row_group_offsets.end(), offset)
+    - t->row_group_offsets.begin() - 1;
+  int last_rg = first_rg;
+  while (last_rg < num_groups && t->row_group_offsets[last_rg] < offset + length) ++last_rg;
+  first_rg = std::min(first_rg, num_groups);
+
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  std::vector<std::shared_ptr<arrow::ChunkedArray>> arrays;
+  for (int col_idx : columns) {
+    auto &cache = t->cache[col_idx];
+    if (t->feather_reader) {
+      if (!cache[0]) {
+        std::shared_ptr<arrow::Table> table;
+        st = t->feather_reader->Read(std::vector<int>{col_idx}, &table);
+        status_exn(st);
+        cache[0] = table->column(0);
+      }
+    } else {
+      for (int rg = first_rg; rg < last_rg; ++rg) {
+        if (cache[rg]) continue;
+        st = t->parquet_reader->RowGroup(rg)->Column(col_idx)->Read(&cache[rg]);
         status_exn(st);
-        if (batch == nullptr) break;
-        if (only_first <= batch->num_rows()) {
-          batches.push_back(std::move(batch->Slice(0, only_first)));
-          only_first = 0;
-          break;
-        }
-        else {
-          only_first -= batch->num_rows();
-          batches.push_back(std::move(batch));
-        }
       }
-      if (only_first <= 0)
-        break;
     }
-    auto table_ = arrow::Table::FromRecordBatches(batches);
-    table = std::move(ok_exn(table_));
+    arrow::ArrayVector chunks;
+    for (int rg = first_rg; rg < last_rg; ++rg) {
+      for (auto &chunk : cache[rg]->chunks()) chunks.push_back(chunk);
+    }
+    auto field = t->schema->field(col_idx);
+    auto array = std::make_shared<arrow::ChunkedArray>(chunks, field->type());
+    fields.push_back(field);
+    arrays.push_back(array->Slice(offset - t->row_group_offsets[first_rg], length));
   }
+  auto table = arrow::Table::Make(arrow::schema(fields, t->schema->metadata()), arrays, length);
   return new std::shared_ptr<arrow::Table>(std::move(table));
 
   OCAML_END_PROTECT_EXN
   return nullptr;
 }
 
-TablePtr *feather_read_table(char *filename, int *col_idxs, int ncols) {
+void lazy_table_free(LazyTable *t) {
+  delete t;
+}
+
+/* Appendable IPC stream files.
+   Batches are written with the IPC streaming format as soon as they get
+   appended, the file can be read at any time and a crash only loses the
+   batch being written. fsync_policy is 0 to never fsync, 1 to fsync on
+   explicit flushes and 2 to fsync after each append. */
+IpcStreamWriter *ipc_stream_writer_open(char *filename, int fsync_policy) {
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
-  arrow::Status st;
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
-  std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
-  auto reader = arrow::ipc::feather::Reader::Open(infile);
-  std::shared_ptr<arrow::Table> table;
-  if (ncols)
-    st = ok_exn(reader)->Read(std::vector<int>(col_idxs, col_idxs+ncols), &table);
-  else
-    st = ok_exn(reader)->Read(&table);
-  status_exn(st);
-  return new std::shared_ptr<arrow::Table>(std::move(table));
+  auto file = arrow::io::FileOutputStream::Open(filename);
+  return new IpcStreamWriter{ok_exn(file), nullptr, fsync_policy};
+
   OCAML_END_PROTECT_EXN
   return nullptr;
 }
 
-TablePtr *csv_read_table(char *filename) {
-  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+void ipc_stream_writer_sync(IpcStreamWriter *w) {
+  arrow::Status st = w->file->Flush();
+  status_exn(st);
+  if (fsync(w->file->file_descriptor()) != 0) {
+    throw std::invalid_argument(std::string("fsync failed: ") + strerror(errno));
+  }
+}
 
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
-  std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
+void ipc_stream_writer_append(IpcStreamWriter *w, TablePtr *table) {
+  if (!w->file) caml_failwith("writer has already been closed");
 
-  auto reader =
-    arrow::csv::TableReader::Make(arrow::io::default_io_context(),
-                                  infile,
-                                  arrow::csv::ReadOptions::Defaults(),
-                                  arrow::csv::ParseOptions::Defaults(),
-                                  arrow::csv::ConvertOptions::Defaults());
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
-  auto table = ok_exn(reader)->Read();
-  return new std::shared_ptr<arrow::Table>(std::move(table.ValueOrDie()));
+  // The schema is only known once the first table gets appended.
+  if (!w->writer) {
+    auto writer = arrow::ipc::MakeStreamWriter(w->file, (*table)->schema());
+    w->writer = ok_exn(writer);
+  }
+  arrow::Status st = w->writer->WriteTable(**table);
+  status_exn(st);
+  if (w->fsync_policy >= 2) ipc_stream_writer_sync(w);
 
   OCAML_END_PROTECT_EXN
-  return nullptr;
 }
 
-TablePtr *json_read_table(char *filename) {
+void ipc_stream_writer_flush(IpcStreamWriter *w) {
+  if (!w->file) caml_failwith("writer has already been closed");
+
   OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
 
-  auto file = arrow::io::ReadableFile::Open(filename, arrow::default_memory_pool());
-  std::shared_ptr<arrow::io::RandomAccessFile> infile = ok_exn(file);
+  if (w->fsync_policy >= 1) ipc_stream_writer_sync(w);
+  else {
+    arrow::Status st = w->file->Flush();
+    status_exn(st);
+  }
 
-  auto reader_ = arrow::json::TableReader::Make(
-    arrow::default_memory_pool(),
-    infile,
-    arrow::json::ReadOptions::Defaults(),
-    arrow::json::ParseOptions::Defaults());
-  std::shared_ptr<arrow::json::TableReader> reader = ok_exn(reader_);
-  auto table_ = reader->Read();
-  std::shared_ptr<arrow::Table> table = ok_exn(table_);
-  return new std::shared_ptr<arrow::Table>(std::move(table));
+  OCAML_END_PROTECT_EXN
+}
+
+void ipc_stream_writer_close(IpcStreamWriter *w) {
+  if (!w->file) return;
+
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  arrow::Status st;
+  std::shared_ptr<arrow::io::FileOutputStream> file = std::move(w->file);
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer = std::move(w->writer);
+  if (writer) {
+    // Writes the end-of-stream marker.
+    st = writer->Close();
+    status_exn(st);
+  }
+  if (w->fsync_policy >= 1) {
+    if (fsync(file->file_descriptor()) != 0) {
+      throw std::invalid_argument(std::string("fsync failed: ") + strerror(errno));
+    }
+  }
+  st = file->Close();
+  status_exn(st);
 
   OCAML_END_PROTECT_EXN
-  return nullptr;
 }
 
-TablePtr *table_concatenate(TablePtr **tables, int ntables) {
-  OCAML_BEGIN_PROTECT_EXN
+void ipc_stream_writer_free(IpcStreamWriter *w) {
+  if (w->writer) {
+    arrow::Status st = w->writer->Close();
+  }
+  if (w->file) {
+    arrow::Status st = w->file->Close();
+  }
+  delete w;
+}
 
-  std::vector<std::shared_ptr<arrow::Table>> vec;
-  for (int i = 0; i < ntables; ++i) vec.push_back(**(tables+i));
-  auto table = arrow::ConcatenateTables(vec);
+TablePtr *ipc_stream_read_table(char *filename, int io) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::shared_ptr<arrow::io::RandomAccessFile> file = open_random_access(filename, io);
+  auto size_ = file->GetSize();
+  int64_t size = ok_exn(size_);
+  // A failed read that stopped at the end of the file is a partially written
+  // last message, e.g. the writer is still running or has crashed. Any other
+  // failure is an error.
+  auto at_end = [&]() {
+    auto position = file->Tell();
+    return position.ok() && *position == size;
+  };
+  auto reader_ = arrow::ipc::RecordBatchStreamReader::Open(file);
+  if (!reader_.ok() && at_end()) {
+    // The schema has not been fully written yet, i.e. nothing got appended.
+    auto empty = arrow::Table::Make(arrow::schema({}), std::vector<std::shared_ptr<arrow::ChunkedArray>>{}, 0);
+    return new std::shared_ptr<arrow::Table>(std::move(empty));
+  }
+  std::shared_ptr<arrow::ipc::RecordBatchReader> reader = ok_exn(reader_);
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  while (true) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    arrow::Status st = reader->ReadNext(&batch);
+    if (!st.ok() && at_end()) break;
+    status_exn(st);
+    if (batch == nullptr) break;
+    batches.push_back(std::move(batch));
+  }
+  auto table = arrow::Table::FromRecordBatches(reader->schema(), batches);
   return new std::shared_ptr<arrow::Table>(std::move(ok_exn(table)));
 
   OCAML_END_PROTECT_EXN
   return nullptr;
 }
 
-TablePtr *table_slice(TablePtr *table, int64_t offset, int64_t length) {
-  if (offset < 0) caml_invalid_argument("negative offset");
-  if (length < 0) caml_invalid_argument("negative length");
-  auto slice = (*table)->Slice(offset, length);
-  return new std::shared_ptr<arrow::Table>(std::move(slice));
+struct LookupValues {
+  std::unordered_set<int64_t> ints;
+  std::unordered_set<std::string> strings;
+  bool is_int;
+};
+
+// Converts the lookup [values], given in the unit of the arrow column [type],
+// to the unit the parquet column [descr] stores them in, the one used by its
+// statistics and bloom filters. Returns false when the stored unit is unknown
+// or when a value does not fit, neither can be used then. Values that are not
+// a multiple of the stored unit cannot be in the file, truncating them only
+// gives false candidates.
+bool stored_values(const arrow::DataType &type,
+                   const parquet::ColumnDescriptor &descr,
+                   const std::unordered_set<int64_t> &values,
+                   std::vector<int64_t> *out) {
+  StoredUnit unit;
+  if (!stored_unit(type, descr, &unit)) return false;
+  for (int64_t v : values) {
+    int64_t stored;
+    if (!unit.convert(v, &stored)) return false;
+    out->push_back(stored);
+  }
+  return true;
 }
 
-int64_t table_num_rows(TablePtr *table) {
-  if (table != NULL) return (*table)->num_rows();
-  return 0;
+// Checks the row group min/max statistics, returns true when the row group
+// may contain one of [values]. Integer values are checked through
+// [stored_ints], their conversion to the stored unit.
+bool stats_may_contain(const parquet::ColumnChunkMetaData &chunk,
+                       const parquet::ColumnDescriptor &descr,
+                       const LookupValues &values,
+                       const std::vector<int64_t> &stored_ints) {
+  if (!chunk.is_stats_set()) return true;
+  std::shared_ptr<parquet::Statistics> stats = chunk.statistics();
+  if (!stats || !stats->HasMinMax()) return true;
+  if (values.is_int) {
+    if (descr.sort_order() != parquet::SortOrder::SIGNED) return true;
+    int64_t min, max;
+    if (descr.physical_type() == parquet::Type::INT32) {
+      auto int_stats = std::static_pointer_cast<parquet::Int32Statistics>(stats);
+      min = int_stats->min();
+      max = int_stats->max();
+    }
+    else if (descr.physical_type() == parquet::Type::INT64) {
+      auto int_stats = std::static_pointer_cast<parquet::Int64Statistics>(stats);
+      min = int_stats->min();
+      max = int_stats->max();
+    }
+    else return true;
+    for (int64_t v : stored_ints) {
+      if (min <= v && v <= max) return true;
+    }
+    return false;
+  }
+  if (descr.physical_type() != parquet::Type::BYTE_ARRAY
+      || descr.sort_order() != parquet::SortOrder::UNSIGNED) return true;
+  auto str_stats = std::static_pointer_cast<parquet::ByteArrayStatistics>(stats);
+  std::string min((const char*)str_stats->min().ptr, str_stats->min().len);
+  std::string max((const char*)str_stats->max().ptr, str_stats->max().len);
+  for (auto &v : values.strings) {
+    if (min <= v && v <= max) return true;
+  }
+  return false;
 }
 
-struct ArrowSchema *table_schema(TablePtr *table) {
-  std::shared_ptr<arrow::Schema> schema = (*table)->schema();
+TablePtr *parquet_lookup_(char *filename, char *column_name, const LookupValues &values, int *col_idxs, int ncols, int use_threads, int io) {
+  arrow::Status st;
+  std::unique_ptr<parquet::arrow::FileReader> reader = open_parquet(filename, io, use_threads);
+  std::shared_ptr<arrow::Schema> schema;
+  st = reader->GetSchema(&schema);
+  status_exn(st);
+  int field_idx = schema->GetFieldIndex(std::string(column_name));
+  if (field_idx < 0) {
+    throw std::invalid_argument(std::string("cannot find column ") + column_name);
+  }
+  arrow::Type::type id = schema->field(field_idx)->type()->id();
+  if (values.is_int ? int_value_fn(id) == nullptr : !is_binary_like(id)) {
+    throw std::invalid_argument(
+      std::string("cannot lookup ") + (values.is_int ? "int" : "string") + " values in column "
+      + column_name + " of type " + schema->field(field_idx)->type()->ToString());
+  }
+
+  auto metadata = reader->parquet_reader()->metadata();
+  int leaf_idx = metadata->schema()->ColumnIndex(std::string(column_name));
+  std::vector<BloomFilter> filters;
+  auto kv_metadata = metadata->key_value_metadata();
+  if (kv_metadata) {
+    int key_idx = kv_metadata->FindKey(bloom_filter_key_prefix + column_name);
+    if (key_idx >= 0) filters = BloomFilter::deserialize_all(kv_metadata->value(key_idx));
+  }
+  // Only trust the filters if they match the row groups of the file.
+  bool use_filters = (int)filters.size() == metadata->num_row_groups();
+  for (int rg = 0; use_filters && rg < metadata->num_row_groups(); ++rg) {
+    if (filters[rg].num_rows() != metadata->RowGroup(rg)->num_rows()) use_filters = false;
+  }
+
+  // Both the statistics and the filters use the stored unit.
+  std::vector<int64_t> stored_ints;
+  bool use_stats = leaf_idx >= 0
+    && (!values.is_int
+        || stored_values(*schema->field(field_idx)->type(),
+                         *metadata->schema()->Column(leaf_idx),
+                         values.ints,
+                         &stored_ints));
+  use_filters = use_filters && use_stats;
+  std::vector<uint64_t> hashes;
+  for (int64_t v : stored_ints) hashes.push_back(hash_int64(v));
+  if (!values.is_int) {
+    for (auto &v : values.strings) hashes.push_back(hash_bytes(v));
+  }
+  bool has_values = values.is_int ? !values.ints.empty() : !values.strings.empty();
+  std::vector<int> row_groups;
+  for (int rg = 0; rg < metadata->num_row_groups() && has_values; ++rg) {
+    if (use_stats) {
+      auto rg_metadata = metadata->RowGroup(rg);
+      auto chunk_metadata = rg_metadata->ColumnChunk(leaf_idx);
+      if (!stats_may_contain(*chunk_metadata, *metadata->schema()->Column(leaf_idx), values, stored_ints))
+        continue;
+    }
+    if (use_filters) {
+      bool candidate = false;
+      for (uint64_t h : hashes) {
+        if (filters[rg].may_contain(h)) {
+          candidate = true;
+          break;
+        }
+      }
+      if (!candidate) continue;
+    }
+    row_groups.push_back(rg);
+  }
+
+  std::vector<int> columns(col_idxs, col_idxs+ncols);
+  bool drop_key_column =
+    ncols && std::find(columns.begin(), columns.end(), field_idx) == columns.end();
+  if (drop_key_column) columns.push_back(field_idx);
+  std::shared_ptr<arrow::Table> table;
+  if (ncols)
+    st = reader->ReadRowGroups(row_groups, columns, &table);
+  else
+    st = reader->ReadRowGroups(row_groups, &table);
+  status_exn(st);
+
+  // Row groups are candidates, only keep the matching rows.
+  int key_idx = table->schema()->GetFieldIndex(std::string(column_name));
+  auto key_column = table->column(key_idx);
+  IntValueFn int_fn = int_value_fn(id);
+  arrow::BooleanBuilder mask_builder;
+  st = mask_builder.Reserve(table->num_rows());
+  status_exn(st);
+  for (auto &chunk : key_column->chunks()) {
+    int64_t chunk_len = chunk->length();
+    for (int64_t i = 0; i < chunk_len; ++i) {
+      bool keep = false;
+      if (chunk->IsValid(i)) {
+        if (values.is_int)
+          keep = values.ints.count(int_fn(*chunk, i)) > 0;
+        else {
+          auto v = binary_value(*chunk, i);
+          keep = values.strings.count(std::string(v.data(), v.size())) > 0;
+        }
+      }
+      mask_builder.UnsafeAppend(keep);
+    }
+  }
+  std::shared_ptr<arrow::Array> mask;
+  st = mask_builder.Finish(&mask);
+  status_exn(st);
+  auto filtered = arrow::compute::Filter(arrow::Datum(table),
+                                         arrow::Datum(mask),
+                                         arrow::compute::FilterOptions::Defaults(),
+                                         exec_context());
+  table = ok_exn(filtered).table();
+  if (drop_key_column) {
+    auto table_ = table->RemoveColumn(key_idx);
+    table = ok_exn(table_);
+  }
+  return new std::shared_ptr<arrow::Table>(std::move(table));
+}
+
+TablePtr *parquet_lookup_int64(char *filename, char *column_name, int64_t *values, int nvalues, int *col_idxs, int ncols, int use_threads, int io) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  LookupValues lookup_values;
+  lookup_values.is_int = true;
+  lookup_values.ints.insert(values, values + nvalues);
+  return parquet_lookup_(filename, column_name, lookup_values, col_idxs, ncols, use_threads, io);
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+TablePtr *parquet_lookup_utf8(char *filename, char *column_name, char **values, int nvalues, int *col_idxs, int ncols, int use_threads, int io) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  LookupValues lookup_values;
+  lookup_values.is_int = false;
+  for (int i = 0; i < nvalues; ++i) lookup_values.strings.insert(std::string(values[i]));
+  return parquet_lookup_(filename, column_name, lookup_values, col_idxs, ncols, use_threads, io);
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+/* Row sampling.
+   Rows are drawn by their global index, only the row groups containing sampled
+   rows get decoded, one at a time, and the sampled rows are extracted from each
+   with take. Arrow 4/5 cannot skip pages within a row group so row groups are
+   the finest granularity.
+   The std distributions are implementation defined, so numbers are drawn from
+   the mt19937_64 output directly to get the same sample on every platform. */
+
+// Returns a uniform integer in [0, bound), by rejection to avoid modulo bias.
+uint64_t draw_below(std::mt19937_64 &rng, uint64_t bound) {
+  uint64_t threshold = (0 - bound) % bound;
+  while (true) {
+    uint64_t r = rng();
+    if (r >= threshold) return r % bound;
+  }
+}
+
+// Returns a uniform double in [0, 1).
+double draw_unit(std::mt19937_64 &rng) {
+  return (rng() >> 11) * (1. / (1ULL << 53));
+}
+
+std::vector<int64_t> sample_uniform(int64_t num_rows, int64_t n, std::mt19937_64 &rng) {
+  // Floyd's algorithm, n draws without replacement.
+  std::unordered_set<int64_t> selected;
+  for (int64_t j = num_rows - n; j < num_rows; ++j) {
+    int64_t t = draw_below(rng, j + 1);
+    if (!selected.insert(t).second) selected.insert(j);
+  }
+  std::vector<int64_t> rows(selected.begin(), selected.end());
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+// Non-null keys are prefixed so that they cannot collide with the null key.
+std::string stratum_key(const arrow::Array &array, int64_t i, IntValueFn int_fn) {
+  if (array.IsNull(i)) return std::string();
+  std::string key(1, '\1');
+  if (int_fn) {
+    int64_t v = int_fn(array, i);
+    key.append((const char*)&v, sizeof(v));
+  } else {
+    auto v = binary_value(array, i);
+    key.append(v.data(), v.size());
+  }
+  return key;
+}
+
+// Each stratum gets a number of rows proportional to its size, rows being
+// selected within a stratum with selection sampling (Knuth's algorithm S). The
+// key column is read twice, one row group at a time, so that memory usage only
+// depends on the number of strata.
+std::vector<int64_t> sample_stratified(parquet::arrow::FileReader *reader,
+                                       int field_idx,
+                                       int64_t num_rows,
+                                       int64_t n,
+                                       std::mt19937_64 &rng) {
+  struct Stratum {
+    int64_t count = 0;
+    int64_t needed = 0;
+    int64_t seen = 0;
+  };
+  std::unordered_map<std::string, Stratum> strata;
+  arrow::Status st;
+  int num_row_groups = reader->num_row_groups();
+  auto for_each_key = [&](std::function<void(const std::string&)> f) {
+    for (int rg = 0; rg < num_row_groups; ++rg) {
+      std::shared_ptr<arrow::Table> table;
+      st = reader->ReadRowGroup(rg, {field_idx}, &table);
+      status_exn(st);
+      auto column = table->column(0);
+      IntValueFn int_fn = int_value_fn(column->type()->id());
+      if (int_fn == nullptr && !is_binary_like(column->type()->id())) {
+        throw std::invalid_argument("cannot stratify on column of type " + column->type()->ToString());
+      }
+      for (auto &chunk : column->chunks()) {
+        for (int64_t i = 0; i < chunk->length(); ++i) f(stratum_key(*chunk, i, int_fn));
+      }
+    }
+  };
+  for_each_key([&](const std::string &key) { strata[key].count++; });
+  for (auto &kv : strata) {
+    Stratum &s = kv.second;
+    s.needed = std::min(s.count, (int64_t)std::llround((double)n * s.count / num_rows));
+  }
+  std::vector<int64_t> rows;
+  int64_t row = 0;
+  for_each_key([&](const std::string &key) {
+    Stratum &s = strata[key];
+    if (s.needed > 0 && draw_unit(rng) * (s.count - s.seen) < s.needed) {
+      rows.push_back(row);
+      s.needed--;
+    }
+    s.seen++;
+    row++;
+  });
+  return rows;
+}
+
+// Samples [n] rows, or a [fraction] of the rows when [n] is negative. When
+// [stratify_column] is not empty, the rows are sampled per value of this column.
+TablePtr *parquet_sample(char *filename, int *col_idxs, int ncols, int64_t n, double fraction, char *stratify_column, int64_t seed, int use_threads, int io) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  arrow::Status st;
+  std::unique_ptr<parquet::arrow::FileReader> reader = open_parquet(filename, io, use_threads);
+  auto metadata = reader->parquet_reader()->metadata();
+  int64_t num_rows = metadata->num_rows();
+  if (n < 0) {
+    if (fraction < 0. || fraction > 1.)
+      throw std::invalid_argument("fraction has to be between 0 and 1");
+    n = std::llround(fraction * num_rows);
+  }
+  n = std::min(n, num_rows);
+  std::mt19937_64 rng(seed);
+  std::vector<int64_t> rows;
+  if (*stratify_column) {
+    std::shared_ptr<arrow::Schema> schema;
+    st = reader->GetSchema(&schema);
+    status_exn(st);
+    int field_idx = schema->GetFieldIndex(std::string(stratify_column));
+    if (field_idx < 0) {
+      throw std::invalid_argument(std::string("cannot find column ") + stratify_column);
+    }
+    rows = sample_stratified(reader.get(), field_idx, num_rows, n, rng);
+  } else {
+    rows = sample_uniform(num_rows, n, rng);
+  }
+
+  // Only a single decoded row group is alive at a time, next to the rows
+  // already sampled.
+  std::vector<int> columns(col_idxs, col_idxs+ncols);
+  std::vector<std::shared_ptr<arrow::Table>> tables;
+  int64_t rg_start = 0;
+  auto row_it = rows.begin();
+  for (int rg = 0; rg < metadata->num_row_groups() && row_it != rows.end(); ++rg) {
+    int64_t rg_rows = metadata->RowGroup(rg)->num_rows();
+    if (*row_it < rg_start + rg_rows) {
+      arrow::Int64Builder indices_builder;
+      for (; row_it != rows.end() && *row_it < rg_start + rg_rows; ++row_it) {
+        st = indices_builder.Append(*row_it - rg_start);
+        status_exn(st);
+      }
+      std::shared_ptr<arrow::Array> indices;
+      st = indices_builder.Finish(&indices);
+      status_exn(st);
+      std::shared_ptr<arrow::Table> table;
+      if (ncols)
+        st = reader->ReadRowGroup(rg, columns, &table);
+      else
+        st = reader->ReadRowGroup(rg, &table);
+      status_exn(st);
+      auto taken = arrow::compute::Take(arrow::Datum(table),
+                                         arrow::Datum(indices),
+                                         arrow::compute::TakeOptions::Defaults(),
+                                         exec_context());
+      tables.push_back(ok_exn(taken).table());
+    }
+    rg_start += rg_rows;
+  }
+  if (tables.empty()) {
+    // No rows sampled, this only gets the schema of the selected columns.
+    std::shared_ptr<arrow::Table> table;
+    if (ncols)
+      st = reader->ReadRowGroups({}, columns, &table);
+    else
+      st = reader->ReadRowGroups({}, &table);
+    status_exn(st);
+    return new std::shared_ptr<arrow::Table>(std::move(table));
+  }
+  auto table = arrow::ConcatenateTables(tables);
+  return new std::shared_ptr<arrow::Table>(std::move(ok_exn(table)));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// The order has to match the OCaml side.
+enum parquet_parallelism {
+  parallelism_columns = 0,
+  parallelism_row_groups = 1,
+  parallelism_both = 2,
+};
+
+// Decodes disjoint row groups concurrently and assembles them in order. A
+// FileReader cannot be shared between threads so each thread opens its own.
+// These threads are not taken from the arrow pool: with [use_threads] the
+// readers also decode their columns in parallel on that pool, and nesting
+// ParallelFor calls on a single pool can deadlock.
+std::shared_ptr<arrow::Table> parquet_read_row_groups(const char *filename, int io, const std::vector<int> &columns, int use_threads) {
+  std::vector<std::unique_ptr<parquet::arrow::FileReader>> readers;
+  readers.push_back(open_parquet(filename, io, use_threads));
+  int num_row_groups = readers[0]->num_row_groups();
+  std::shared_ptr<arrow::Table> table;
+  if (num_row_groups == 0) {
+    arrow::Status st = columns.empty() ? readers[0]->ReadTable(&table) : readers[0]->ReadTable(columns, &table);
+    status_exn(st);
+    return table;
+  }
+  int num_threads = std::max(1, std::min(num_row_groups, arrow::GetCpuThreadPoolCapacity()));
+  readers.resize(num_threads);
+  std::vector<std::shared_ptr<arrow::Table>> tables(num_row_groups);
+  std::vector<std::exception_ptr> errors(num_threads);
+  std::atomic<int> next_row_group(0);
+  auto work = [&](int thread_idx) {
+    try {
+      auto &reader = readers[thread_idx];
+      if (!reader) reader = open_parquet(filename, io, use_threads);
+      for (int rg = next_row_group++; rg < num_row_groups; rg = next_row_group++) {
+        arrow::Status st = columns.empty()
+          ? reader->ReadRowGroup(rg, &tables[rg])
+          : reader->ReadRowGroup(rg, columns, &tables[rg]);
+        status_exn(st);
+      }
+    } catch (...) {
+      errors[thread_idx] = std::current_exception();
+      // Stops the other threads early.
+      next_row_group = num_row_groups;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int thread_idx = 1; thread_idx < num_threads; ++thread_idx) threads.emplace_back(work, thread_idx);
+  work(0);
+  for (auto &thread : threads) thread.join();
+  for (auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+  auto concatenated = arrow::ConcatenateTables(tables, arrow::ConcatenateTablesOptions::Defaults(), memory_pool());
+  return std::move(ok_exn(concatenated));
+}
+
+TablePtr *parquet_read_table(char *filename, int *col_idxs, int ncols, int use_threads, int64_t only_first, int io, int parallelism) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  if (only_first < 0 && parallelism != parallelism_columns) {
+    std::shared_ptr<arrow::Table> table = parquet_read_row_groups(
+      filename,
+      io,
+      std::vector<int>(col_idxs, col_idxs+ncols),
+      parallelism == parallelism_both);
+    return new std::shared_ptr<arrow::Table>(std::move(table));
+  }
+  arrow::Status st;
+  std::unique_ptr<parquet::arrow::FileReader> reader = open_parquet(filename, io, use_threads);
+  std::shared_ptr<arrow::Table> table;
+  if (only_first < 0) {
+    if (ncols)
+      st = reader->ReadTable(std::vector<int>(col_idxs, col_idxs+ncols), &table);
+    else
+      st = reader->ReadTable(&table);
+    status_exn(st);
+  } else {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+    for (int row_group_idx = 0; row_group_idx < reader->num_row_groups(); ++row_group_idx) {
+      std::unique_ptr<arrow::RecordBatchReader> batch_reader;
+      if (ncols)
+        st = reader->GetRecordBatchReader({row_group_idx}, std::vector<int>(col_idxs, col_idxs+ncols), &batch_reader);
+      else
+        st = reader->GetRecordBatchReader({row_group_idx}, &batch_reader);
+      status_exn(st);
+      std::shared_ptr<arrow::RecordBatch> batch;
+      while (only_first > 0) {
+        st = batch_reader->ReadNext(&batch);
+        status_exn(st);
+        if (batch == nullptr) break;
+        if (only_first <= batch->num_rows()) {
+          batches.push_back(std::move(batch->Slice(0, only_first)));
+          only_first = 0;
+          break;
+        }
+        else {
+          only_first -= batch->num_rows();
+          batches.push_back(std::move(batch));
+        }
+      }
+      if (only_first <= 0)
+        break;
+    }
+    auto table_ = arrow::Table::FromRecordBatches(batches);
+    table = std::move(ok_exn(table_));
+  }
+  return new std::shared_ptr<arrow::Table>(std::move(table));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+TablePtr *feather_read_table(char *filename, int *col_idxs, int ncols, int io) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  arrow::Status st;
+  auto reader = arrow::ipc::feather::Reader::Open(open_random_access(filename, io));
+  std::shared_ptr<arrow::Table> table;
+  if (ncols)
+    st = ok_exn(reader)->Read(std::vector<int>(col_idxs, col_idxs+ncols), &table);
+  else
+    st = ok_exn(reader)->Read(&table);
+  status_exn(st);
+  return new std::shared_ptr<arrow::Table>(std::move(table));
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// Returns the datatype for a format string as used by the C data interface.
+std::shared_ptr<arrow::DataType> type_of_format(const char *format) {
+  struct ArrowSchema c_schema;
+  memset(&c_schema, 0, sizeof(c_schema));
+  c_schema.format = format;
+  c_schema.name = "";
+  c_schema.flags = ARROW_FLAG_NULLABLE;
+  c_schema.release = [](struct ArrowSchema *c_schema) { c_schema->release = nullptr; };
+  auto type = arrow::ImportType(&c_schema);
+  return ok_exn(type);
+}
+
+// Returns the schema given by [ncols] names and formats, nullptr when empty so
+// that the column types get inferred.
+std::shared_ptr<arrow::Schema> schema_of_formats(char **col_names, char **col_formats, int ncols) {
+  if (ncols <= 0) return nullptr;
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  for (int i = 0; i < ncols; ++i)
+    fields.push_back(arrow::field(col_names[i], type_of_format(col_formats[i])));
+  return arrow::schema(fields);
+}
+
+// When [schema] is set, only its columns are read and with its types.
+arrow::csv::ConvertOptions csv_convert_options(const std::shared_ptr<arrow::Schema> &schema) {
+  auto convert_options = arrow::csv::ConvertOptions::Defaults();
+  if (schema) {
+    for (auto &field : schema->fields()) {
+      convert_options.column_types[field->name()] = field->type();
+      convert_options.include_columns.push_back(field->name());
+    }
+  }
+  return convert_options;
+}
+
+TablePtr *csv_read_table(char *filename, int io, char **col_names, char **col_formats, int ncols) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::shared_ptr<arrow::io::RandomAccessFile> infile = open_random_access(filename, io);
+
+  auto reader =
+    arrow::csv::TableReader::Make(arrow::io::IOContext(memory_pool()),
+                                  infile,
+                                  arrow::csv::ReadOptions::Defaults(),
+                                  arrow::csv::ParseOptions::Defaults(),
+                                  csv_convert_options(schema_of_formats(col_names, col_formats, ncols)));
+
+  auto table = ok_exn(reader)->Read();
+  return new std::shared_ptr<arrow::Table>(std::move(table.ValueOrDie()));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+TablePtr *json_read_table(char *filename, int io) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::shared_ptr<arrow::io::RandomAccessFile> infile = open_random_access(filename, io);
+
+  auto reader_ = arrow::json::TableReader::Make(
+    memory_pool(),
+    infile,
+    arrow::json::ReadOptions::Defaults(),
+    arrow::json::ParseOptions::Defaults());
+  std::shared_ptr<arrow::json::TableReader> reader = ok_exn(reader_);
+  auto table_ = reader->Read();
+  std::shared_ptr<arrow::Table> table = ok_exn(table_);
+  return new std::shared_ptr<arrow::Table>(std::move(table));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// Hands record batches from a producer thread over to a consumer, the
+// producer blocks while [capacity] batches are in flight.
+class BatchQueue {
+ public:
+  explicit BatchQueue(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+  // Returns false when the consumer has given up.
+  bool push(std::shared_ptr<arrow::RecordBatch> batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [&] { return cancelled_ || queue_.size() < capacity_; });
+    if (cancelled_) return false;
+    queue_.push_back(std::move(batch));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Marks the end of the stream, [error] gets rethrown by [pop] if set.
+  void finish(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    error_ = error;
+    not_empty_.notify_one();
+  }
+
+  // Returns nullptr once the stream has been fully consumed.
+  std::shared_ptr<arrow::RecordBatch> pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&] { return finished_ || !queue_.empty(); });
+    if (!queue_.empty()) {
+      std::shared_ptr<arrow::RecordBatch> batch = std::move(queue_.front());
+      queue_.pop_front();
+      not_full_.notify_one();
+      return batch;
+    }
+    if (error_) std::rethrow_exception(error_);
+    return nullptr;
+  }
+
+  void cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    not_full_.notify_all();
+  }
+
+ private:
+  size_t capacity_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<std::shared_ptr<arrow::RecordBatch>> queue_;
+  bool finished_ = false;
+  bool cancelled_ = false;
+  std::exception_ptr error_;
+};
+
+void csv_produce(std::shared_ptr<arrow::io::InputStream> infile,
+                 std::shared_ptr<arrow::Schema> schema,
+                 BatchQueue *queue) {
+  auto read_options = arrow::csv::ReadOptions::Defaults();
+  read_options.use_threads = true;
+  auto reader_ =
+    arrow::csv::StreamingReader::Make(arrow::io::IOContext(memory_pool()),
+                                      infile,
+                                      read_options,
+                                      arrow::csv::ParseOptions::Defaults(),
+                                      csv_convert_options(schema));
+  std::shared_ptr<arrow::csv::StreamingReader> reader = ok_exn(reader_);
+  while (true) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    arrow::Status st = reader->ReadNext(&batch);
+    status_exn(st);
+    if (batch == nullptr || !queue->push(std::move(batch))) break;
+  }
+}
+
+// There is no streaming json reader so the newline delimited input gets cut
+// into chunks on line boundaries, the blocks of each chunk being parsed in
+// parallel. The schema inferred on the first chunk is used for the following
+// ones so that all the batches share the same schema.
+void json_produce(std::shared_ptr<arrow::io::InputStream> infile,
+                  std::shared_ptr<arrow::Schema> schema,
+                  BatchQueue *queue) {
+  const int64_t chunk_size = 16 << 20;
+  auto read_options = arrow::json::ReadOptions::Defaults();
+  read_options.use_threads = true;
+  auto parse_options = arrow::json::ParseOptions::Defaults();
+  parse_options.unexpected_field_behavior = arrow::json::UnexpectedFieldBehavior::Ignore;
+  std::shared_ptr<arrow::Buffer> leftover;
+  bool eof = false;
+  while (!eof) {
+    auto buffer_ = infile->Read(chunk_size);
+    std::shared_ptr<arrow::Buffer> buffer = ok_exn(buffer_);
+    eof = buffer->size() < chunk_size;
+    if (leftover && leftover->size() > 0) {
+      auto concatenated = arrow::ConcatenateBuffers({leftover, buffer});
+      buffer = ok_exn(concatenated);
+    }
+    int64_t cut = buffer->size();
+    if (!eof) {
+      const uint8_t *data = buffer->data();
+      while (cut > 0 && data[cut - 1] != '\n') --cut;
+    }
+    leftover = arrow::SliceBuffer(buffer, cut);
+    if (cut == 0) continue;
+    parse_options.explicit_schema = schema;
+    auto reader_ =
+      arrow::json::TableReader::Make(memory_pool(),
+                                     std::make_shared<arrow::io::BufferReader>(arrow::SliceBuffer(buffer, 0, cut)),
+                                     read_options,
+                                     parse_options);
+    std::shared_ptr<arrow::json::TableReader> reader = ok_exn(reader_);
+    auto table_ = reader->Read();
+    std::shared_ptr<arrow::Table> table = ok_exn(table_);
+    if (!schema) schema = table->schema();
+    arrow::TableBatchReader batch_reader(*table);
+    while (true) {
+      std::shared_ptr<arrow::RecordBatch> batch;
+      arrow::Status st = batch_reader.ReadNext(&batch);
+      status_exn(st);
+      if (batch == nullptr) break;
+      if (!queue->push(std::move(batch))) return;
+    }
+  }
+}
+
+/* Converts a csv (format 0) or newline delimited json (format 1) file to
+   parquet without loading it in memory: a producer thread parses the input
+   and hands batches over to the calling thread through a queue holding at
+   most [max_in_flight] batches, these get written as row groups of
+   [row_group_rows] rows. When [ncols] is positive only the given columns are
+   kept, with their types forced to [col_formats].
+   [stats] is filled with the number of rows, of row groups, of bytes read and
+   written, and with the elapsed time in nanoseconds. */
+void convert_to_parquet(char *src,
+                        char *dst,
+                        int format,
+                        char **col_names,
+                        char **col_formats,
+                        int ncols,
+                        int64_t row_group_rows,
+                        int compression,
+                        int max_in_flight,
+                        int64_t *stats) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto start = std::chrono::steady_clock::now();
+  if (row_group_rows <= 0) throw std::invalid_argument("row_group_rows has to be positive");
+  std::shared_ptr<arrow::Schema> schema = schema_of_formats(col_names, col_formats, ncols);
+  auto file = arrow::io::ReadableFile::Open(src, memory_pool());
+  std::shared_ptr<arrow::io::ReadableFile> infile = ok_exn(file);
+  auto size = infile->GetSize();
+  int64_t bytes_read = ok_exn(size);
+  auto file_ = arrow::io::FileOutputStream::Open(dst);
+  std::shared_ptr<arrow::io::FileOutputStream> outfile = ok_exn(file_);
+  auto properties =
+    parquet::WriterProperties::Builder()
+      .version(parquet::ParquetVersion::PARQUET_2_0)
+      ->compression(compression_of_int(compression))
+      ->build();
+
+  BatchQueue queue(max_in_flight);
+  std::thread producer([&queue, format, infile, schema]() {
+    std::exception_ptr error;
+    try {
+      if (format == 0) csv_produce(infile, schema, &queue);
+      else json_produce(infile, schema, &queue);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    queue.finish(error);
+  });
+
+  std::unique_ptr<parquet::arrow::FileWriter> writer;
+  int64_t num_rows = 0, num_row_groups = 0;
+  auto open_writer = [&](const arrow::Schema &schema) {
+    arrow::Status st = parquet::arrow::FileWriter::Open(schema,
+                                                        memory_pool(),
+                                                        outfile,
+                                                        properties,
+                                                        &writer);
+    status_exn(st);
+  };
+  try {
+    std::vector<std::shared_ptr<arrow::RecordBatch>> pending;
+    int64_t pending_rows = 0;
+    // Writes all the full row groups from [pending], or everything when [last].
+    auto write_pending = [&](bool last) {
+      if (pending.empty()) return;
+      auto table_ = arrow::Table::FromRecordBatches(pending);
+      std::shared_ptr<arrow::Table> table = ok_exn(table_);
+      if (!writer) open_writer(*table->schema());
+      int64_t offset = 0;
+      while (pending_rows - offset >= row_group_rows || (last && offset < pending_rows)) {
+        int64_t length = std::min(row_group_rows, pending_rows - offset);
+        arrow::Status st = writer->WriteTable(*table->Slice(offset, length), length);
+        status_exn(st);
+        offset += length;
+        num_row_groups++;
+      }
+      pending.clear();
+      pending_rows -= offset;
+      if (pending_rows > 0) {
+        arrow::TableBatchReader batch_reader(*table->Slice(offset));
+        arrow::Status st = batch_reader.ReadAll(&pending);
+        status_exn(st);
+      }
+    };
+    while (auto batch = queue.pop()) {
+      num_rows += batch->num_rows();
+      pending_rows += batch->num_rows();
+      pending.push_back(std::move(batch));
+      if (pending_rows >= row_group_rows) write_pending(false);
+    }
+    write_pending(true);
+  } catch (...) {
+    queue.cancel();
+    producer.join();
+    throw;
+  }
+  producer.join();
+  if (!writer) {
+    if (!schema) throw std::invalid_argument(std::string("no data in ") + src);
+    open_writer(*schema);
+  }
+  arrow::Status st = writer->Close();
+  status_exn(st);
+  auto position = outfile->Tell();
+  int64_t bytes_written = ok_exn(position);
+  st = outfile->Close();
+  status_exn(st);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  stats[0] = num_rows;
+  stats[1] = num_row_groups;
+  stats[2] = bytes_read;
+  stats[3] = bytes_written;
+  stats[4] = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+  OCAML_END_PROTECT_EXN
+}
+
+/* Csv and newline delimited json writers.
+   The arrow csv writer does not support custom delimiters nor null strings, and
+   there is no json writer, so values get formatted here. Rows are split in
+   ranges that get formatted in parallel and written in order. */
+void append_date(int64_t days, std::string *out) {
+  // civil_from_days from http://howardhinnant.github.io/date_algorithms.html
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  unsigned doe = (unsigned)(days - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t y = (int64_t)yoe + era * 400;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  unsigned d = doy - (153 * mp + 2) / 5 + 1;
+  unsigned m = mp < 10 ? mp + 3 : mp - 9;
+  if (m <= 2) y++;
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%04lld-%02u-%02u", (long long)y, m, d);
+  out->append(buf);
+}
+
+int64_t floor_div(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+// [value] is in units of 10^-[digits] seconds.
+void append_time_of_day(int64_t value, int digits, std::string *out) {
+  int64_t units_per_second = 1;
+  for (int i = 0; i < digits; ++i) units_per_second *= 10;
+  int64_t secs = value / units_per_second;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%02lld:%02lld:%02lld",
+           (long long)(secs / 3600), (long long)(secs / 60 % 60), (long long)(secs % 60));
+  out->append(buf);
+  if (digits > 0) {
+    snprintf(buf, sizeof(buf), ".%0*lld", digits, (long long)(value % units_per_second));
+    out->append(buf);
+  }
+}
+
+void append_timestamp(int64_t value, int digits, std::string *out) {
+  int64_t units_per_day = 86400;
+  for (int i = 0; i < digits; ++i) units_per_day *= 10;
+  int64_t days = floor_div(value, units_per_day);
+  append_date(days, out);
+  out->push_back(' ');
+  append_time_of_day(value - days * units_per_day, digits, out);
+}
+
+int time_unit_digits(arrow::TimeUnit::type unit) {
+  switch (unit) {
+    case arrow::TimeUnit::SECOND: return 0;
+    case arrow::TimeUnit::MILLI: return 3;
+    case arrow::TimeUnit::MICRO: return 6;
+    case arrow::TimeUnit::NANO: return 9;
+  }
+  return 0;
+}
+
+// Shortest representation that reads back to the same value.
+void append_double(double v, std::string *out) {
+  char buf[32];
+  for (int precision = 15; precision <= 17; ++precision) {
+    snprintf(buf, sizeof(buf), "%.*g", precision, v);
+    if (strtod(buf, nullptr) == v) break;
+  }
+  out->append(buf);
+}
+
+void append_json_string(arrow::util::string_view v, std::string *out) {
+  out->push_back('"');
+  for (char c : v) {
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      case '\b': out->append("\\b"); break;
+      case '\f': out->append("\\f"); break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+          out->append(buf);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void append_csv_string(arrow::util::string_view v, const TextOptions &options, std::string *out) {
+  bool quote = options.quoting == 1;
+  if (options.quoting == 0) {
+    const char specials[] = {options.delimiter, '"', '\n', '\r', '\0'};
+    // Quoting also distinguishes strings that would read back as nulls.
+    quote = v.find_first_of(specials) != arrow::util::string_view::npos
+      || v == arrow::util::string_view(options.null_string);
+  }
+  if (!quote) {
+    out->append(v.data(), v.size());
+    return;
+  }
+  out->push_back('"');
+  for (char c : v) {
+    if (c == '"') out->push_back('"');
+    out->push_back(c);
+  }
+  out->push_back('"');
+}
+
+typedef std::function<void(const arrow::Array&, int64_t, std::string*)> ValueFormatter;
+
+template<class ArrayType>
+void append_int(const arrow::Array &array, int64_t i, std::string *out) {
+  out->append(std::to_string(static_cast<const ArrayType&>(array).Value(i)));
+}
+
+// Temporal values are quoted in json.
+ValueFormatter quote_json(ValueFormatter f, const TextOptions &options) {
+  if (options.format != 1) return f;
+  return [f](const arrow::Array &array, int64_t i, std::string *out) {
+    out->push_back('"');
+    f(array, i, out);
+    out->push_back('"');
+  };
+}
+
+ValueFormatter value_formatter(const arrow::DataType &type, const TextOptions &options) {
+  bool json = options.format == 1;
+  switch (type.id()) {
+    case arrow::Type::BOOL:
+      return [](const arrow::Array &array, int64_t i, std::string *out) {
+        out->append(static_cast<const arrow::BooleanArray&>(array).Value(i) ? "true" : "false");
+      };
+    case arrow::Type::INT8: return append_int<arrow::Int8Array>;
+    case arrow::Type::INT16: return append_int<arrow::Int16Array>;
+    case arrow::Type::INT32: return append_int<arrow::Int32Array>;
+    case arrow::Type::INT64: return append_int<arrow::Int64Array>;
+    case arrow::Type::UINT8: return append_int<arrow::UInt8Array>;
+    case arrow::Type::UINT16: return append_int<arrow::UInt16Array>;
+    case arrow::Type::UINT32: return append_int<arrow::UInt32Array>;
+    case arrow::Type::UINT64: return append_int<arrow::UInt64Array>;
+    case arrow::Type::DURATION: return append_int<arrow::DurationArray>;
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE: {
+      bool is_float = type.id() == arrow::Type::FLOAT;
+      return [is_float, json](const arrow::Array &array, int64_t i, std::string *out) {
+        double v = is_float
+          ? static_cast<const arrow::FloatArray&>(array).Value(i)
+          : static_cast<const arrow::DoubleArray&>(array).Value(i);
+        // json has no representation for nans and infinities.
+        if (json && !std::isfinite(v)) out->append("null");
+        else append_double(v, out);
+      };
+    }
+    case arrow::Type::DECIMAL128:
+      return [](const arrow::Array &array, int64_t i, std::string *out) {
+        out->append(static_cast<const arrow::Decimal128Array&>(array).FormatValue(i));
+      };
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+      if (json) {
+        return [](const arrow::Array &array, int64_t i, std::string *out) {
+          append_json_string(binary_value(array, i), out);
+        };
+      }
+      return [options](const arrow::Array &array, int64_t i, std::string *out) {
+        append_csv_string(binary_value(array, i), options, out);
+      };
+    case arrow::Type::DATE32:
+      return quote_json([](const arrow::Array &array, int64_t i, std::string *out) {
+        append_date(static_cast<const arrow::Date32Array&>(array).Value(i), out);
+      }, options);
+    case arrow::Type::DATE64:
+      return quote_json([](const arrow::Array &array, int64_t i, std::string *out) {
+        append_date(floor_div(static_cast<const arrow::Date64Array&>(array).Value(i), 86400000), out);
+      }, options);
+    case arrow::Type::TIME32: {
+      int digits = time_unit_digits(static_cast<const arrow::Time32Type&>(type).unit());
+      return quote_json([digits](const arrow::Array &array, int64_t i, std::string *out) {
+        append_time_of_day(static_cast<const arrow::Time32Array&>(array).Value(i), digits, out);
+      }, options);
+    }
+    case arrow::Type::TIME64: {
+      int digits = time_unit_digits(static_cast<const arrow::Time64Type&>(type).unit());
+      return quote_json([digits](const arrow::Array &array, int64_t i, std::string *out) {
+        append_time_of_day(static_cast<const arrow::Time64Array&>(array).Value(i), digits, out);
+      }, options);
+    }
+    case arrow::Type::TIMESTAMP: {
+      int digits = time_unit_digits(static_cast<const arrow::TimestampType&>(type).unit());
+      return quote_json([digits](const arrow::Array &array, int64_t i, std::string *out) {
+        append_timestamp(static_cast<const arrow::TimestampArray&>(array).Value(i), digits, out);
+      }, options);
+    }
+    case arrow::Type::DICTIONARY: {
+      ValueFormatter f =
+        value_formatter(*static_cast<const arrow::DictionaryType&>(type).value_type(), options);
+      return [f](const arrow::Array &array, int64_t i, std::string *out) {
+        auto &dict_array = static_cast<const arrow::DictionaryArray&>(array);
+        f(*dict_array.dictionary(), dict_array.GetValueIndex(i), out);
+      };
+    }
+    default:
+      throw std::invalid_argument("cannot format values of type " + type.ToString());
+  }
+}
+
+std::string format_rows(const arrow::Table &table,
+                        const std::vector<ValueFormatter> &formatters,
+                        const std::vector<std::string> &json_keys,
+                        const TextOptions &options) {
+  std::string out;
+  bool json = options.format == 1;
+  int ncols = table.num_columns();
+  std::vector<int> chunk_idxs(ncols, 0);
+  std::vector<int64_t> chunk_offsets(ncols, 0);
+  for (int64_t row = 0; row < table.num_rows(); ++row) {
+    if (json) out.push_back('{');
+    for (int col_idx = 0; col_idx < ncols; ++col_idx) {
+      const arrow::ChunkedArray &column = *table.column(col_idx);
+      while (row - chunk_offsets[col_idx] >= column.chunk(chunk_idxs[col_idx])->length()) {
+        chunk_offsets[col_idx] += column.chunk(chunk_idxs[col_idx])->length();
+        chunk_idxs[col_idx]++;
+      }
+      const arrow::Array &chunk = *column.chunk(chunk_idxs[col_idx]);
+      int64_t i = row - chunk_offsets[col_idx];
+      if (json) {
+        if (col_idx) out.push_back(',');
+        out.append(json_keys[col_idx]);
+      } else if (col_idx) {
+        out.push_back(options.delimiter);
+      }
+      if (chunk.IsNull(i)) out.append(json ? "null" : options.null_string);
+      else formatters[col_idx](chunk, i, &out);
+    }
+    out.append(json ? "}\n" : "\n");
+  }
+  return out;
+}
+
+TextWriter *text_writer_open(char *filename, int format, int header, char delimiter, int quoting, char *null_string) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto file = arrow::io::FileOutputStream::Open(filename);
+  TextOptions options{format, header != 0, delimiter, quoting, null_string};
+  return new TextWriter{ok_exn(file), options, false};
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+void text_writer_write(TextWriter *w, TablePtr *table_ptr) {
+  if (!w->file) caml_failwith("writer has already been closed");
+
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::shared_ptr<arrow::Table> table = *table_ptr;
+  const TextOptions &options = w->options;
+  std::vector<ValueFormatter> formatters;
+  std::vector<std::string> json_keys;
+  for (auto &field : table->schema()->fields()) {
+    formatters.push_back(value_formatter(*field->type(), options));
+    std::string key;
+    append_json_string(field->name(), &key);
+    json_keys.push_back(key + ":");
+  }
+  arrow::Status st;
+  if (options.format == 0 && options.header && !w->header_written) {
+    std::string header;
+    for (int col_idx = 0; col_idx < table->num_columns(); ++col_idx) {
+      if (col_idx) header.push_back(options.delimiter);
+      append_csv_string(table->field(col_idx)->name(), options, &header);
+    }
+    header.push_back('\n');
+    st = w->file->Write(header.data(), header.size());
+    status_exn(st);
+  }
+  w->header_written = true;
+
+  // Row ranges are formatted by waves to bound the memory used by the output.
+  const int64_t rows_per_task = 64 * 1024;
+  int64_t num_rows = table->num_rows();
+  int64_t num_tasks = (num_rows + rows_per_task - 1) / rows_per_task;
+  int64_t wave_size = 2 * arrow::GetCpuThreadPoolCapacity();
+  for (int64_t first_task = 0; first_task < num_tasks; first_task += wave_size) {
+    int ntasks = std::min(wave_size, num_tasks - first_task);
+    std::vector<std::string> outputs(ntasks);
+    st = arrow::internal::ParallelFor(ntasks, [&](int task) {
+      auto slice = table->Slice((first_task + task) * rows_per_task, rows_per_task);
+      outputs[task] = format_rows(*slice, formatters, json_keys, options);
+      return arrow::Status::OK();
+    });
+    status_exn(st);
+    for (auto &output : outputs) {
+      st = w->file->Write(output.data(), output.size());
+      status_exn(st);
+    }
+  }
+
+  OCAML_END_PROTECT_EXN
+}
+
+void text_writer_close(TextWriter *w) {
+  if (!w->file) return;
+
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::shared_ptr<arrow::io::FileOutputStream> file = std::move(w->file);
+  arrow::Status st = file->Close();
+  status_exn(st);
+
+  OCAML_END_PROTECT_EXN
+}
+
+void text_writer_free(TextWriter *w) {
+  if (w->file) {
+    arrow::Status st = w->file->Close();
+  }
+  delete w;
+}
+
+TablePtr *table_concatenate(TablePtr **tables, int ntables) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  std::vector<std::shared_ptr<arrow::Table>> vec;
+  for (int i = 0; i < ntables; ++i) vec.push_back(**(tables+i));
+  auto table = arrow::ConcatenateTables(vec, arrow::ConcatenateTablesOptions::Defaults(), memory_pool());
+  return new std::shared_ptr<arrow::Table>(std::move(ok_exn(table)));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+TablePtr *table_slice(TablePtr *table, int64_t offset, int64_t length) {
+  if (offset < 0) caml_invalid_argument("negative offset");
+  if (length < 0) caml_invalid_argument("negative length");
+  auto slice = (*table)->Slice(offset, length);
+  return new std::shared_ptr<arrow::Table>(std::move(slice));
+}
+
+int64_t table_num_rows(TablePtr *table) {
+  if (table != NULL) return (*table)->num_rows();
+  return 0;
+}
+
+struct ArrowSchema *table_schema(TablePtr *table) {
+  std::shared_ptr<arrow::Schema> schema = (*table)->schema();
   struct ArrowSchema *out = (struct ArrowSchema*)malloc(sizeof *out);
   arrow::ExportSchema(*schema, out);
   return out;
 }
 
-void free_table(TablePtr *table) {
-  if (table != NULL)
-    delete table;
+// Arrow computes the schema fingerprint once and caches it, and the batches of
+// a reader share their schema, so this is cheap compared to exporting it.
+int64_t table_schema_fingerprint(TablePtr *table) {
+  std::shared_ptr<arrow::Schema> schema = (*table)->schema();
+  const std::string &fingerprint = schema->fingerprint();
+  // Some extension types cannot be fingerprinted.
+  size_t hash = fingerprint.empty()
+    ? std::hash<std::string>()(schema->ToString(true))
+    : std::hash<std::string>()(fingerprint);
+  // Fits in an OCaml int.
+  return (int64_t)(hash & 0x3fffffffffffffffULL);
+}
+
+void free_table(TablePtr *table) {
+  if (table != NULL)
+    delete table;
+}
+
+// Returns the column given by index, or by name when [column_idx] is negative.
+std::shared_ptr<arrow::ChunkedArray> find_column(const arrow::Table &table, const char *column_name, int column_idx) {
+  if (column_idx >= 0) {
+    if (column_idx >= table.num_columns()) {
+      throw std::invalid_argument("invalid column index " + std::to_string(column_idx));
+    }
+    return table.column(column_idx);
+  }
+  auto array = table.GetColumnByName(std::string(column_name));
+  if (!array) {
+    throw std::invalid_argument(std::string("cannot find column ") + column_name);
+  }
+  return array;
+}
+
+// Calls [f] in parallel on ranges of rows of [array], with the chunk, the
+// range start within this chunk, the range start within [array] and the
+// range length. Ranges of a same task are consecutive and task bounds are
+// multiples of [rows_per_task], so tasks can write to separate bytes of an
+// output bitmap.
+const int64_t rows_per_task = 64 * 1024;
+
+template<class F>
+void parallel_for_row_ranges(const arrow::ChunkedArray &array, F f) {
+  std::vector<int64_t> chunk_offsets = {0};
+  for (auto &chunk : array.chunks()) chunk_offsets.push_back(chunk_offsets.back() + chunk->length());
+  int64_t num_rows = array.length();
+  int64_t num_tasks = (num_rows + rows_per_task - 1) / rows_per_task;
+  arrow::Status st = arrow::internal::ParallelFor(num_tasks, [&](int task) {
+    int64_t start = task * rows_per_task;
+    int64_t end = std::min(start + rows_per_task, num_rows);
+    size_t chunk_idx = std::upper_bound(chunk_offsets.begin(), chunk_offsets.end(), start) - chunk_offsets.begin() - 1;
+    // Exceptions cannot cross the thread pool.
+    try {
+      for (int64_t row = start; row < end; ++chunk_idx) {
+        int64_t chunk_end = std::min(end, chunk_offsets[chunk_idx + 1]);
+        if (chunk_end > row) {
+          f(*array.chunk(chunk_idx), row - chunk_offsets[chunk_idx], row, chunk_end - row);
+        }
+        row = chunk_end;
+      }
+    } catch (const std::exception &e) {
+      return arrow::Status::Invalid(e.what());
+    }
+    return arrow::Status::OK();
+  });
+  status_exn(st);
+}
+
+/* Utf8 kernels.
+   These work directly on the offsets and data buffers of the string chunks,
+   in parallel over ranges of rows. */
+
+// Calls [f] on each row of the utf8 column [array] with the row index and a
+// pointer to the value and its length, [ptr] is null for null values.
+template<class F>
+void utf8_for_each_parallel(const arrow::ChunkedArray &array, F f) {
+  if (array.type()->id() != arrow::Type::STRING) {
+    throw std::invalid_argument("not a utf8 column: " + array.type()->ToString());
+  }
+  parallel_for_row_ranges(array, [&](const arrow::Array &chunk_, int64_t i, int64_t row, int64_t length) {
+    auto &chunk = static_cast<const arrow::StringArray&>(chunk_);
+    const int32_t *offsets = chunk.raw_value_offsets();
+    const char *data = (const char*)chunk.raw_data();
+    for (int64_t end = row + length; row < end; ++row, ++i) {
+      if (chunk.IsNull(i)) f(row, nullptr, 0);
+      else f(row, data + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+  });
+}
+
+template<class P>
+void utf8_mask(const arrow::ChunkedArray &array, uint8_t *out, P predicate) {
+  memset(out, 0, (array.length() + 7) / 8);
+  utf8_for_each_parallel(array, [&](int64_t row, const char *ptr, int32_t len) {
+    if (ptr != nullptr && predicate(ptr, len)) arrow::BitUtil::SetBit(out, row);
+  });
+}
+
+struct StringViewHash {
+  size_t operator()(arrow::util::string_view v) const { return hash_bytes(v); }
+};
+
+// Writes in [out] the bitmap of the rows whose value satisfies the predicate
+// [kind] on [values]: equal, starts with, ends with, contains, matches the
+// regex or, for [kind] 5, is one of [values]. Null rows are not selected.
+void utf8_predicate(TablePtr *table, char *column_name, int column_idx, int kind, char **values, int nvalues, uint8_t *out) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto array = find_column(**table, column_name, column_idx);
+  if (nvalues < 1 && kind != 5) throw std::invalid_argument("no value to compare to");
+  std::string value(nvalues ? values[0] : "");
+  const char *v = value.data();
+  int32_t vlen = value.size();
+  if (kind == 0) {
+    utf8_mask(*array, out, [&](const char *ptr, int32_t len) {
+      return len == vlen && memcmp(ptr, v, len) == 0;
+    });
+  }
+  else if (kind == 1) {
+    utf8_mask(*array, out, [&](const char *ptr, int32_t len) {
+      return len >= vlen && memcmp(ptr, v, vlen) == 0;
+    });
+  }
+  else if (kind == 2) {
+    utf8_mask(*array, out, [&](const char *ptr, int32_t len) {
+      return len >= vlen && memcmp(ptr + len - vlen, v, vlen) == 0;
+    });
+  }
+  else if (kind == 3) {
+    utf8_mask(*array, out, [&](const char *ptr, int32_t len) {
+      return memmem(ptr, len, v, vlen) != nullptr;
+    });
+  }
+  else if (kind == 4) {
+    std::regex re;
+    try {
+      re = std::regex(value, std::regex::ECMAScript | std::regex::optimize);
+    } catch (const std::regex_error &e) {
+      throw std::invalid_argument(std::string("invalid regex ") + value + ": " + e.what());
+    }
+    utf8_mask(*array, out, [&](const char *ptr, int32_t len) {
+      return std::regex_search(ptr, ptr + len, re);
+    });
+  }
+  else if (kind == 5) {
+    std::unordered_set<arrow::util::string_view, StringViewHash> set;
+    for (int i = 0; i < nvalues; ++i) set.insert(arrow::util::string_view(values[i]));
+    utf8_mask(*array, out, [&](const char *ptr, int32_t len) {
+      return set.count(arrow::util::string_view(ptr, len)) > 0;
+    });
+  }
+  else {
+    throw std::invalid_argument("unknown utf8 predicate " + std::to_string(kind));
+  }
+
+  OCAML_END_PROTECT_EXN
+}
+
+// Writes in [out] the number of code points of each value, 0 for nulls.
+void utf8_length(TablePtr *table, char *column_name, int column_idx, int32_t *out) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto array = find_column(**table, column_name, column_idx);
+  utf8_for_each_parallel(*array, [&](int64_t row, const char *ptr, int32_t len) {
+    int32_t n = 0;
+    // Counts the bytes that are not continuation bytes.
+    for (int32_t i = 0; i < len; ++i) n += (ptr[i] & 0xC0) != 0x80;
+    out[row] = n;
+  });
+
+  OCAML_END_PROTECT_EXN
+}
+
+// Keeps the rows set in the [mask] bitmap, which has [length] bits.
+TablePtr *table_filter(TablePtr *table, uint8_t *mask, int64_t length) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  if (length != (*table)->num_rows()) {
+    throw std::invalid_argument("mask length " + std::to_string(length) + " differs from the number of rows "
+                                + std::to_string((*table)->num_rows()));
+  }
+  auto buffer_ = arrow::AllocateBuffer((length + 7) / 8, memory_pool());
+  std::shared_ptr<arrow::Buffer> buffer = ok_exn(buffer_);
+  memcpy(buffer->mutable_data(), mask, buffer->size());
+  auto mask_array = std::make_shared<arrow::BooleanArray>(length, buffer);
+  auto filtered = arrow::compute::Filter(arrow::Datum(*table),
+                                         arrow::Datum(mask_array),
+                                         arrow::compute::FilterOptions::Defaults(),
+                                         exec_context());
+  return new std::shared_ptr<arrow::Table>(ok_exn(filtered).table());
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+/* Row hashing.
+   The hash of a row combines the hashes of its values in the given column
+   order. Integer like values are widened to int64 before hashing so that e.g.
+   int32 and int64 keys with the same values give the same row hashes. The seed
+   is fixed so hashes are stable across processes. */
+const uint64_t null_hash = XXH_PRIME64_5;
+
+inline uint64_t hash_combine(uint64_t h, uint64_t v) {
+  return xxh_rotl64(h ^ (v * XXH_PRIME64_2), 31) * XXH_PRIME64_1;
+}
+
+inline uint64_t hash_double(double v) {
+  // -0.0 and 0.0 compare equal, all the nans are considered equal.
+  if (v == 0) v = 0;
+  if (std::isnan(v)) v = NAN;
+  int64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return hash_int64(bits);
+}
+
+// Combines the hashes of the [length] values of [chunk] starting at [offset]
+// into [out].
+void combine_hashes(const arrow::Array &chunk, int64_t offset, int64_t length, uint64_t *out) {
+  arrow::Type::type id = chunk.type_id();
+  IntValueFn int_fn = int_value_fn(id);
+  auto combine = [&](auto value_hash) {
+    if (chunk.null_count() == 0) {
+      for (int64_t i = 0; i < length; ++i) out[i] = hash_combine(out[i], value_hash(offset + i));
+    } else {
+      for (int64_t i = 0; i < length; ++i) {
+        uint64_t h = chunk.IsNull(offset + i) ? null_hash : value_hash(offset + i);
+        out[i] = hash_combine(out[i], h);
+      }
+    }
+  };
+  if (id == arrow::Type::INT64) {
+    const int64_t *values = static_cast<const arrow::Int64Array&>(chunk).raw_values();
+    combine([&](int64_t i) { return hash_int64(values[i]); });
+  }
+  else if (id == arrow::Type::INT32) {
+    const int32_t *values = static_cast<const arrow::Int32Array&>(chunk).raw_values();
+    combine([&](int64_t i) { return hash_int64(values[i]); });
+  }
+  else if (int_fn) {
+    combine([&](int64_t i) { return hash_int64(int_fn(chunk, i)); });
+  }
+  else if (id == arrow::Type::DOUBLE) {
+    const double *values = static_cast<const arrow::DoubleArray&>(chunk).raw_values();
+    combine([&](int64_t i) { return hash_double(values[i]); });
+  }
+  else if (id == arrow::Type::FLOAT) {
+    const float *values = static_cast<const arrow::FloatArray&>(chunk).raw_values();
+    combine([&](int64_t i) { return hash_double(values[i]); });
+  }
+  else if (id == arrow::Type::BOOL) {
+    auto &array = static_cast<const arrow::BooleanArray&>(chunk);
+    combine([&](int64_t i) { return hash_int64(array.Value(i)); });
+  }
+  else if (is_binary_like(id)) {
+    combine([&](int64_t i) { return hash_bytes(binary_value(chunk, i)); });
+  }
+  else {
+    throw std::invalid_argument("cannot hash values of type " + chunk.type()->ToString());
+  }
+}
+
+// Returns the columns given by name, or by index when the index is not
+// negative.
+std::vector<std::shared_ptr<arrow::ChunkedArray>> find_columns(const arrow::Table &table, char **col_names, int *col_idxs, int ncols) {
+  std::vector<std::shared_ptr<arrow::ChunkedArray>> columns;
+  for (int i = 0; i < ncols; ++i) columns.push_back(find_column(table, col_names[i], col_idxs[i]));
+  return columns;
+}
+
+void hash_rows(const arrow::Table &table, const std::vector<std::shared_ptr<arrow::ChunkedArray>> &columns, uint64_t *out) {
+  int64_t num_rows = table.num_rows();
+  std::fill(out, out + num_rows, XXH_PRIME64_3);
+  for (auto &column : columns) {
+    parallel_for_row_ranges(*column, [&](const arrow::Array &chunk, int64_t i, int64_t row, int64_t length) {
+      combine_hashes(chunk, i, length, out + row);
+    });
+  }
+}
+
+// Writes in [out] the hash of each row over the given columns.
+void table_hash_rows(TablePtr *table, char **col_names, int *col_idxs, int ncols, int64_t *out) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto columns = find_columns(**table, col_names, col_idxs, ncols);
+  hash_rows(**table, columns, (uint64_t*)out);
+
+  OCAML_END_PROTECT_EXN
+}
+
+// Splits [table] in [n] tables according to the hash of the given columns,
+// the tables are written in [out]. Rows keep their relative order.
+void table_partition_by_hash(TablePtr *table, char **col_names, int *col_idxs, int ncols, int n, TablePtr **out) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  if (n <= 0) throw std::invalid_argument("the number of partitions has to be positive");
+  auto columns = find_columns(**table, col_names, col_idxs, ncols);
+  int64_t num_rows = (*table)->num_rows();
+  std::vector<uint64_t> hashes(num_rows);
+  hash_rows(**table, columns, hashes.data());
+  std::vector<int64_t> counts(n, 0);
+  for (int64_t row = 0; row < num_rows; ++row) {
+    hashes[row] %= n;
+    counts[hashes[row]]++;
+  }
+  std::vector<std::shared_ptr<arrow::Int64Builder>> builders;
+  for (int p = 0; p < n; ++p) {
+    builders.push_back(std::make_shared<arrow::Int64Builder>(memory_pool()));
+    arrow::Status st = builders[p]->Reserve(counts[p]);
+    status_exn(st);
+  }
+  for (int64_t row = 0; row < num_rows; ++row) builders[hashes[row]]->UnsafeAppend(row);
+  std::vector<std::shared_ptr<arrow::Table>> tables(n);
+  arrow::Status st = arrow::internal::ParallelFor(n, [&](int p) {
+    std::shared_ptr<arrow::Array> indices;
+    ARROW_RETURN_NOT_OK(builders[p]->Finish(&indices));
+    ARROW_ASSIGN_OR_RAISE(arrow::Datum taken,
+                          arrow::compute::Take(arrow::Datum(*table),
+                                               arrow::Datum(indices),
+                                               arrow::compute::TakeOptions::Defaults(),
+                                               exec_context()));
+    tables[p] = taken.table();
+    return arrow::Status::OK();
+  });
+  status_exn(st);
+  for (int p = 0; p < n; ++p) out[p] = new std::shared_ptr<arrow::Table>(std::move(tables[p]));
+
+  OCAML_END_PROTECT_EXN
+}
+
+/* Distinct rows and groups.
+   Rows are deduplicated with an open addressing set of row indexes keyed by
+   the row hashes, rows that share a hash are compared value by value. */
+
+// Random access to the values of a chunked array by row.
+struct RowLocator {
+  const arrow::ChunkedArray *array;
+  std::vector<int64_t> chunk_offsets;
+
+  explicit RowLocator(const arrow::ChunkedArray &array_) : array(&array_), chunk_offsets({0}) {
+    for (auto &chunk : array_.chunks()) chunk_offsets.push_back(chunk_offsets.back() + chunk->length());
+  }
+
+  std::pair<const arrow::Array*, int64_t> locate(int64_t row) const {
+    size_t chunk_idx = std::upper_bound(chunk_offsets.begin(), chunk_offsets.end(), row) - chunk_offsets.begin() - 1;
+    return std::make_pair(array->chunk(chunk_idx).get(), row - chunk_offsets[chunk_idx]);
+  }
+};
+
+// Value equality consistent with [combine_hashes]: nulls are equal to each
+// other, -0.0 and 0.0 are equal as are all the nans.
+bool values_equal(const arrow::Array &a, int64_t i, const arrow::Array &b, int64_t j) {
+  bool a_null = a.IsNull(i), b_null = b.IsNull(j);
+  if (a_null || b_null) return a_null && b_null;
+  arrow::Type::type id = a.type_id();
+  if (IntValueFn int_fn = int_value_fn(id)) return int_fn(a, i) == int_fn(b, j);
+  auto floats_equal = [](double x, double y) { return x == y || (std::isnan(x) && std::isnan(y)); };
+  if (id == arrow::Type::DOUBLE) {
+    return floats_equal(static_cast<const arrow::DoubleArray&>(a).Value(i),
+                        static_cast<const arrow::DoubleArray&>(b).Value(j));
+  }
+  if (id == arrow::Type::FLOAT) {
+    return floats_equal(static_cast<const arrow::FloatArray&>(a).Value(i),
+                        static_cast<const arrow::FloatArray&>(b).Value(j));
+  }
+  if (id == arrow::Type::BOOL) {
+    return static_cast<const arrow::BooleanArray&>(a).Value(i) == static_cast<const arrow::BooleanArray&>(b).Value(j);
+  }
+  if (is_binary_like(id)) return binary_value(a, i) == binary_value(b, j);
+  throw std::invalid_argument("cannot compare values of type " + a.type()->ToString());
+}
+
+// Set of the rows of a table with distinct values over some columns. This
+// uses up to 30 bytes per row of the table.
+class RowSet {
+ public:
+  RowSet(const arrow::Table &table, const std::vector<std::shared_ptr<arrow::ChunkedArray>> &columns)
+    : hashes_(table.num_rows()), capacity_(16) {
+    hash_rows(table, columns, hashes_.data());
+    for (auto &column : columns) locators_.emplace_back(*column);
+    // The set is kept at most 3/4 full.
+    while (capacity_ * 3 < (uint64_t)table.num_rows() * 4) capacity_ *= 2;
+    slots_.assign(capacity_, -1);
+  }
+
+  // Returns the row of the set with the same values as [row], [row] is added
+  // to the set and returned when there is none.
+  int64_t find_or_insert(int64_t row) {
+    uint64_t slot = hashes_[row] & (capacity_ - 1);
+    while (true) {
+      int64_t other = slots_[slot];
+      if (other < 0) {
+        slots_[slot] = row;
+        return row;
+      }
+      if (hashes_[other] == hashes_[row] && rows_equal(row, other)) return other;
+      slot = (slot + 1) & (capacity_ - 1);
+    }
+  }
+
+ private:
+  bool rows_equal(int64_t row, int64_t other) const {
+    for (auto &locator : locators_) {
+      auto a = locator.locate(row);
+      auto b = locator.locate(other);
+      if (!values_equal(*a.first, a.second, *b.first, b.second)) return false;
+    }
+    return true;
+  }
+
+  std::vector<uint64_t> hashes_;
+  std::vector<RowLocator> locators_;
+  uint64_t capacity_;
+  std::vector<int64_t> slots_;
+};
+
+// Writes in [group_ids] the group of each row over [columns], groups are
+// numbered by order of first appearance. Returns the number of groups.
+int64_t group_ids(const arrow::Table &table, const std::vector<std::shared_ptr<arrow::ChunkedArray>> &columns, std::vector<int64_t> &group_ids) {
+  int64_t num_rows = table.num_rows();
+  group_ids.resize(num_rows);
+  if (columns.empty()) {
+    std::fill(group_ids.begin(), group_ids.end(), 0);
+    return num_rows > 0 ? 1 : 0;
+  }
+  RowSet set(table, columns);
+  int64_t num_groups = 0;
+  for (int64_t row = 0; row < num_rows; ++row) {
+    int64_t first = set.find_or_insert(row);
+    group_ids[row] = first == row ? num_groups++ : group_ids[first];
+  }
+  return num_groups;
+}
+
+// Returns the rows of [table] with distinct values over the given columns, or
+// over all the columns when [ncols] is 0. The first row of each key is kept,
+// or the last one when [keep_last] is set. Rows keep their relative order.
+TablePtr *table_distinct(TablePtr *table, char **col_names, int *col_idxs, int ncols, int keep_last) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto columns = ncols > 0 ? find_columns(**table, col_names, col_idxs, ncols) : (*table)->columns();
+  int64_t num_rows = (*table)->num_rows();
+  auto keep_ = arrow::AllocateBuffer((num_rows + 7) / 8, memory_pool());
+  std::shared_ptr<arrow::Buffer> keep = ok_exn(keep_);
+  uint8_t *keep_bits = keep->mutable_data();
+  memset(keep_bits, 0, keep->size());
+  int64_t num_kept = 0;
+  {
+    RowSet set(**table, columns);
+    for (int64_t k = 0; k < num_rows; ++k) {
+      int64_t row = keep_last ? num_rows - 1 - k : k;
+      if (set.find_or_insert(row) == row) {
+        arrow::BitUtil::SetBit(keep_bits, row);
+        num_kept++;
+      }
+    }
+  }
+  if (num_kept == num_rows) return new std::shared_ptr<arrow::Table>(*table);
+
+  auto mask_array = std::make_shared<arrow::BooleanArray>(num_rows, keep);
+  auto filtered = arrow::compute::Filter(arrow::Datum(*table),
+                                         arrow::Datum(mask_array),
+                                         arrow::compute::FilterOptions::Defaults(),
+                                         exec_context());
+  return new std::shared_ptr<arrow::Table>(ok_exn(filtered).table());
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+/* Top-k selection.
+   Each task keeps a bounded heap of its best rows, so selecting k rows out of
+   n is O(n log k) and only the selected rows get materialized. Nulls and nans
+   are never selected, ties are broken by row order. */
+
+template<class A>
+double float_value(const arrow::Array &array, int64_t i) {
+  return static_cast<double>(static_cast<const A&>(array).Value(i));
+}
+
+typedef double (*FloatValueFn)(const arrow::Array&, int64_t);
+
+FloatValueFn float_value_fn(arrow::Type::type id) {
+  switch (id) {
+    case arrow::Type::DOUBLE: return float_value<arrow::DoubleArray>;
+    case arrow::Type::FLOAT: return float_value<arrow::FloatArray>;
+    default: return nullptr;
+  }
+}
+
+template<class T>
+struct TopKHeap {
+  typedef std::pair<T, int64_t> Entry;
+  size_t k;
+  bool smallest;
+  std::vector<Entry> entries;
+
+  // Returns true when [a] ranks before [b], the heap top is the worst entry.
+  bool better(const Entry &a, const Entry &b) const {
+    if (a.first != b.first) return smallest ? a.first < b.first : a.first > b.first;
+    return a.second < b.second;
+  }
+
+  void push(T value, int64_t row) {
+    auto cmp = [this](const Entry &a, const Entry &b) { return better(a, b); };
+    Entry entry(value, row);
+    if (entries.size() < k) {
+      entries.push_back(entry);
+      std::push_heap(entries.begin(), entries.end(), cmp);
+    }
+    else if (better(entry, entries.front())) {
+      std::pop_heap(entries.begin(), entries.end(), cmp);
+      entries.back() = entry;
+      std::push_heap(entries.begin(), entries.end(), cmp);
+    }
+  }
+
+  // Appends the rows of the heap to [rows], best first.
+  void append_sorted(std::vector<int64_t> &rows) {
+    std::sort(entries.begin(), entries.end(), [this](const Entry &a, const Entry &b) { return better(a, b); });
+    for (auto &entry : entries) rows.push_back(entry.second);
+  }
+};
+
+template<class F>
+void for_each_ranked_value_(const arrow::Array &chunk, int64_t i, int64_t row, int64_t length, int64_t *, F f) {
+  IntValueFn int_fn = int_value_fn(chunk.type_id());
+  const int64_t *values = chunk.type_id() == arrow::Type::INT64
+    ? static_cast<const arrow::Int64Array&>(chunk).raw_values() : nullptr;
+  for (int64_t end = row + length; row < end; ++row, ++i) {
+    if (chunk.IsNull(i)) continue;
+    f(row, values ? values[i] : int_fn(chunk, i));
+  }
+}
+
+// uint64 values do not fit in an int64, they are ranked as they are.
+template<class F>
+void for_each_ranked_value_(const arrow::Array &chunk, int64_t i, int64_t row, int64_t length, uint64_t *, F f) {
+  const uint64_t *values = static_cast<const arrow::UInt64Array&>(chunk).raw_values();
+  for (int64_t end = row + length; row < end; ++row, ++i) {
+    if (chunk.IsNull(i)) continue;
+    f(row, values[i]);
+  }
+}
+
+template<class F>
+void for_each_ranked_value_(const arrow::Array &chunk, int64_t i, int64_t row, int64_t length, double *, F f) {
+  FloatValueFn float_fn = float_value_fn(chunk.type_id());
+  for (int64_t end = row + length; row < end; ++row, ++i) {
+    if (chunk.IsNull(i)) continue;
+    double value = float_fn(chunk, i);
+    if (!std::isnan(value)) f(row, value);
+  }
+}
+
+// Calls [f] with the row index and value converted to [T] of the [length]
+// rows of [chunk] starting at [i], skipping nulls and nans. [row] is the index
+// of the first of these rows.
+template<class T, class F>
+void for_each_ranked_value(const arrow::Array &chunk, int64_t i, int64_t row, int64_t length, F f) {
+  for_each_ranked_value_(chunk, i, row, length, (T*)nullptr, f);
+}
+
+template<class T>
+std::vector<int64_t> top_k_rows(const arrow::ChunkedArray &column, int64_t k, bool smallest) {
+  int64_t num_tasks = (column.length() + rows_per_task - 1) / rows_per_task;
+  std::vector<TopKHeap<T>> heaps(num_tasks, TopKHeap<T>{(size_t)k, smallest, {}});
+  parallel_for_row_ranges(column, [&](const arrow::Array &chunk, int64_t i, int64_t row, int64_t length) {
+    TopKHeap<T> &heap = heaps[row / rows_per_task];
+    for_each_ranked_value<T>(chunk, i, row, length, [&](int64_t row, T value) { heap.push(value, row); });
+  });
+  TopKHeap<T> merged{(size_t)k, smallest, {}};
+  for (auto &heap : heaps) {
+    for (auto &entry : heap.entries) merged.push(entry.first, entry.second);
+  }
+  std::vector<int64_t> rows;
+  merged.append_sorted(rows);
+  return rows;
+}
+
+template<class T>
+std::vector<int64_t> top_k_rows_by_group(const arrow::ChunkedArray &column, int64_t k, bool smallest,
+                                         const std::vector<int64_t> &group_ids, int64_t num_groups) {
+  // Each task scans its own range of rows with a heap per group it sees, the
+  // heaps of a group are then merged across tasks.
+  int64_t num_tasks = (column.length() + rows_per_task - 1) / rows_per_task;
+  std::vector<std::unordered_map<int64_t, TopKHeap<T>>> task_heaps(num_tasks);
+  parallel_for_row_ranges(column, [&](const arrow::Array &chunk, int64_t i, int64_t row, int64_t length) {
+    auto &heaps = task_heaps[row / rows_per_task];
+    for_each_ranked_value<T>(chunk, i, row, length, [&](int64_t row, T value) {
+      auto it = heaps.find(group_ids[row]);
+      if (it == heaps.end())
+        it = heaps.emplace(group_ids[row], TopKHeap<T>{(size_t)k, smallest, {}}).first;
+      it->second.push(value, row);
+    });
+  });
+  std::vector<TopKHeap<T>> heaps(num_groups, TopKHeap<T>{(size_t)k, smallest, {}});
+  for (auto &task : task_heaps) {
+    for (auto &kv : task) {
+      TopKHeap<T> &heap = heaps[kv.first];
+      if (heap.entries.empty()) heap.entries = std::move(kv.second.entries);
+      else for (auto &entry : kv.second.entries) heap.push(entry.first, entry.second);
+    }
+    task.clear();
+  }
+  std::vector<int64_t> rows;
+  for (auto &heap : heaps) heap.append_sorted(rows);
+  return rows;
+}
+
+// Returns the [k] rows with the largest values in the given column, or the
+// smallest ones when [smallest] is set, best first. When [ngroup_cols] is
+// positive, [k] rows are selected for each group of rows with the same values
+// in the group columns, groups come in order of first appearance.
+TablePtr *table_top_k(TablePtr *table, char *column_name, int column_idx, int64_t k, int smallest,
+                      char **group_names, int *group_idxs, int ngroup_cols) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  if (k <= 0) throw std::invalid_argument("k has to be positive");
+  auto column = find_column(**table, column_name, column_idx);
+  arrow::Type::type id = column->type()->id();
+  bool is_float = float_value_fn(id) != nullptr;
+  if (!is_float && int_value_fn(id) == nullptr) {
+    throw std::invalid_argument("cannot rank values of type " + column->type()->ToString());
+  }
+  std::vector<int64_t> rows;
+  if (ngroup_cols > 0) {
+    auto group_columns = find_columns(**table, group_names, group_idxs, ngroup_cols);
+    std::vector<int64_t> ids;
+    int64_t num_groups = group_ids(**table, group_columns, ids);
+    if (is_float) rows = top_k_rows_by_group<double>(*column, k, smallest, ids, num_groups);
+    else if (id == arrow::Type::UINT64) rows = top_k_rows_by_group<uint64_t>(*column, k, smallest, ids, num_groups);
+    else rows = top_k_rows_by_group<int64_t>(*column, k, smallest, ids, num_groups);
+  }
+  else {
+    if (is_float) rows = top_k_rows<double>(*column, k, smallest);
+    else if (id == arrow::Type::UINT64) rows = top_k_rows<uint64_t>(*column, k, smallest);
+    else rows = top_k_rows<int64_t>(*column, k, smallest);
+  }
+  arrow::Int64Builder builder(memory_pool());
+  arrow::Status st = builder.AppendValues(rows);
+  status_exn(st);
+  std::shared_ptr<arrow::Array> indices;
+  st = builder.Finish(&indices);
+  status_exn(st);
+  auto taken = arrow::compute::Take(arrow::Datum(*table),
+                                    arrow::Datum(indices),
+                                    arrow::compute::TakeOptions::Defaults(),
+                                    exec_context());
+  return new std::shared_ptr<arrow::Table>(ok_exn(taken).table());
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+/* Rolling windows.
+   The rows of each group are processed in order with a running sum and count
+   for sums and means and a monotonic deque for mins and maxs, so each row is
+   added and removed once whatever the window size. */
+
+// Aggregations, the order has to match the OCaml side.
+enum rolling_agg {
+  rolling_sum = 0,
+  rolling_mean = 1,
+  rolling_min = 2,
+  rolling_max = 3,
+  rolling_count = 4,
+};
+
+// Copies the values of a numeric column as doubles, nulls become nans.
+std::vector<double> column_doubles(const arrow::ChunkedArray &column) {
+  arrow::Type::type id = column.type()->id();
+  IntValueFn int_fn = int_value_fn(id);
+  FloatValueFn float_fn = float_value_fn(id);
+  if (int_fn == nullptr && float_fn == nullptr) {
+    throw std::invalid_argument("cannot aggregate values of type " + column.type()->ToString());
+  }
+  std::vector<double> values(column.length());
+  parallel_for_row_ranges(column, [&](const arrow::Array &chunk, int64_t i, int64_t row, int64_t length) {
+    for (int64_t end = row + length; row < end; ++row, ++i) {
+      if (chunk.IsNull(i)) values[row] = NAN;
+      else values[row] = int_fn ? (double)int_fn(chunk, i) : float_fn(chunk, i);
+    }
+  });
+  return values;
+}
+
+std::vector<int64_t> column_times(const arrow::ChunkedArray &column) {
+  if (column.type()->id() != arrow::Type::TIMESTAMP) {
+    throw std::invalid_argument("not a timestamp column: " + column.type()->ToString());
+  }
+  if (column.null_count() > 0) throw std::invalid_argument("the time column cannot contain nulls");
+  std::vector<int64_t> times(column.length());
+  parallel_for_row_ranges(column, [&](const arrow::Array &chunk, int64_t i, int64_t row, int64_t length) {
+    const int64_t *values = static_cast<const arrow::TimestampArray&>(chunk).raw_values();
+    std::copy(values + i, values + i + length, times.begin() + row);
+  });
+  return times;
+}
+
+// Computes [agg] over the trailing windows of the [n] rows [rows] of a group,
+// the window of a row holds the previous rows of the group, and the row itself,
+// whose time is at most [max_gap] before its time. Empty windows give nans,
+// zero for counts.
+void rolling_group(rolling_agg agg, const int64_t *rows, int64_t n, const std::vector<int64_t> &times,
+                   const std::vector<double> &values, int64_t max_gap, double *out) {
+  int64_t start = 0, count = 0;
+  double sum = 0;
+  // Positions of the candidates for the window min or max, their values are
+  // monotonic from the front.
+  std::deque<int64_t> candidates;
+  bool is_min = agg == rolling_min;
+  for (int64_t k = 0; k < n; ++k) {
+    int64_t row = rows[k];
+    double value = values[row];
+    if (!std::isnan(value)) {
+      sum += value;
+      count++;
+      if (agg == rolling_min || agg == rolling_max) {
+        while (!candidates.empty()) {
+          double back = values[rows[candidates.back()]];
+          if (is_min ? back < value : back > value) break;
+          candidates.pop_back();
+        }
+        candidates.push_back(k);
+      }
+    }
+    for (; times[row] - times[rows[start]] > max_gap; ++start) {
+      double removed = values[rows[start]];
+      if (std::isnan(removed)) continue;
+      sum -= removed;
+      // Restart from zero to avoid accumulating rounding errors.
+      if (--count == 0) sum = 0;
+      if (!candidates.empty() && candidates.front() == start) candidates.pop_front();
+    }
+    switch (agg) {
+      case rolling_sum: out[row] = count ? sum : NAN; break;
+      case rolling_mean: out[row] = count ? sum / count : NAN; break;
+      case rolling_min:
+      case rolling_max: out[row] = candidates.empty() ? NAN : values[rows[candidates.front()]]; break;
+      case rolling_count: out[row] = count; break;
+    }
+  }
+}
+
+// Adds to [table] a column per aggregation with the value of this aggregation
+// over the trailing time window of each row within its group of rows with the
+// same values in the [by] columns. Rows have to be sorted by time within each
+// group, the window holds the rows at most [max_gap] before the current one in
+// the unit of the time column. Aggregated values are converted to doubles,
+// nulls and nans are skipped, counts are int64 and empty windows give nulls.
+TablePtr *table_rolling(TablePtr *table, char *time_name, int time_idx, int64_t max_gap,
+                        char **by_names, int *by_idxs, int nby,
+                        char **value_names, int *value_idxs, int *aggs, char **out_names, int naggs) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  if (max_gap < 0) throw std::invalid_argument("the window has to be positive");
+  int64_t num_rows = (*table)->num_rows();
+  std::vector<int64_t> times = column_times(*find_column(**table, time_name, time_idx));
+
+  // Rows ordered by group, [group_starts] holds the start of each group.
+  std::vector<int64_t> order(num_rows);
+  std::vector<int64_t> group_starts = {0};
+  if (nby > 0) {
+    std::vector<int64_t> ids;
+    int64_t num_groups = group_ids(**table, find_columns(**table, by_names, by_idxs, nby), ids);
+    group_starts.assign(num_groups + 1, 0);
+    for (int64_t row = 0; row < num_rows; ++row) group_starts[ids[row] + 1]++;
+    for (int64_t g = 0; g < num_groups; ++g) group_starts[g + 1] += group_starts[g];
+    std::vector<int64_t> next(group_starts.begin(), group_starts.end() - 1);
+    for (int64_t row = 0; row < num_rows; ++row) order[next[ids[row]]++] = row;
+  }
+  else {
+    std::iota(order.begin(), order.end(), 0);
+    group_starts.push_back(num_rows);
+  }
+  int64_t num_groups = group_starts.size() - 1;
+  for (int64_t g = 0; g < num_groups; ++g) {
+    for (int64_t k = group_starts[g] + 1; k < group_starts[g + 1]; ++k) {
+      if (times[order[k]] < times[order[k - 1]]) {
+        throw std::invalid_argument("rows are not sorted by time at row " + std::to_string(order[k]));
+      }
+    }
+  }
+
+  std::shared_ptr<arrow::Table> result = *table;
+  for (int a = 0; a < naggs; ++a) {
+    rolling_agg agg = (rolling_agg)aggs[a];
+    if (agg < rolling_sum || agg > rolling_count) {
+      throw std::invalid_argument("invalid aggregation " + std::to_string(aggs[a]));
+    }
+    std::vector<double> values = column_doubles(*find_column(**table, value_names[a], value_idxs[a]));
+    std::vector<double> out(num_rows);
+    arrow::Status st = arrow::internal::ParallelFor(num_groups, [&](int g) {
+      int64_t start = group_starts[g];
+      rolling_group(agg, order.data() + start, group_starts[g + 1] - start, times, values, max_gap, out.data());
+      return arrow::Status::OK();
+    });
+    status_exn(st);
+    std::shared_ptr<arrow::Array> array;
+    if (agg == rolling_count) {
+      arrow::Int64Builder builder(memory_pool());
+      st = builder.Reserve(num_rows);
+      status_exn(st);
+      for (double count : out) builder.UnsafeAppend((int64_t)count);
+      st = builder.Finish(&array);
+    }
+    else {
+      arrow::DoubleBuilder builder(memory_pool());
+      st = builder.Reserve(num_rows);
+      status_exn(st);
+      for (double value : out) {
+        if (std::isnan(value)) builder.UnsafeAppendNull();
+        else builder.UnsafeAppend(value);
+      }
+      st = builder.Finish(&array);
+    }
+    status_exn(st);
+    auto added = result->AddColumn(result->num_columns(), arrow::field(out_names[a], array->type()),
+                                   std::make_shared<arrow::ChunkedArray>(array));
+    result = ok_exn(added);
+  }
+  return new std::shared_ptr<arrow::Table>(std::move(result));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+/* Resampling.
+   Rows are aggregated in bars per group and time bucket in a single pass, the
+   bar of a group is closed when a row of the same group falls in a later
+   bucket. The open bars are kept between tables so that a file can be
+   resampled batch by batch. */
+
+// Aggregations, the order has to match the OCaml side.
+enum resample_agg {
+  resample_first = 0,
+  resample_last = 1,
+  resample_min = 2,
+  resample_max = 3,
+  resample_sum = 4,
+  resample_mean = 5,
+  resample_count = 6,
+  resample_vwap = 7,
+};
+
+const int64_t no_bucket = std::numeric_limits<int64_t>::min();
+
+int64_t time_unit_in_ns(const arrow::DataType &type) {
+  switch (static_cast<const arrow::TimestampType&>(type).unit()) {
+    case arrow::TimeUnit::SECOND: return 1000000000;
+    case arrow::TimeUnit::MILLI: return 1000000;
+    case arrow::TimeUnit::MICRO: return 1000;
+    default: return 1;
+  }
+}
+
+int64_t utc_offset(const Resampler &r, int64_t time) {
+  if (r.zone_starts.empty()) return 0;
+  size_t i = std::upper_bound(r.zone_starts.begin(), r.zone_starts.end(), time) - r.zone_starts.begin();
+  return r.zone_offsets[i == 0 ? 0 : i - 1];
+}
+
+// Start of the bucket containing [time], buckets are aligned on the local
+// time of the zone so that daily buckets start at midnight.
+int64_t bucket_start(const Resampler &r, int64_t time) {
+  int64_t offset = utc_offset(r, time);
+  int64_t local_start = floor_div(time + offset, r.every) * r.every;
+  return local_start - utc_offset(r, local_start - offset);
+}
+
+// Appends a representation of the value at index [i] of [array] to [key], two
+// keys are equal when the values are.
+void append_key_value(const arrow::Array &array, int64_t i, std::string &key) {
+  if (array.IsNull(i)) {
+    key.push_back('\0');
+    return;
+  }
+  arrow::Type::type id = array.type_id();
+  if (IntValueFn int_fn = int_value_fn(id)) {
+    int64_t value = int_fn(array, i);
+    key.push_back('\1');
+    key.append((const char*)&value, sizeof(value));
+  }
+  else if (is_binary_like(id)) {
+    auto value = binary_value(array, i);
+    int64_t size = value.size();
+    key.push_back('\2');
+    key.append((const char*)&size, sizeof(size));
+    key.append(value.data(), value.size());
+  }
+  else if (id == arrow::Type::BOOL) {
+    key.push_back(static_cast<const arrow::BooleanArray&>(array).Value(i) ? '\3' : '\4');
+  }
+  else {
+    throw std::invalid_argument("cannot group by values of type " + array.type()->ToString());
+  }
+}
+
+void reset_bar(ResampleBar &bar, int64_t bucket, size_t naggs) {
+  bar.bucket = bucket;
+  bar.stats.assign(naggs, BarStats{NAN, NAN, INFINITY, -INFINITY, 0, 0, 0});
+}
+
+void update_bar_stats(BarStats &stats, int kind, double value, double weight) {
+  if (std::isnan(value)) return;
+  if (kind == resample_vwap) {
+    if (std::isnan(weight)) return;
+    stats.sum += value * weight;
+    stats.weight += weight;
+  }
+  else {
+    if (stats.count == 0) stats.first = value;
+    stats.last = value;
+    stats.min = std::min(stats.min, value);
+    stats.max = std::max(stats.max, value);
+    stats.sum += value;
+  }
+  stats.count++;
+}
+
+// Converts closed bars to a table with the key columns, the bucket start and a
+// column per aggregation. Bars are sorted by bucket then by group.
+std::shared_ptr<arrow::Table> resampler_bars_table(const Resampler &r, std::vector<ResampleBar> &bars) {
+  std::sort(bars.begin(), bars.end(), [](const ResampleBar &a, const ResampleBar &b) {
+    return a.bucket != b.bucket ? a.bucket < b.bucket : a.group < b.group;
+  });
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  std::vector<std::shared_ptr<arrow::Array>> arrays;
+  for (size_t c = 0; c < r.key_fields.size(); ++c) {
+    std::shared_ptr<arrow::Array> array;
+    if (bars.empty()) {
+      auto empty = arrow::MakeArrayOfNull(r.key_fields[c]->type(), 0, memory_pool());
+      array = ok_exn(empty);
+    }
+    else {
+      arrow::ArrayVector values;
+      for (auto &bar : bars) values.push_back(r.group_keys[bar.group][c]);
+      auto concatenated = arrow::Concatenate(values, memory_pool());
+      array = ok_exn(concatenated);
+    }
+    fields.push_back(r.key_fields[c]);
+    arrays.push_back(array);
+  }
+  arrow::Status st;
+  {
+    arrow::TimestampBuilder builder(r.time_field->type(), memory_pool());
+    st = builder.Reserve(bars.size());
+    status_exn(st);
+    for (auto &bar : bars) builder.UnsafeAppend(floor_div(bar.bucket, r.unit));
+    std::shared_ptr<arrow::Array> array;
+    st = builder.Finish(&array);
+    status_exn(st);
+    fields.push_back(r.time_field);
+    arrays.push_back(array);
+  }
+  for (size_t a = 0; a < r.aggs.size(); ++a) {
+    int kind = r.aggs[a].kind;
+    std::shared_ptr<arrow::Array> array;
+    if (kind == resample_count) {
+      arrow::Int64Builder builder(memory_pool());
+      st = builder.Reserve(bars.size());
+      status_exn(st);
+      for (auto &bar : bars) builder.UnsafeAppend(bar.stats[a].count);
+      st = builder.Finish(&array);
+    }
+    else {
+      arrow::DoubleBuilder builder(memory_pool());
+      st = builder.Reserve(bars.size());
+      status_exn(st);
+      for (auto &bar : bars) {
+        const BarStats &stats = bar.stats[a];
+        if (stats.count == 0) builder.UnsafeAppendNull();
+        else if (kind == resample_sum) builder.UnsafeAppend(stats.sum);
+        else if (kind == resample_first) builder.UnsafeAppend(stats.first);
+        else if (kind == resample_last) builder.UnsafeAppend(stats.last);
+        else if (kind == resample_min) builder.UnsafeAppend(stats.min);
+        else if (kind == resample_max) builder.UnsafeAppend(stats.max);
+        else if (kind == resample_mean) builder.UnsafeAppend(stats.sum / stats.count);
+        else if (stats.weight == 0) builder.UnsafeAppendNull();
+        else builder.UnsafeAppend(stats.sum / stats.weight);
+      }
+      st = builder.Finish(&array);
+    }
+    status_exn(st);
+    fields.push_back(arrow::field(r.aggs[a].out_name, array->type()));
+    arrays.push_back(array);
+  }
+  return arrow::Table::Make(arrow::schema(fields), arrays, bars.size());
+}
+
+Resampler *make_resampler(char *time_name, int time_idx, int64_t every,
+                          int64_t *zone_starts, int64_t *zone_offsets, int nzone,
+                          char **by_names, int *by_idxs, int nby,
+                          int *agg_kinds, char **value_names, int *value_idxs,
+                          char **weight_names, int *weight_idxs, char **out_names, int naggs) {
+  if (every <= 0) throw std::invalid_argument("the bucket size has to be positive");
+  std::unique_ptr<Resampler> r(new Resampler());
+  r->time_name = time_name;
+  r->time_idx = time_idx;
+  r->every = every;
+  r->zone_starts.assign(zone_starts, zone_starts + nzone);
+  r->zone_offsets.assign(zone_offsets, zone_offsets + nzone);
+  for (int i = 0; i < nby; ++i) {
+    r->by_names.push_back(by_names[i]);
+    r->by_idxs.push_back(by_idxs[i]);
+  }
+  for (int a = 0; a < naggs; ++a) {
+    if (agg_kinds[a] < resample_first || agg_kinds[a] > resample_vwap) {
+      throw std::invalid_argument("invalid aggregation " + std::to_string(agg_kinds[a]));
+    }
+    r->aggs.push_back(ResampleAgg{agg_kinds[a], value_names[a], value_idxs[a],
+                                  weight_names[a], weight_idxs[a], out_names[a]});
+  }
+  r->unit = 0;
+  return r.release();
+}
+
+// Adds the rows of [t] to the open bars, the bars that get closed are appended
+// to [closed]. The whole table is checked before the resampler gets modified,
+// so a failure leaves it as it was.
+void resampler_add(Resampler &r, const arrow::Table &t, std::vector<ResampleBar> &closed) {
+  auto time_column = find_column(t, r.time_name.c_str(), r.time_idx);
+  std::vector<std::shared_ptr<arrow::ChunkedArray>> by_columns;
+  for (size_t c = 0; c < r.by_names.size(); ++c) {
+    by_columns.push_back(find_column(t, r.by_names[c].c_str(), r.by_idxs[c]));
+  }
+  std::vector<int64_t> times = column_times(*time_column);
+  // The output schema is only known once the first table gets added.
+  bool first_table = !r.time_field;
+  int64_t unit = r.unit;
+  if (first_table) unit = time_unit_in_ns(*time_column->type());
+  else if (!time_column->type()->Equals(r.time_field->type())) {
+    throw std::invalid_argument("time column type changed to " + time_column->type()->ToString());
+  }
+
+  // Maps the groups of this table to the groups of the resampler, -1 for the
+  // groups that are new, their key values being in [new_key_values].
+  std::vector<int64_t> ids;
+  int64_t num_local_groups = group_ids(t, by_columns, ids);
+  std::vector<int64_t> local_groups(num_local_groups, -1);
+  std::vector<std::string> local_keys(num_local_groups);
+  std::vector<std::vector<std::shared_ptr<arrow::Array>>> new_key_values(num_local_groups);
+  std::vector<bool> seen(num_local_groups, false);
+  std::vector<RowLocator> locators;
+  for (auto &column : by_columns) locators.emplace_back(*column);
+  int64_t num_rows = t.num_rows();
+  for (int64_t row = 0; row < num_rows; ++row) {
+    int64_t id = ids[row];
+    if (seen[id]) continue;
+    seen[id] = true;
+    std::string &key = local_keys[id];
+    for (auto &locator : locators) {
+      auto value = locator.locate(row);
+      append_key_value(*value.first, value.second, key);
+    }
+    auto it = r.group_index.find(key);
+    if (it != r.group_index.end()) {
+      local_groups[id] = it->second;
+      continue;
+    }
+    // Copied so that the key values do not hold on the table buffers.
+    for (auto &locator : locators) {
+      auto value = locator.locate(row);
+      auto copy = arrow::Concatenate({value.first->Slice(value.second, 1)}, memory_pool());
+      new_key_values[id].push_back(ok_exn(copy));
+    }
+  }
+
+  size_t naggs = r.aggs.size();
+  std::vector<std::vector<double>> values(naggs), weights(naggs);
+  for (size_t a = 0; a < naggs; ++a) {
+    const ResampleAgg &agg = r.aggs[a];
+    values[a] = column_doubles(*find_column(t, agg.value_name.c_str(), agg.value_idx));
+    if (agg.kind == resample_vwap) {
+      weights[a] = column_doubles(*find_column(t, agg.weight_name.c_str(), agg.weight_idx));
+    }
+  }
+
+  // Buckets cannot go back within a group, including from the open bars.
+  std::vector<int64_t> buckets(num_rows);
+  std::vector<int64_t> last_buckets(num_local_groups, no_bucket);
+  for (int64_t id = 0; id < num_local_groups; ++id) {
+    if (local_groups[id] >= 0) last_buckets[id] = r.open_bars[local_groups[id]].bucket;
+  }
+  for (int64_t row = 0; row < num_rows; ++row) {
+    int64_t bucket = bucket_start(r, times[row] * unit);
+    int64_t &last = last_buckets[ids[row]];
+    if (last != no_bucket && bucket < last) {
+      throw std::invalid_argument("rows are not sorted by time at row " + std::to_string(row));
+    }
+    last = bucket;
+    buckets[row] = bucket;
+  }
+
+  if (first_table) {
+    r.unit = unit;
+    int time_idx = r.time_idx >= 0 ? r.time_idx : t.schema()->GetFieldIndex(r.time_name);
+    r.time_field = t.schema()->field(time_idx);
+    for (size_t c = 0; c < by_columns.size(); ++c) {
+      int idx = r.by_idxs[c] >= 0 ? r.by_idxs[c] : t.schema()->GetFieldIndex(r.by_names[c]);
+      r.key_fields.push_back(t.schema()->field(idx));
+    }
+  }
+  for (int64_t id = 0; id < num_local_groups; ++id) {
+    if (local_groups[id] >= 0) continue;
+    int64_t group = r.group_keys.size();
+    r.group_index.emplace(std::move(local_keys[id]), group);
+    r.group_keys.push_back(std::move(new_key_values[id]));
+    r.open_bars.emplace_back();
+    r.open_bars.back().group = group;
+    r.open_bars.back().bucket = no_bucket;
+    local_groups[id] = group;
+  }
+  for (int64_t row = 0; row < num_rows; ++row) {
+    ResampleBar &bar = r.open_bars[local_groups[ids[row]]];
+    if (buckets[row] != bar.bucket) {
+      if (bar.bucket != no_bucket) closed.push_back(bar);
+      reset_bar(bar, buckets[row], naggs);
+    }
+    for (size_t a = 0; a < naggs; ++a) {
+      update_bar_stats(bar.stats[a], r.aggs[a].kind, values[a][row], weights[a].empty() ? 0 : weights[a][row]);
+    }
+  }
+}
+
+void resampler_close_all(Resampler &r, std::vector<ResampleBar> &closed) {
+  if (!r.time_field) throw std::invalid_argument("no table has been resampled");
+  for (auto &bar : r.open_bars) {
+    if (bar.bucket == no_bucket) continue;
+    closed.push_back(bar);
+    bar.bucket = no_bucket;
+  }
+}
+
+Resampler *resampler_create(char *time_name, int time_idx, int64_t every,
+                            int64_t *zone_starts, int64_t *zone_offsets, int nzone,
+                            char **by_names, int *by_idxs, int nby,
+                            int *agg_kinds, char **value_names, int *value_idxs,
+                            char **weight_names, int *weight_idxs, char **out_names, int naggs) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  return make_resampler(time_name, time_idx, every, zone_starts, zone_offsets, nzone, by_names, by_idxs, nby,
+                        agg_kinds, value_names, value_idxs, weight_names, weight_idxs, out_names, naggs);
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// Adds the rows of [table] to the open bars, returns the bars that got closed.
+TablePtr *resampler_push(Resampler *r, TablePtr *table) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::vector<ResampleBar> closed;
+  resampler_add(*r, **table, closed);
+  return new std::shared_ptr<arrow::Table>(resampler_bars_table(*r, closed));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// Closes and returns all the open bars.
+TablePtr *resampler_finish(Resampler *r) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::vector<ResampleBar> closed;
+  resampler_close_all(*r, closed);
+  return new std::shared_ptr<arrow::Table>(resampler_bars_table(*r, closed));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// Resamples a whole table at once, the result is sorted by bucket then group.
+TablePtr *table_resample(TablePtr *table, char *time_name, int time_idx, int64_t every,
+                         int64_t *zone_starts, int64_t *zone_offsets, int nzone,
+                         char **by_names, int *by_idxs, int nby,
+                         int *agg_kinds, char **value_names, int *value_idxs,
+                         char **weight_names, int *weight_idxs, char **out_names, int naggs) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  std::unique_ptr<Resampler> r(
+    make_resampler(time_name, time_idx, every, zone_starts, zone_offsets, nzone, by_names, by_idxs, nby,
+                   agg_kinds, value_names, value_idxs, weight_names, weight_idxs, out_names, naggs));
+  std::vector<ResampleBar> bars;
+  resampler_add(*r, **table, bars);
+  resampler_close_all(*r, bars);
+  return new std::shared_ptr<arrow::Table>(resampler_bars_table(*r, bars));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+void resampler_free(Resampler *r) {
+  if (r != nullptr) delete r;
+}
+
+/* Sketches.
+   Columns are summarized in parallel with a sketch per range of rows, the
+   sketches being merged afterwards. */
+
+// Adds the [length] values of [chunk] starting at [offset] to [sketch].
+void sketch_add_values(Sketch &sketch, const arrow::Array &chunk, int64_t offset, int64_t length) {
+  arrow::Type::type id = chunk.type_id();
+  IntValueFn int_fn = int_value_fn(id);
+  FloatValueFn float_fn = float_value_fn(id);
+  bool binary = is_binary_like(id);
+  for (int64_t i = offset; i < offset + length; ++i) {
+    if (chunk.IsNull(i)) {
+      sketch.null_count++;
+      continue;
+    }
+    sketch.count++;
+    if (binary) {
+      sketch.hll.add(hash_bytes(binary_value(chunk, i)));
+      continue;
+    }
+    double value;
+    if (int_fn) {
+      int64_t v = int_fn(chunk, i);
+      sketch.hll.add(hash_int64(v));
+      value = v;
+    }
+    else {
+      value = float_fn(chunk, i);
+      sketch.hll.add(hash_double(value));
+      if (std::isnan(value)) continue;
+    }
+    sketch.digest.add(value);
+    sketch.min = std::fmin(sketch.min, value);
+    sketch.max = std::fmax(sketch.max, value);
+  }
+}
+
+Sketch *sketch_create(double compression, int hll_precision) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  return new Sketch(compression, hll_precision);
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+// Adds the values of a column of [table] to [sketch]. Integer, temporal and
+// float values feed all the estimators, string values only the counts and the
+// distinct count.
+void sketch_update(Sketch *sketch, TablePtr *table, char *column_name, int column_idx) {
+  OCAML_BEGIN_PROTECT_EXN_RELEASE_LOCK
+
+  auto column = find_column(**table, column_name, column_idx);
+  arrow::Type::type id = column->type()->id();
+  if (!int_value_fn(id) && !float_value_fn(id) && !is_binary_like(id)) {
+    throw std::invalid_argument("cannot sketch values of type " + column->type()->ToString());
+  }
+  int64_t num_tasks = (column->length() + rows_per_task - 1) / rows_per_task;
+  std::vector<std::unique_ptr<Sketch>> sketches(num_tasks);
+  parallel_for_row_ranges(*column, [&](const arrow::Array &chunk, int64_t i, int64_t row, int64_t length) {
+    auto &task_sketch = sketches[row / rows_per_task];
+    if (!task_sketch) task_sketch.reset(new Sketch(sketch->digest.compression(), sketch->hll.precision()));
+    sketch_add_values(*task_sketch, chunk, i, length);
+  });
+  for (auto &task_sketch : sketches) {
+    if (task_sketch) sketch->merge(*task_sketch);
+  }
+
+  OCAML_END_PROTECT_EXN
+}
+
+void sketch_merge(Sketch *sketch, Sketch *other) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  sketch->merge(*other);
+
+  OCAML_END_PROTECT_EXN
+}
+
+// Returns the serialized sketch, the data remains valid until the next call.
+char *sketch_serialize(Sketch *sketch, int64_t *length) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  sketch->serialized.clear();
+  sketch->serialize(sketch->serialized);
+  *length = sketch->serialized.size();
+  return &sketch->serialized[0];
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+Sketch *sketch_deserialize(char *data, int64_t length) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  return new Sketch(Sketch::deserialize(std::string(data, length)));
+
+  OCAML_END_PROTECT_EXN
+  return nullptr;
+}
+
+int64_t sketch_count(Sketch *sketch) {
+  return sketch->count;
+}
+
+int64_t sketch_null_count(Sketch *sketch) {
+  return sketch->null_count;
+}
+
+double sketch_min(Sketch *sketch) {
+  return sketch->min;
+}
+
+double sketch_max(Sketch *sketch) {
+  return sketch->max;
+}
+
+double sketch_quantile(Sketch *sketch, double q) {
+  return sketch->digest.quantile(q);
+}
+
+double sketch_distinct_count(Sketch *sketch) {
+  return sketch->hll.estimate();
+}
+
+void sketch_free(Sketch *sketch) {
+  if (sketch != nullptr) delete sketch;
+}
+
+/* Bitmaps.
+   Bulk operations for Valid, arrow's bitmap kernels work on 64 bits words and
+   get vectorized when the offsets are aligned. */
+
+// Bitwise operations, the order has to match the OCaml side.
+enum bitmap_op {
+  bitmap_and = 0,
+  bitmap_or = 1,
+  bitmap_xor = 2,
+  bitmap_and_not = 3,
+};
+
+void bitmap_binary_op(uint8_t *left, uint8_t *right, int64_t length, int op, uint8_t *out) {
+  switch (op) {
+    case bitmap_and: arrow::internal::BitmapAnd(left, 0, right, 0, length, 0, out); break;
+    case bitmap_or: arrow::internal::BitmapOr(left, 0, right, 0, length, 0, out); break;
+    case bitmap_xor: arrow::internal::BitmapXor(left, 0, right, 0, length, 0, out); break;
+    case bitmap_and_not: arrow::internal::BitmapAndNot(left, 0, right, 0, length, 0, out); break;
+  }
+}
+
+void bitmap_invert(uint8_t *bitmap, int64_t length, uint8_t *out) {
+  arrow::internal::InvertBitmap(bitmap, 0, length, out, 0);
+}
+
+int64_t bitmap_count_set_bits(uint8_t *bitmap, int64_t offset, int64_t length) {
+  return arrow::internal::CountSetBits(bitmap, offset, length);
+}
+
+// Returns the index of the first set bit in [offset, length), -1 if none.
+int64_t bitmap_find_next_set(uint8_t *bitmap, int64_t offset, int64_t length) {
+  int64_t i = offset;
+  for (; i < length && (i % 8) != 0; ++i) {
+    if (arrow::BitUtil::GetBit(bitmap, i)) return i;
+  }
+  // Bitmaps are little endian, so the lowest bit of a word is the first one.
+  for (; i + 64 <= length; i += 64) {
+    uint64_t word;
+    memcpy(&word, bitmap + i / 8, sizeof(word));
+    if (word != 0) return i + __builtin_ctzll(word);
+  }
+  for (; i < length; ++i) {
+    if (arrow::BitUtil::GetBit(bitmap, i)) return i;
+  }
+  return -1;
+}
+
+// Copies the values of [src] at the set positions of [bitmap] to the start of
+// [dst], or the reverse for [expand]. Full and empty words are handled in bulk,
+// [N] is the element size in bytes so that the copies become plain loads/stores.
+template<size_t N, bool expand>
+int64_t bitmap_select(const uint8_t *bitmap, int64_t length, const uint8_t *src, uint8_t *dst) {
+  int64_t j = 0;
+  auto copy = [&](int64_t i, int64_t n) {
+    if (expand) memcpy(dst + i * N, src + j * N, n * N);
+    else memcpy(dst + j * N, src + i * N, n * N);
+    j += n;
+  };
+  int64_t i = 0;
+  for (; i + 64 <= length; i += 64) {
+    uint64_t word;
+    memcpy(&word, bitmap + i / 8, sizeof(word));
+    if (word == ~0ULL) {
+      copy(i, 64);
+      continue;
+    }
+    while (word != 0) {
+      copy(i + __builtin_ctzll(word), 1);
+      word &= word - 1;
+    }
+  }
+  for (; i < length; ++i) {
+    if (arrow::BitUtil::GetBit(bitmap, i)) copy(i, 1);
+  }
+  return j;
+}
+
+template<bool expand>
+int64_t bitmap_select(uint8_t *bitmap, int64_t length, void *src, int elt_size, void *dst) {
+  auto s = (const uint8_t*)src;
+  auto d = (uint8_t*)dst;
+  switch (elt_size) {
+    case 1: return bitmap_select<1, expand>(bitmap, length, s, d);
+    case 2: return bitmap_select<2, expand>(bitmap, length, s, d);
+    case 4: return bitmap_select<4, expand>(bitmap, length, s, d);
+    case 8: return bitmap_select<8, expand>(bitmap, length, s, d);
+    case 16: return bitmap_select<16, expand>(bitmap, length, s, d);
+  }
+  throw std::invalid_argument("unsupported element size " + std::to_string(elt_size));
+}
+
+int64_t bitmap_compress(uint8_t *bitmap, int64_t length, void *src, int elt_size, void *dst) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  return bitmap_select<false>(bitmap, length, src, elt_size, dst);
+
+  OCAML_END_PROTECT_EXN
+  return -1;
+}
+
+void bitmap_expand(uint8_t *bitmap, int64_t length, void *src, int elt_size, void *dst) {
+  OCAML_BEGIN_PROTECT_EXN
+
+  bitmap_select<true>(bitmap, length, src, elt_size, dst);
+
+  OCAML_END_PROTECT_EXN
 }
 
 /* Builder bindings. */
@@ -876,6 +4051,81 @@ char *table_to_string(TablePtr *table) {
 
 extern "C" {
   value fast_col_read(value tbl, value col_idx);
+  value arrow_bigarray_create(value kind, value dim);
+  value arrow_export_keepalive(value array, value schema, value keepalive);
+  value arrow_release_exported(value array, value schema);
+  value arrow_release_keepalives(value unit);
+
+  intnat fast_table_num_rows(value table);
+  value fast_table_num_rows_byte(value table);
+  value fast_builder_last_error(value unit);
+
+  intnat fast_append_int32_builder(value builder, int32_t v);
+  value fast_append_int32_builder_byte(value builder, value v);
+  intnat fast_append_int64_builder(value builder, int64_t v);
+  value fast_append_int64_builder_byte(value builder, value v);
+  intnat fast_append_double_builder(value builder, double v);
+  value fast_append_double_builder_byte(value builder, value v);
+  intnat fast_append_string_builder(value builder, value v);
+  value fast_append_string_builder_byte(value builder, value v);
+
+  intnat fast_append_null_int32_builder(value builder, intnat n);
+  value fast_append_null_int32_builder_byte(value builder, value n);
+  intnat fast_append_null_int64_builder(value builder, intnat n);
+  value fast_append_null_int64_builder_byte(value builder, value n);
+  intnat fast_append_null_double_builder(value builder, intnat n);
+  value fast_append_null_double_builder_byte(value builder, value n);
+  intnat fast_append_null_string_builder(value builder, intnat n);
+  value fast_append_null_string_builder_byte(value builder, value n);
+
+  int64_t fast_length_int32_builder(value builder);
+  value fast_length_int32_builder_byte(value builder);
+  int64_t fast_length_int64_builder(value builder);
+  value fast_length_int64_builder_byte(value builder);
+  int64_t fast_length_double_builder(value builder);
+  value fast_length_double_builder_byte(value builder);
+  int64_t fast_length_string_builder(value builder);
+  value fast_length_string_builder_byte(value builder);
+
+  int64_t fast_null_count_int32_builder(value builder);
+  value fast_null_count_int32_builder_byte(value builder);
+  int64_t fast_null_count_int64_builder(value builder);
+  value fast_null_count_int64_builder_byte(value builder);
+  int64_t fast_null_count_double_builder(value builder);
+  value fast_null_count_double_builder_byte(value builder);
+  int64_t fast_null_count_string_builder(value builder);
+  value fast_null_count_string_builder_byte(value builder);
+}
+
+// Allocates a one dimensional bigarray owned by the OCaml runtime, large ones
+// are backed by huge pages, see [set_huge_page_threshold].
+// The runtime allocates the data itself so that the GC accounts for it as for
+// [Bigarray.Array1.create], it only does so for the data it allocates. Large
+// data is then swapped for a huge page backed area, which is also released
+// with free.
+value alloc_bigarray(int kind, int64_t dim) {
+  value ba = caml_ba_alloc_dims(kind | CAML_BA_C_LAYOUT, 1, nullptr, (intnat)dim);
+  struct caml_ba_array *array = Caml_ba_array_val(ba);
+  void *data = huge_page_malloc(dim * caml_ba_element_size[kind & CAML_BA_KIND_MASK]);
+  if (data != nullptr) {
+    free(array->data);
+    array->data = data;
+  }
+  return ba;
+}
+
+value arrow_bigarray_create(value kind, value dim) {
+  CAMLparam2(kind, dim);
+  CAMLlocal1(result);
+
+  OCAML_BEGIN_PROTECT_EXN
+
+  // Bigarray kinds are represented as integers on the OCaml side.
+  result = alloc_bigarray(Int_val(kind), Long_val(dim));
+
+  OCAML_END_PROTECT_EXN
+
+  CAMLreturn(result);
 }
 
 value fast_col_read(value tbl, value col_idx) {
@@ -930,10 +4180,10 @@ value fast_col_read(value tbl, value col_idx) {
     uint8_t *valid_ptr = nullptr;
     if (has_null) {
       has_valid = true;
-      ocaml_valid = caml_ba_alloc_dims(CAML_BA_UINT8 | CAML_BA_C_LAYOUT, 1, nullptr, (total_len+7)/8);
+      ocaml_valid = alloc_bigarray(CAML_BA_UINT8, (total_len+7)/8);
       valid_ptr = (uint8_t*)Caml_ba_data_val(ocaml_valid);
     }
-    ocaml_array = caml_ba_alloc_dims(CAML_BA_INT64 | CAML_BA_C_LAYOUT, 1, nullptr, total_len);
+    ocaml_array = alloc_bigarray(CAML_BA_INT64, total_len);
     int64_t *data_ptr = (int64_t*)Caml_ba_data_val(ocaml_array);
     tag = has_null ? 3 : 2;
     long int res_index = 0;
@@ -959,10 +4209,10 @@ value fast_col_read(value tbl, value col_idx) {
     uint8_t *valid_ptr = nullptr;
     if (has_null) {
       has_valid = true;
-      ocaml_valid = caml_ba_alloc_dims(CAML_BA_UINT8 | CAML_BA_C_LAYOUT, 1, nullptr, (total_len+7)/8);
+      ocaml_valid = alloc_bigarray(CAML_BA_UINT8, (total_len+7)/8);
       valid_ptr = (uint8_t*)Caml_ba_data_val(ocaml_valid);
     }
-    ocaml_array = caml_ba_alloc_dims(CAML_BA_FLOAT64 | CAML_BA_C_LAYOUT, 1, nullptr, total_len);
+    ocaml_array = alloc_bigarray(CAML_BA_FLOAT64, total_len);
     double *data_ptr = (double*)Caml_ba_data_val(ocaml_array);
     tag = has_null ? 5 : 4;
     long int res_index = 0;
@@ -1002,3 +4252,273 @@ value fast_col_read(value tbl, value col_idx) {
 
   CAMLreturn(result);
 }
+
+/* Release callbacks for the structs exported by [Writer].
+   The exported structs and their buffers live in OCaml memory, a keepalive roots the
+   corresponding OCaml values for as long as arrow references them. Arrow can release
+   the structs from any thread so the callbacks only decrement a refcount, the root is
+   removed later by [release_keepalives] with the runtime lock held. */
+struct OcamlKeepalive {
+  // One reference for the array and one for the schema.
+  explicit OcamlKeepalive(value v) : refcount(2), root(v) {}
+  std::atomic<int> refcount;
+  value root;
+};
+
+std::mutex released_keepalives_mutex;
+std::vector<OcamlKeepalive*> released_keepalives;
+
+void keepalive_decref(OcamlKeepalive *keepalive) {
+  if (keepalive->refcount.fetch_sub(1) == 1) {
+    std::lock_guard<std::mutex> guard(released_keepalives_mutex);
+    released_keepalives.push_back(keepalive);
+  }
+}
+
+void release_keepalives() {
+  std::vector<OcamlKeepalive*> released;
+  {
+    std::lock_guard<std::mutex> guard(released_keepalives_mutex);
+    released.swap(released_keepalives);
+  }
+  for (OcamlKeepalive *keepalive : released) {
+    caml_remove_generational_global_root(&keepalive->root);
+    delete keepalive;
+  }
+}
+
+// Children are owned by their parent, releasing them only marks them as released.
+template<class T>
+void release_exported_child(T *s) {
+  for (int64_t i = 0; i < s->n_children; ++i) {
+    T *child = s->children[i];
+    if (child->release) child->release(child);
+  }
+  s->release = nullptr;
+}
+
+template<class T>
+void release_exported(T *s) {
+  release_exported_child(s);
+  keepalive_decref((OcamlKeepalive*)s->private_data);
+}
+
+template<class T>
+void set_exported_child_release(T *s) {
+  s->release = &release_exported_child<T>;
+  s->private_data = nullptr;
+  for (int64_t i = 0; i < s->n_children; ++i) set_exported_child_release(s->children[i]);
+}
+
+template<class T>
+void set_exported_release(T *s, OcamlKeepalive *keepalive) {
+  s->release = &release_exported<T>;
+  s->private_data = keepalive;
+  for (int64_t i = 0; i < s->n_children; ++i) set_exported_child_release(s->children[i]);
+}
+
+value arrow_export_keepalive(value array, value schema, value keepalive) {
+  CAMLparam3(array, schema, keepalive);
+
+  release_keepalives();
+  OcamlKeepalive *handle = new OcamlKeepalive(keepalive);
+  caml_register_generational_global_root(&handle->root);
+  set_exported_release((struct ArrowArray*)CTYPES_ADDR_OF_FATPTR(array), handle);
+  set_exported_release((struct ArrowSchema*)CTYPES_ADDR_OF_FATPTR(schema), handle);
+
+  CAMLreturn(Val_unit);
+}
+
+// Releases the structs that have not been imported by arrow, e.g. on errors.
+value arrow_release_exported(value array, value schema) {
+  CAMLparam2(array, schema);
+
+  struct ArrowArray *array_ = (struct ArrowArray*)CTYPES_ADDR_OF_FATPTR(array);
+  struct ArrowSchema *schema_ = (struct ArrowSchema*)CTYPES_ADDR_OF_FATPTR(schema);
+  if (array_->release) array_->release(array_);
+  if (schema_->release) schema_->release(schema_);
+  release_keepalives();
+
+  CAMLreturn(Val_unit);
+}
+
+value arrow_release_keepalives(value unit) {
+  release_keepalives();
+  return Val_unit;
+}
+
+/* Direct externals for the hot scalar entry points.
+   These bypass the ctypes stubs: the native versions take and return unboxed values
+   and are declared [@@noalloc], the [_byte] versions are only used by bytecode. Errors
+   cannot be raised from a noalloc external, the append functions return a non zero
+   status instead and the message is retrieved with [fast_builder_last_error]. */
+thread_local std::string fast_builder_error;
+
+template<class Ptr>
+Ptr &builder_of_fatptr(value builder) {
+  return *(Ptr*)CTYPES_ADDR_OF_FATPTR(builder);
+}
+
+template<class F>
+intnat builder_status(F f) {
+  try {
+    arrow::Status st = f();
+    if (st.ok()) return 0;
+    fast_builder_error = st.ToString();
+  } catch (const std::exception& e) {
+    fast_builder_error = e.what();
+  }
+  return 1;
+}
+
+intnat fast_table_num_rows(value table) {
+  TablePtr *table_ = (TablePtr*)CTYPES_ADDR_OF_FATPTR(table);
+  if (table_ != NULL) return (*table_)->num_rows();
+  return 0;
+}
+
+value fast_table_num_rows_byte(value table) {
+  return Val_long(fast_table_num_rows(table));
+}
+
+value fast_builder_last_error(value unit) {
+  return caml_copy_string(fast_builder_error.c_str());
+}
+
+intnat fast_append_int32_builder(value builder, int32_t v) {
+  return builder_status([&]() { return builder_of_fatptr<Int32BuilderPtr>(builder)->Append(v); });
+}
+
+value fast_append_int32_builder_byte(value builder, value v) {
+  return Val_long(fast_append_int32_builder(builder, Int32_val(v)));
+}
+
+intnat fast_append_int64_builder(value builder, int64_t v) {
+  return builder_status([&]() { return builder_of_fatptr<Int64BuilderPtr>(builder)->Append(v); });
+}
+
+value fast_append_int64_builder_byte(value builder, value v) {
+  return Val_long(fast_append_int64_builder(builder, Int64_val(v)));
+}
+
+intnat fast_append_double_builder(value builder, double v) {
+  return builder_status([&]() { return builder_of_fatptr<DoubleBuilderPtr>(builder)->Append(v); });
+}
+
+value fast_append_double_builder_byte(value builder, value v) {
+  return Val_long(fast_append_double_builder(builder, Double_val(v)));
+}
+
+// The string is read in place, unlike the ctypes stub this does not copy it to a C
+// string first and embedded null characters are preserved.
+intnat fast_append_string_builder(value builder, value v) {
+  return builder_status([&]() {
+    return builder_of_fatptr<StringBuilderPtr>(builder)->Append(
+      (const uint8_t*)String_val(v), caml_string_length(v));
+  });
+}
+
+value fast_append_string_builder_byte(value builder, value v) {
+  return Val_long(fast_append_string_builder(builder, v));
+}
+
+template<class Ptr>
+intnat fast_append_null_builder(value builder, intnat n) {
+  return builder_status([&]() { return builder_of_fatptr<Ptr>(builder)->AppendNulls(n); });
+}
+
+intnat fast_append_null_int32_builder(value builder, intnat n) {
+  return fast_append_null_builder<Int32BuilderPtr>(builder, n);
+}
+
+value fast_append_null_int32_builder_byte(value builder, value n) {
+  return Val_long(fast_append_null_int32_builder(builder, Long_val(n)));
+}
+
+intnat fast_append_null_int64_builder(value builder, intnat n) {
+  return fast_append_null_builder<Int64BuilderPtr>(builder, n);
+}
+
+value fast_append_null_int64_builder_byte(value builder, value n) {
+  return Val_long(fast_append_null_int64_builder(builder, Long_val(n)));
+}
+
+intnat fast_append_null_double_builder(value builder, intnat n) {
+  return fast_append_null_builder<DoubleBuilderPtr>(builder, n);
+}
+
+value fast_append_null_double_builder_byte(value builder, value n) {
+  return Val_long(fast_append_null_double_builder(builder, Long_val(n)));
+}
+
+intnat fast_append_null_string_builder(value builder, intnat n) {
+  return fast_append_null_builder<StringBuilderPtr>(builder, n);
+}
+
+value fast_append_null_string_builder_byte(value builder, value n) {
+  return Val_long(fast_append_null_string_builder(builder, Long_val(n)));
+}
+
+int64_t fast_length_int32_builder(value builder) {
+  return builder_of_fatptr<Int32BuilderPtr>(builder)->length();
+}
+
+value fast_length_int32_builder_byte(value builder) {
+  return caml_copy_int64(fast_length_int32_builder(builder));
+}
+
+int64_t fast_length_int64_builder(value builder) {
+  return builder_of_fatptr<Int64BuilderPtr>(builder)->length();
+}
+
+value fast_length_int64_builder_byte(value builder) {
+  return caml_copy_int64(fast_length_int64_builder(builder));
+}
+
+int64_t fast_length_double_builder(value builder) {
+  return builder_of_fatptr<DoubleBuilderPtr>(builder)->length();
+}
+
+value fast_length_double_builder_byte(value builder) {
+  return caml_copy_int64(fast_length_double_builder(builder));
+}
+
+int64_t fast_length_string_builder(value builder) {
+  return builder_of_fatptr<StringBuilderPtr>(builder)->length();
+}
+
+value fast_length_string_builder_byte(value builder) {
+  return caml_copy_int64(fast_length_string_builder(builder));
+}
+
+int64_t fast_null_count_int32_builder(value builder) {
+  return builder_of_fatptr<Int32BuilderPtr>(builder)->null_count();
+}
+
+value fast_null_count_int32_builder_byte(value builder) {
+  return caml_copy_int64(fast_null_count_int32_builder(builder));
+}
+
+int64_t fast_null_count_int64_builder(value builder) {
+  return builder_of_fatptr<Int64BuilderPtr>(builder)->null_count();
+}
+
+value fast_null_count_int64_builder_byte(value builder) {
+  return caml_copy_int64(fast_null_count_int64_builder(builder));
+}
+
+int64_t fast_null_count_double_builder(value builder) {
+  return builder_of_fatptr<DoubleBuilderPtr>(builder)->null_count();
+}
+
+value fast_null_count_double_builder_byte(value builder) {
+  return caml_copy_int64(fast_null_count_double_builder(builder));
+}
+
+int64_t fast_null_count_string_builder(value builder) {
+  return builder_of_fatptr<StringBuilderPtr>(builder)->null_count();
+}
+
+value fast_null_count_string_builder_byte(value builder) {
+  return caml_copy_int64(fast_null_count_string_builder(builder));
+}
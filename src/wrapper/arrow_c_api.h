@@ -4,17 +4,28 @@
 #include<arrow/c/abi.h>
 
 #ifdef __cplusplus
+#include<mutex>
+#include<unordered_map>
+
 #include<arrow/c/bridge.h>
 #include<arrow/api.h>
+#include<arrow/compute/api.h>
 #include<arrow/csv/api.h>
 #include<arrow/io/api.h>
 #include<arrow/json/api.h>
 #include<arrow/ipc/api.h>
 #include<arrow/ipc/feather.h>
 #include<arrow/util/bitmap_ops.h>
+#include<arrow/util/parallel.h>
+#include<arrow/util/thread_pool.h>
 #include<parquet/arrow/reader.h>
+#include<parquet/arrow/schema.h>
 #include<parquet/arrow/writer.h>
 #include<parquet/exception.h>
+#include<parquet/file_writer.h>
+#include<parquet/statistics.h>
+
+#include "arrow_sketch.h"
 
 typedef std::shared_ptr<arrow::Table> TablePtr;
 typedef std::shared_ptr<arrow::ArrayBuilder> BuilderPtr;
@@ -29,10 +40,98 @@ struct ParquetReader {
   std::unique_ptr<arrow::RecordBatchReader> batch_reader;
 };
 
+struct LazyTable {
+  std::unique_ptr<parquet::arrow::FileReader> parquet_reader;
+  std::shared_ptr<arrow::ipc::feather::Reader> feather_reader;
+  std::shared_ptr<arrow::Schema> schema;
+  // Row groups boundaries, feather files are handled as a single row group.
+  std::vector<int64_t> row_group_offsets;
+  // Decoded data indexed by column then by row group.
+  std::vector<std::vector<std::shared_ptr<arrow::ChunkedArray>>> cache;
+  std::mutex mutex;
+};
+
+struct TextOptions {
+  int format;
+  bool header;
+  char delimiter;
+  int quoting;
+  std::string null_string;
+};
+
+struct TextWriter {
+  std::shared_ptr<arrow::io::FileOutputStream> file;
+  TextOptions options;
+  bool header_written;
+};
+
+struct IpcStreamWriter {
+  std::shared_ptr<arrow::io::FileOutputStream> file;
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+  int fsync_policy;
+};
+
+// Running aggregates of a bar for one aggregation.
+struct BarStats {
+  double first;
+  double last;
+  double min;
+  double max;
+  double sum;
+  double weight;
+  int64_t count;
+};
+
+struct ResampleAgg {
+  int kind;
+  std::string value_name;
+  int value_idx;
+  // Volume column for vwaps.
+  std::string weight_name;
+  int weight_idx;
+  std::string out_name;
+};
+
+struct ResampleBar {
+  // Groups are numbered by order of first appearance.
+  int64_t group;
+  // Start of the bar in nanoseconds since the epoch.
+  int64_t bucket;
+  std::vector<BarStats> stats;
+};
+
+struct Resampler {
+  std::string time_name;
+  int time_idx;
+  // Bucket size in nanoseconds.
+  int64_t every;
+  // Utc offsets of the time zone in nanoseconds, with the time from which
+  // each of them applies.
+  std::vector<int64_t> zone_starts;
+  std::vector<int64_t> zone_offsets;
+  std::vector<std::string> by_names;
+  std::vector<int> by_idxs;
+  std::vector<ResampleAgg> aggs;
+  // Set when the first table gets pushed.
+  int64_t unit;
+  std::shared_ptr<arrow::Field> time_field;
+  std::vector<std::shared_ptr<arrow::Field>> key_fields;
+  // Group indexes by serialized key, with the key values and open bar of
+  // each group.
+  std::unordered_map<std::string, int64_t> group_index;
+  std::vector<std::vector<std::shared_ptr<arrow::Array>>> group_keys;
+  std::vector<ResampleBar> open_bars;
+};
+
 extern "C" {
 #else
 typedef void TablePtr;
 typedef void ParquetReader;
+typedef void LazyTable;
+typedef void IpcStreamWriter;
+typedef void Resampler;
+typedef void Sketch;
+typedef void TextWriter;
 typedef void BuilderPtr;
 typedef void StringBuilderPtr;
 typedef void Int32BuilderPtr;
@@ -47,14 +146,16 @@ struct ArrowSchema *parquet_schema(char*, int64_t *num_rows);
 struct ArrowSchema *alloc_schema(char*, char*);
 void free_schema(struct ArrowSchema*);
 
-TablePtr *parquet_read_table(char *, int *col_idxs, int ncols, int use_threads, int64_t only_first);
-TablePtr *feather_read_table(char *, int *col_idxs, int ncols);
-TablePtr *csv_read_table(char *);
-TablePtr *json_read_table(char *);
+TablePtr *parquet_read_table(char *, int *col_idxs, int ncols, int use_threads, int64_t only_first, int io, int parallelism);
+TablePtr *feather_read_table(char *, int *col_idxs, int ncols, int io);
+TablePtr *csv_read_table(char *, int io, char **col_names, char **col_formats, int ncols);
+TablePtr *json_read_table(char *, int io);
+void convert_to_parquet(char *src, char *dst, int format, char **col_names, char **col_formats, int ncols, int64_t row_group_rows, int compression, int max_in_flight, int64_t *stats);
 TablePtr *table_concatenate(TablePtr **tables, int ntables);
 TablePtr *table_slice(TablePtr*, int64_t, int64_t);
 int64_t table_num_rows(TablePtr*);
 struct ArrowSchema *table_schema(TablePtr*);
+int64_t table_schema_fingerprint(TablePtr*);
 void free_table(TablePtr*);
 
 int timestamp_unit_in_ns(TablePtr*, char*, int);
@@ -65,6 +166,21 @@ struct ArrowArray *table_chunked_column(TablePtr *reader, int column_idx, int *n
 struct ArrowArray *table_chunked_column_by_name(TablePtr *reader, char *column_name, int *nchunks, int dt);
 void free_chunked_column(struct ArrowArray *, int nchunks);
 
+void utf8_predicate(TablePtr *table, char *column_name, int column_idx, int kind, char **values, int nvalues, uint8_t *out);
+void utf8_length(TablePtr *table, char *column_name, int column_idx, int32_t *out);
+TablePtr *table_filter(TablePtr *table, uint8_t *mask, int64_t length);
+void bitmap_binary_op(uint8_t *left, uint8_t *right, int64_t length, int op, uint8_t *out);
+void bitmap_invert(uint8_t *bitmap, int64_t length, uint8_t *out);
+int64_t bitmap_count_set_bits(uint8_t *bitmap, int64_t offset, int64_t length);
+int64_t bitmap_find_next_set(uint8_t *bitmap, int64_t offset, int64_t length);
+int64_t bitmap_compress(uint8_t *bitmap, int64_t length, void *src, int elt_size, void *dst);
+void bitmap_expand(uint8_t *bitmap, int64_t length, void *src, int elt_size, void *dst);
+void table_hash_rows(TablePtr *table, char **col_names, int *col_idxs, int ncols, int64_t *out);
+void table_partition_by_hash(TablePtr *table, char **col_names, int *col_idxs, int ncols, int n, TablePtr **out);
+TablePtr *table_distinct(TablePtr *table, char **col_names, int *col_idxs, int ncols, int keep_last);
+TablePtr *table_top_k(TablePtr *table, char *column_name, int column_idx, int64_t k, int smallest, char **group_names, int *group_idxs, int ngroup_cols);
+TablePtr *table_rolling(TablePtr *table, char *time_name, int time_idx, int64_t max_gap, char **by_names, int *by_idxs, int nby, char **value_names, int *value_idxs, int *aggs, char **out_names, int naggs);
+
 TablePtr *table_add_all_columns(TablePtr*, TablePtr*);
 TablePtr *table_add_column(TablePtr*, char*, ChunkedArrayPtr*);
 ChunkedArrayPtr *table_get_column(TablePtr*, char*);
@@ -72,16 +188,62 @@ void free_chunked_array(ChunkedArrayPtr*);
 
 TablePtr *create_table(struct ArrowArray *array, struct ArrowSchema *schema);
 void arrow_write_file(char *filename, struct ArrowArray *, struct ArrowSchema *, int chunk_size);
-void parquet_write_file(char *filename, struct ArrowArray *, struct ArrowSchema *, int chunk_size, int compression);
+void parquet_write_file(char *filename, struct ArrowArray *, struct ArrowSchema *, int chunk_size, int compression, char **bloom_filter_columns, int n_bloom_filter_columns);
 void feather_write_file(char *filename, struct ArrowArray *, struct ArrowSchema *, int chunk_size, int compression);
-void parquet_write_table(char *filename, TablePtr *table, int chunk_size, int compression);
+void parquet_write_table(char *filename, TablePtr *table, int chunk_size, int compression, char **bloom_filter_columns, int n_bloom_filter_columns);
 void feather_write_table(char *filename, TablePtr *table, int chunk_size, int compression);
 
-ParquetReader *parquet_reader_open(char *filename, int *col_idxs, int ncols, int use_threads, int mmap, int buffer_size, int batch_size);
+int arrow_io_uring_available();
+void arrow_set_huge_page_threshold(int64_t threshold);
+int64_t arrow_bytes_allocated();
+int64_t arrow_max_memory();
+int64_t arrow_huge_page_allocations();
+ParquetReader *parquet_reader_open(char *filename, int *col_idxs, int ncols, int use_threads, int io, int buffer_size, int batch_size);
 TablePtr *parquet_reader_next(ParquetReader *pr);
 void parquet_reader_close(ParquetReader *pr);
 void parquet_reader_free(ParquetReader *pr);
 
+LazyTable *lazy_table_open(char *filename, int format, int use_threads, int io);
+struct ArrowSchema *lazy_table_schema(LazyTable *t);
+int64_t lazy_table_num_rows(LazyTable *t);
+TablePtr *lazy_table_read(LazyTable *t, int *col_idxs, int ncols, int64_t offset, int64_t length);
+void lazy_table_free(LazyTable *t);
+
+TextWriter *text_writer_open(char *filename, int format, int header, char delimiter, int quoting, char *null_string);
+void text_writer_write(TextWriter *w, TablePtr *table);
+void text_writer_close(TextWriter *w);
+void text_writer_free(TextWriter *w);
+
+IpcStreamWriter *ipc_stream_writer_open(char *filename, int fsync_policy);
+void ipc_stream_writer_append(IpcStreamWriter *w, TablePtr *table);
+void ipc_stream_writer_flush(IpcStreamWriter *w);
+void ipc_stream_writer_close(IpcStreamWriter *w);
+void ipc_stream_writer_free(IpcStreamWriter *w);
+TablePtr *ipc_stream_read_table(char *filename, int io);
+
+Resampler *resampler_create(char *time_name, int time_idx, int64_t every, int64_t *zone_starts, int64_t *zone_offsets, int nzone, char **by_names, int *by_idxs, int nby, int *agg_kinds, char **value_names, int *value_idxs, char **weight_names, int *weight_idxs, char **out_names, int naggs);
+TablePtr *resampler_push(Resampler *r, TablePtr *table);
+TablePtr *resampler_finish(Resampler *r);
+void resampler_free(Resampler *r);
+TablePtr *table_resample(TablePtr *table, char *time_name, int time_idx, int64_t every, int64_t *zone_starts, int64_t *zone_offsets, int nzone, char **by_names, int *by_idxs, int nby, int *agg_kinds, char **value_names, int *value_idxs, char **weight_names, int *weight_idxs, char **out_names, int naggs);
+
+Sketch *sketch_create(double compression, int hll_precision);
+void sketch_update(Sketch *sketch, TablePtr *table, char *column_name, int column_idx);
+void sketch_merge(Sketch *sketch, Sketch *other);
+char *sketch_serialize(Sketch *sketch, int64_t *length);
+Sketch *sketch_deserialize(char *data, int64_t length);
+int64_t sketch_count(Sketch *sketch);
+int64_t sketch_null_count(Sketch *sketch);
+double sketch_min(Sketch *sketch);
+double sketch_max(Sketch *sketch);
+double sketch_quantile(Sketch *sketch, double q);
+double sketch_distinct_count(Sketch *sketch);
+void sketch_free(Sketch *sketch);
+
+TablePtr *parquet_lookup_int64(char *filename, char *column_name, int64_t *values, int nvalues, int *col_idxs, int ncols, int use_threads, int io);
+TablePtr *parquet_lookup_utf8(char *filename, char *column_name, char **values, int nvalues, int *col_idxs, int ncols, int use_threads, int io);
+TablePtr *parquet_sample(char *filename, int *col_idxs, int ncols, int64_t n, double fraction, char *stratify_column, int64_t seed, int use_threads, int io);
+
 Int32BuilderPtr *create_int32_builder();
 Int64BuilderPtr *create_int64_builder();
 DoubleBuilderPtr *create_double_builder();
@@ -2,12 +2,21 @@ module F = F
 module Builder = Builder
 module Column = Wrapper.Column
 module Compression = Compression
+module Convert = Wrapper.Convert
 module Datatype = Datatype
 module Feather_reader = Wrapper.Feather_reader
+module Io = Wrapper.Io
+module Ipc_stream = Wrapper.Ipc_stream
 module Schema = Wrapper.Schema
+module Sketch = Wrapper.Sketch
 module Parquet_reader = Parquet_reader
 module File_reader = File_reader
+module Lazy_table = Lazy_table
+module Memory = Wrapper.Memory
+module Resample_agg = Wrapper.Resample_agg
+module Resampler = Wrapper.Resampler
 module Table = Table
+module Text_writer = Wrapper.Text_writer
 module Valid = Valid
 module Wrapper = Wrapper
 module Writer = Writer
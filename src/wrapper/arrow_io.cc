@@ -0,0 +1,831 @@
+/* File access backends.
+   On top of arrow's pread and mmap based files, this provides a random access
+   file doing its reads through io_uring: reads are submitted asynchronously to
+   a ring shared by all the files and completed by a reaper thread, so that
+   many reads can be in flight at once, e.g. when parquet pre-buffers column
+   chunks. Small reads go through pre-registered buffers.
+
+   The direct file is meant for one-pass scans of large files: reads bypass the
+   page cache so that they do not evict the data used by other processes. */
+#include "arrow_io.h"
+#include "arrow_memory.h"
+
+#include<atomic>
+#include<condition_variable>
+#include<cstring>
+#include<map>
+#include<mutex>
+#include<stdexcept>
+#include<thread>
+#include<unordered_set>
+#include<utility>
+#include<vector>
+
+#include<arrow/util/future.h>
+#include<arrow/util/thread_pool.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define OCAML_ARROW_HAS_IO_URING
+#endif
+#endif
+
+#if defined(__unix__)
+#include<cerrno>
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+namespace {
+
+struct FileDescriptor {
+  int fd;
+  ~FileDescriptor() { close(fd); }
+};
+
+// Returns the descriptor [fd] opened for [filename] along with the file size.
+std::pair<std::shared_ptr<FileDescriptor>, int64_t> wrap_fd(int fd, const char *filename) {
+  if (fd < 0) throw std::invalid_argument(std::string("cannot open ") + filename + ": " + strerror(errno));
+  auto file = std::make_shared<FileDescriptor>();
+  file->fd = fd;
+  struct stat st;
+  if (fstat(fd, &st) < 0) throw std::invalid_argument(std::string("cannot stat ") + filename + ": " + strerror(errno));
+  return {std::move(file), st.st_size};
+}
+
+// Covers the logical block size of the usual devices and filesystems.
+const int64_t direct_alignment = 4096;
+// Minimum size of the reads, smaller reads are served from the last window.
+const int64_t direct_window_size = 8 << 20;
+
+int64_t align_down(int64_t v) { return v & ~(direct_alignment - 1); }
+int64_t align_up(int64_t v) { return align_down(v + direct_alignment - 1); }
+
+// Sequential reads go through large aligned windows allocated from the memory
+// pool, the returned buffers are slices of these windows. Reads that do not
+// continue the current window, e.g. parquet footers or column chunks read in
+// parallel, get their own aligned buffer sized to the request and run without
+// holding the file lock. When O_DIRECT is not supported, e.g. on tmpfs, reads
+// use plain pread and the pages are then dropped from the page cache.
+class DirectFile : public arrow::io::RandomAccessFile {
+ public:
+  DirectFile(std::shared_ptr<FileDescriptor> file, int64_t size, bool direct)
+    : file_(std::move(file)), size_(size), direct_(direct) {}
+
+  arrow::Status Close() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_.reset();
+    window_ = Window();
+    return arrow::Status::OK();
+  }
+
+  bool closed() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ == nullptr;
+  }
+
+  arrow::Result<int64_t> Tell() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return position_;
+  }
+
+  arrow::Status Seek(int64_t position) override {
+    if (position < 0) return arrow::Status::Invalid("negative seek position");
+    std::lock_guard<std::mutex> lock(mutex_);
+    position_ = position;
+    return arrow::Status::OK();
+  }
+
+  arrow::Result<int64_t> GetSize() override { return size_; }
+
+  arrow::Result<int64_t> Read(int64_t nbytes, void *out) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ARROW_ASSIGN_OR_RAISE(auto buffer, ReadAtLocked(position_, nbytes));
+    memcpy(out, buffer->data(), buffer->size());
+    position_ += buffer->size();
+    return buffer->size();
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ARROW_ASSIGN_OR_RAISE(auto buffer, ReadAtLocked(position_, nbytes));
+    position_ += buffer->size();
+    return buffer;
+  }
+
+  arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void *out) override {
+    ARROW_ASSIGN_OR_RAISE(auto buffer, ReadAt(position, nbytes));
+    memcpy(out, buffer->data(), buffer->size());
+    return buffer->size();
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position, int64_t nbytes) override {
+    std::shared_ptr<FileDescriptor> file;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (window_.buffer && position >= window_.position
+          && position <= window_.position + window_.length)
+        return ReadAtLocked(position, nbytes);
+      file = file_;
+    }
+    if (!file) return arrow::Status::Invalid("operation on closed file");
+    if (position < 0 || nbytes < 0) return arrow::Status::Invalid("invalid read range");
+    nbytes = std::max<int64_t>(0, std::min(nbytes, size_ - position));
+    int64_t start = align_down(position);
+    ARROW_ASSIGN_OR_RAISE(Window window,
+                          ReadWindow(*file, start, align_up(position + nbytes) - start));
+    return Slice(window, position, nbytes);
+  }
+
+ private:
+  // [length] bytes read at [position], starting at [offset] in [buffer].
+  struct Window {
+    std::shared_ptr<arrow::Buffer> buffer;
+    int64_t offset = 0;
+    int64_t position = 0;
+    int64_t length = 0;
+  };
+
+  static std::shared_ptr<arrow::Buffer> Slice(const Window &window, int64_t position, int64_t nbytes) {
+    int64_t offset = position - window.position;
+    nbytes = std::max<int64_t>(0, std::min(nbytes, window.length - offset));
+    return arrow::SliceBuffer(window.buffer, window.offset + offset, nbytes);
+  }
+
+  // Called with [mutex_] held, reads continuing the current window go through
+  // a new window of at least [direct_window_size] bytes.
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAtLocked(int64_t position, int64_t nbytes) {
+    if (!file_) return arrow::Status::Invalid("operation on closed file");
+    if (position < 0 || nbytes < 0) return arrow::Status::Invalid("invalid read range");
+    nbytes = std::max<int64_t>(0, std::min(nbytes, size_ - position));
+    bool in_window = window_.buffer && position >= window_.position
+      && position + nbytes <= window_.position + window_.length;
+    if (!in_window) {
+      int64_t start = align_down(position);
+      int64_t length = std::max(align_up(position + nbytes) - start, direct_window_size);
+      ARROW_ASSIGN_OR_RAISE(window_, ReadWindow(*file_, start, length));
+    }
+    return Slice(window_, position, nbytes);
+  }
+
+  // Reads [length] bytes at the aligned offset [start] in a new window, up to
+  // the end of the file. Does not need [mutex_].
+  arrow::Result<Window> ReadWindow(const FileDescriptor &file, int64_t start, int64_t length) {
+    length = std::max<int64_t>(0, std::min(length, align_up(size_) - start));
+    ARROW_ASSIGN_OR_RAISE(std::shared_ptr<arrow::Buffer> buffer,
+                          arrow::AllocateBuffer(length + direct_alignment, memory_pool()));
+    int64_t offset = (direct_alignment - (int64_t)((uintptr_t)buffer->data() % direct_alignment)) % direct_alignment;
+    uint8_t *dst = buffer->mutable_data() + offset;
+    int64_t done = 0;
+    while (done < length) {
+      ssize_t ret = pread(file.fd, dst + done, length - done, start + done);
+      if (ret < 0) {
+        if (errno == EINTR) continue;
+#ifdef O_DIRECT
+        // Some filesystems accept O_DIRECT at open time but not for reads.
+        if (errno == EINVAL && direct_ && done == 0) {
+          int flags = fcntl(file.fd, F_GETFL);
+          if (flags < 0 || fcntl(file.fd, F_SETFL, flags & ~O_DIRECT) < 0)
+            return arrow::Status::IOError("cannot disable O_DIRECT: ", strerror(errno));
+          direct_ = false;
+          continue;
+        }
+#endif
+        return arrow::Status::IOError("read failed: ", strerror(errno));
+      }
+      if (ret == 0) break;
+      done += ret;
+      // The last read stops at the end of the file. Another short read would
+      // leave an unaligned offset that O_DIRECT rejects.
+      if (start + done >= size_ || (direct_ && done % direct_alignment != 0)) break;
+    }
+    if (!direct_) posix_fadvise(file.fd, start, done, POSIX_FADV_DONTNEED);
+    Window window;
+    window.buffer = std::move(buffer);
+    window.offset = offset;
+    window.position = start;
+    window.length = done;
+    return window;
+  }
+
+  mutable std::mutex mutex_;
+  std::shared_ptr<FileDescriptor> file_;
+  int64_t size_;
+  int64_t position_ = 0;
+  // Cleared by any thread when falling back to plain reads.
+  std::atomic<bool> direct_;
+  Window window_;
+};
+
+std::shared_ptr<arrow::io::RandomAccessFile> open_direct(const char *filename) {
+  int fd = -1;
+#ifdef O_DIRECT
+  fd = open(filename, O_RDONLY | O_CLOEXEC | O_DIRECT);
+#endif
+  bool direct = fd >= 0;
+  if (!direct) fd = open(filename, O_RDONLY | O_CLOEXEC);
+  auto file = wrap_fd(fd, filename);
+  return std::make_shared<DirectFile>(std::move(file.first), file.second, direct);
+}
+
+}  // namespace
+
+#else
+
+namespace {
+
+std::shared_ptr<arrow::io::RandomAccessFile> open_direct(const char *) {
+  return nullptr;
+}
+
+}  // namespace
+
+#endif
+
+#ifdef OCAML_ARROW_HAS_IO_URING
+#include<linux/io_uring.h>
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<sys/uio.h>
+
+namespace {
+
+// Lets a synchronous read wait for its completion without going through a
+// future, see [UringFile::ReadSync].
+struct SyncWaiter {
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done = false;
+  arrow::Result<std::shared_ptr<arrow::Buffer>> result;
+
+  void set(arrow::Result<std::shared_ptr<arrow::Buffer>> r) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      result = std::move(r);
+      done = true;
+    }
+    done_cv.notify_all();
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [&] { return done; });
+    return std::move(result);
+  }
+};
+
+struct UringRequest {
+  std::shared_ptr<FileDescriptor> file;
+  int64_t position;
+  uint8_t *dst;
+  int64_t nbytes;
+  int64_t done;
+  // Index of the registered buffer used for the read, -1 to read in [dst].
+  int buf_index;
+  struct iovec iov;
+  // Keeps [dst] alive, null when reading in a caller provided area.
+  std::shared_ptr<arrow::ResizableBuffer> buffer;
+  // Synchronous reads set [waiter], the other ones complete [future].
+  std::shared_ptr<SyncWaiter> waiter;
+  arrow::Future<std::shared_ptr<arrow::Buffer>> future;
+};
+
+const unsigned num_entries = 256;
+const int num_registered_buffers = 32;
+const int64_t registered_buffer_size = 256 * 1024;
+// Limits the size of a single read submission.
+const int64_t max_read_size = 1 << 30;
+// Limits the number of ranges a file keeps from [WillNeed].
+const size_t max_prefetched = 4096;
+// Threads running the callbacks of the completed futures.
+const int num_completion_threads = 2;
+
+class Ring {
+ public:
+  // Returns nullptr if io_uring is not supported.
+  static Ring *get() {
+    static Ring *ring = create();
+    return ring;
+  }
+
+  // Submits all the requests with a single system call, blocking while the
+  // maximum number of requests are in flight. Once the ring has failed, the
+  // requests fail right away.
+  void submit(const std::vector<UringRequest*> &requests) {
+    size_t i = 0;
+    while (i < requests.size()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      not_full_.wait(lock, [&] { return failed_ || in_flight_ < max_in_flight_; });
+      if (failed_) {
+        lock.unlock();
+        for (; i < requests.size(); ++i) {
+          std::unique_ptr<UringRequest> owned(requests[i]);
+          finish(*owned, arrow::Status::IOError("io_uring ring has failed"));
+        }
+        return;
+      }
+      unsigned n = 0;
+      for (; i < requests.size() && in_flight_ < max_in_flight_; ++i, ++n) {
+        in_flight_++;
+        pending_.insert(requests[i]);
+        assign_buffer(requests[i]);
+        push_sqe(requests[i]);
+      }
+      enter(n, lock);
+    }
+  }
+
+ private:
+  Ring() = default;
+
+  static Ring *create() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, num_entries, &params);
+    if (fd < 0) return nullptr;
+    Ring *ring = new Ring();
+    ring->fd_ = fd;
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_size = cq_size = std::max(sq_size, cq_size);
+    uint8_t *sq_ptr = (uint8_t*)mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+      close(fd);
+      delete ring;
+      return nullptr;
+    }
+    uint8_t *cq_ptr = sq_ptr;
+    if (!single_mmap) {
+      cq_ptr = (uint8_t*)mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    void *sqes = mmap(nullptr, params.sq_entries * sizeof(struct io_uring_sqe),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (cq_ptr == MAP_FAILED || sqes == MAP_FAILED) {
+      close(fd);
+      delete ring;
+      return nullptr;
+    }
+    ring->sq_tail_ = (unsigned*)(sq_ptr + params.sq_off.tail);
+    ring->sq_mask_ = *(unsigned*)(sq_ptr + params.sq_off.ring_mask);
+    ring->sq_array_ = (unsigned*)(sq_ptr + params.sq_off.array);
+    ring->sqes_ = (struct io_uring_sqe*)sqes;
+    ring->cq_head_ = (unsigned*)(cq_ptr + params.cq_off.head);
+    ring->cq_tail_ = (unsigned*)(cq_ptr + params.cq_off.tail);
+    ring->cq_mask_ = *(unsigned*)(cq_ptr + params.cq_off.ring_mask);
+    ring->cqes_ = (struct io_uring_cqe*)(cq_ptr + params.cq_off.cqes);
+    ring->max_in_flight_ = std::min(params.sq_entries, params.cq_entries);
+    ring->register_buffers();
+    auto completions = arrow::internal::ThreadPool::Make(num_completion_threads);
+    if (completions.ok()) ring->completions_ = std::move(completions).ValueOrDie();
+    // The ring lives as long as the process, so does its reaper thread.
+    std::thread([ring]() { ring->reap(); }).detach();
+    return ring;
+  }
+
+  // Registered buffers avoid mapping the destination pages for each read.
+  // This is optional as registering can fail because of RLIMIT_MEMLOCK.
+  void register_buffers() {
+    std::vector<struct iovec> iovecs;
+    for (int i = 0; i < num_registered_buffers; ++i) {
+      void *ptr = nullptr;
+      if (posix_memalign(&ptr, 4096, registered_buffer_size)) break;
+      iovecs.push_back({ptr, (size_t)registered_buffer_size});
+    }
+    int ret = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                      iovecs.data(), (unsigned)iovecs.size());
+    if (ret < 0) {
+      for (auto &iov : iovecs) free(iov.iov_base);
+      return;
+    }
+    for (size_t i = 0; i < iovecs.size(); ++i) {
+      registered_buffers_.push_back((uint8_t*)iovecs[i].iov_base);
+      free_buffers_.push_back(i);
+    }
+  }
+
+  // Called with [mutex_] held.
+  void assign_buffer(UringRequest *request) {
+    request->buf_index = -1;
+    if (request->nbytes <= registered_buffer_size && !free_buffers_.empty()) {
+      request->buf_index = free_buffers_.back();
+      free_buffers_.pop_back();
+    }
+  }
+
+  // Called with [mutex_] held.
+  void push_sqe(UringRequest *request) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    int64_t remaining = std::min(request->nbytes - request->done, max_read_size);
+    sqe->fd = request->file->fd;
+    sqe->off = request->position + request->done;
+    sqe->user_data = (uint64_t)(uintptr_t)request;
+    if (request->buf_index >= 0) {
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->addr = (uint64_t)(uintptr_t)(registered_buffers_[request->buf_index] + request->done);
+      sqe->len = remaining;
+      sqe->buf_index = request->buf_index;
+    } else {
+      // readv is supported by older kernels than read.
+      request->iov.iov_base = request->dst + request->done;
+      request->iov.iov_len = remaining;
+      sqe->opcode = IORING_OP_READV;
+      sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+      sqe->len = 1;
+    }
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // Called with [mutex_] held through [lock]. Submission queue entries that
+  // could not be submitted would be picked up by a later call and complete
+  // requests that have been released in the meantime, so any failure here
+  // fails the whole ring.
+  void enter(unsigned to_submit, std::unique_lock<std::mutex> &lock) {
+    while (to_submit > 0) {
+      int ret = syscall(__NR_io_uring_enter, fd_, to_submit, 0, 0, nullptr, 0);
+      if (ret < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+        fail_all(arrow::Status::IOError("io_uring_enter failed: ", strerror(errno)), lock);
+        return;
+      }
+      to_submit -= ret;
+    }
+  }
+
+  // Fails all the pending requests, called with [mutex_] held through [lock]
+  // which gets released. The kernel cannot be relied on to complete them any
+  // more, so the ring is not used afterwards.
+  void fail_all(const arrow::Status &status, std::unique_lock<std::mutex> &lock) {
+    failed_ = true;
+    std::unordered_set<UringRequest*> requests;
+    requests.swap(pending_);
+    in_flight_ -= requests.size();
+    not_full_.notify_all();
+    lock.unlock();
+    for (UringRequest *request : requests) {
+      std::unique_ptr<UringRequest> owned(request);
+      finish(*owned, status);
+    }
+  }
+
+  // Synchronous readers are woken up right away. Future callbacks run arbitrary
+  // code, e.g. submitting new reads that wait for other requests to complete,
+  // so futures are marked finished on the ring's own completion threads: not
+  // on the reaper thread, and not on the IO executor either as its threads may
+  // all be blocked in synchronous reads.
+  void finish(UringRequest &request, arrow::Result<std::shared_ptr<arrow::Buffer>> result) {
+    if (request.waiter) {
+      request.waiter->set(std::move(result));
+      return;
+    }
+    auto future = request.future;
+    if (completions_) {
+      arrow::Status st = completions_->Spawn([future, result]() mutable {
+        future.MarkFinished(std::move(result));
+      });
+      if (st.ok()) return;
+    }
+    future.MarkFinished(std::move(result));
+  }
+
+  // Resubmits the remaining part of [request], which fails if the ring has
+  // failed in the meantime.
+  void resubmit(UringRequest *request) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_) {
+      in_flight_--;
+      lock.unlock();
+      std::unique_ptr<UringRequest> owned(request);
+      finish(*owned, arrow::Status::IOError("io_uring ring has failed"));
+      return;
+    }
+    pending_.insert(request);
+    push_sqe(request);
+    enter(1, lock);
+  }
+
+  void complete(UringRequest *request, int res) {
+    if (res == -EINTR || res == -EAGAIN) {
+      resubmit(request);
+      return;
+    }
+    if (res > 0) {
+      if (request->buf_index >= 0) {
+        memcpy(request->dst + request->done,
+               registered_buffers_[request->buf_index] + request->done,
+               res);
+      }
+      request->done += res;
+      if (request->done < request->nbytes) {
+        // Short read, submit the remaining part.
+        resubmit(request);
+        return;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (request->buf_index >= 0) free_buffers_.push_back(request->buf_index);
+      in_flight_--;
+      not_full_.notify_one();
+    }
+    std::unique_ptr<UringRequest> owned(request);
+    if (res < 0) {
+      finish(*owned, arrow::Status::IOError("io_uring read failed: ", strerror(-res)));
+      return;
+    }
+    std::shared_ptr<arrow::Buffer> result;
+    if (owned->buffer) {
+      arrow::Status st = owned->buffer->Resize(owned->done, false);
+      if (!st.ok()) {
+        finish(*owned, st);
+        return;
+      }
+      result = std::move(owned->buffer);
+    } else {
+      result = std::make_shared<arrow::Buffer>(owned->dst, owned->done);
+    }
+    finish(*owned, std::move(result));
+  }
+
+  void reap() {
+    while (true) {
+      int ret = syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (ret < 0 && errno != EINTR) {
+        // Nothing would complete the in flight requests otherwise.
+        std::unique_lock<std::mutex> lock(mutex_);
+        fail_all(arrow::Status::IOError("io_uring_enter failed: ", strerror(errno)), lock);
+        return;
+      }
+      unsigned head = *cq_head_;
+      unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      std::vector<std::pair<UringRequest*, int>> completed;
+      {
+        // Requests are no longer pending once claimed here, so [fail_all]
+        // leaves them alone. Requests that are not pending have already failed.
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (; head != tail; ++head) {
+          struct io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+          UringRequest *request = (UringRequest*)(uintptr_t)cqe->user_data;
+          if (pending_.erase(request)) completed.emplace_back(request, cqe->res);
+        }
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      // Completions may resubmit short reads.
+      for (auto &c : completed) complete(c.first, c.second);
+    }
+  }
+
+  int fd_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  struct io_uring_sqe *sqes_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  struct io_uring_cqe *cqes_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  unsigned in_flight_ = 0;
+  unsigned max_in_flight_;
+  // The submitted requests that have not been claimed by the reaper yet.
+  std::unordered_set<UringRequest*> pending_;
+  // Set once the ring cannot be used any more.
+  bool failed_ = false;
+  std::vector<uint8_t*> registered_buffers_;
+  std::vector<int> free_buffers_;
+  // Null if the threads could not be started, futures are then marked
+  // finished on the reaper thread.
+  std::shared_ptr<arrow::internal::ThreadPool> completions_;
+};
+
+class UringFile : public arrow::io::RandomAccessFile {
+ public:
+  UringFile(std::shared_ptr<FileDescriptor> file, int64_t size, Ring *ring)
+    : file_(std::move(file)), size_(size), ring_(ring) {}
+
+  arrow::Status Close() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // In flight requests keep the descriptor open until they complete.
+    file_.reset();
+    prefetched_.clear();
+    return arrow::Status::OK();
+  }
+
+  bool closed() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ == nullptr;
+  }
+
+  arrow::Result<int64_t> Tell() const override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return position_;
+  }
+
+  arrow::Status Seek(int64_t position) override {
+    if (position < 0) return arrow::Status::Invalid("negative seek position");
+    std::lock_guard<std::mutex> lock(mutex_);
+    position_ = position;
+    return arrow::Status::OK();
+  }
+
+  arrow::Result<int64_t> GetSize() override { return size_; }
+
+  arrow::Result<int64_t> Read(int64_t nbytes, void *out) override {
+    int64_t position;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      position = position_;
+    }
+    ARROW_ASSIGN_OR_RAISE(int64_t bytes_read, ReadAt(position, nbytes, out));
+    std::lock_guard<std::mutex> lock(mutex_);
+    position_ = position + bytes_read;
+    return bytes_read;
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override {
+    int64_t position;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      position = position_;
+    }
+    ARROW_ASSIGN_OR_RAISE(auto buffer, ReadAt(position, nbytes));
+    std::lock_guard<std::mutex> lock(mutex_);
+    position_ = position + buffer->size();
+    return buffer;
+  }
+
+  arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void *out) override {
+    ARROW_ASSIGN_OR_RAISE(auto buffer, ReadSync(position, nbytes, (uint8_t*)out));
+    return buffer->size();
+  }
+
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position, int64_t nbytes) override {
+    arrow::Future<std::shared_ptr<arrow::Buffer>> future;
+    if (TakePrefetched(position, nbytes, &future)) return future.result();
+    return ReadSync(position, nbytes, nullptr);
+  }
+
+  arrow::Future<std::shared_ptr<arrow::Buffer>> ReadAsync(const arrow::io::IOContext&,
+                                                          int64_t position,
+                                                          int64_t nbytes) override {
+    arrow::Future<std::shared_ptr<arrow::Buffer>> future;
+    if (TakePrefetched(position, nbytes, &future)) return future;
+    auto request = MakeRequest(position, nbytes, nullptr);
+    if (!request.ok()) return arrow::Future<std::shared_ptr<arrow::Buffer>>::MakeFinished(request.status());
+    future = (*request)->future;
+    ring_->submit({request->release()});
+    return future;
+  }
+
+  // All the ranges get submitted at once, the following reads of these exact
+  // ranges then wait on the in flight requests. At most [max_prefetched] ranges
+  // are kept, the ones with the lowest offsets get dropped first as readers
+  // mostly move forward; dropped reads still complete but are not reused.
+  arrow::Status WillNeed(const std::vector<arrow::io::ReadRange> &ranges) override {
+    std::vector<UringRequest*> requests;
+    std::vector<std::pair<std::pair<int64_t, int64_t>, arrow::Future<std::shared_ptr<arrow::Buffer>>>> futures;
+    for (auto &range : ranges) {
+      auto request = MakeRequest(range.offset, range.length, nullptr);
+      if (!request.ok()) {
+        for (auto r : requests) delete r;
+        return request.status();
+      }
+      futures.emplace_back(std::make_pair(range.offset, range.length), (*request)->future);
+      requests.push_back(request->release());
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto &f : futures) prefetched_[f.first] = f.second;
+      while (prefetched_.size() > max_prefetched) prefetched_.erase(prefetched_.begin());
+    }
+    ring_->submit(requests);
+    return arrow::Status::OK();
+  }
+
+ private:
+  // Returns true and the in flight read in [future] if [WillNeed] got this
+  // exact range.
+  bool TakePrefetched(int64_t position,
+                      int64_t nbytes,
+                      arrow::Future<std::shared_ptr<arrow::Buffer>> *future) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = prefetched_.find({position, nbytes});
+    if (it != prefetched_.end()) {
+      *future = it->second;
+      prefetched_.erase(it);
+      return true;
+    }
+    // The reader went for a different range, the prefetched ranges it covers
+    // are unlikely to be read again.
+    EvictOverlapping(position, nbytes);
+    return false;
+  }
+
+  // The reaper thread wakes synchronous readers up directly: the IPC, feather
+  // and csv readers call [ReadAt] from the IO executor threads, so nothing
+  // waited on here may need a thread from that executor to complete.
+  arrow::Result<std::shared_ptr<arrow::Buffer>> ReadSync(int64_t position, int64_t nbytes, uint8_t *dst) {
+    ARROW_ASSIGN_OR_RAISE(auto request, MakeRequest(position, nbytes, dst));
+    auto waiter = std::make_shared<SyncWaiter>();
+    request->waiter = waiter;
+    ring_->submit({request.release()});
+    return waiter->wait();
+  }
+
+  // Reads in [dst] when not null, in a newly allocated buffer otherwise.
+  arrow::Result<std::unique_ptr<UringRequest>> MakeRequest(int64_t position, int64_t nbytes, uint8_t *dst) {
+    std::shared_ptr<FileDescriptor> file;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      file = file_;
+    }
+    if (!file) return arrow::Status::Invalid("operation on closed file");
+    if (position < 0 || nbytes < 0) return arrow::Status::Invalid("invalid read range");
+    nbytes = std::max<int64_t>(0, std::min(nbytes, size_ - position));
+    std::unique_ptr<UringRequest> request(new UringRequest());
+    request->file = std::move(file);
+    request->position = position;
+    request->nbytes = nbytes;
+    request->done = 0;
+    request->future = arrow::Future<std::shared_ptr<arrow::Buffer>>::Make();
+    if (dst == nullptr) {
+      ARROW_ASSIGN_OR_RAISE(auto buffer, arrow::AllocateResizableBuffer(nbytes, memory_pool()));
+      request->buffer = std::move(buffer);
+      dst = request->buffer->mutable_data();
+    }
+    request->dst = dst;
+    return std::move(request);
+  }
+
+  // Called with [mutex_] held.
+  void EvictOverlapping(int64_t position, int64_t nbytes) {
+    for (auto it = prefetched_.begin(); it != prefetched_.end();) {
+      int64_t offset = it->first.first, length = it->first.second;
+      if (offset >= position + nbytes) break;
+      if (offset + length > position) it = prefetched_.erase(it);
+      else ++it;
+    }
+  }
+
+  mutable std::mutex mutex_;
+  std::shared_ptr<FileDescriptor> file_;
+  int64_t size_;
+  int64_t position_ = 0;
+  Ring *ring_;
+  std::map<std::pair<int64_t, int64_t>, arrow::Future<std::shared_ptr<arrow::Buffer>>> prefetched_;
+};
+
+std::shared_ptr<arrow::io::RandomAccessFile> open_uring(const char *filename) {
+  Ring *ring = Ring::get();
+  if (ring == nullptr) return nullptr;
+  auto file = wrap_fd(open(filename, O_RDONLY | O_CLOEXEC), filename);
+  return std::make_shared<UringFile>(std::move(file.first), file.second, ring);
+}
+
+}  // namespace
+
+bool io_uring_available() {
+  return Ring::get() != nullptr;
+}
+
+#else
+
+namespace {
+
+std::shared_ptr<arrow::io::RandomAccessFile> open_uring(const char *) {
+  return nullptr;
+}
+
+}  // namespace
+
+bool io_uring_available() {
+  return false;
+}
+
+#endif
+
+std::shared_ptr<arrow::io::RandomAccessFile> open_random_access(const char *filename, int io) {
+  if (io == io_uring) {
+    auto file = open_uring(filename);
+    if (file) return file;
+  }
+  if (io == io_direct) {
+    auto file = open_direct(filename);
+    if (file) return file;
+  }
+  if (io == io_mmap) {
+    auto file = arrow::io::MemoryMappedFile::Open(filename, arrow::io::FileMode::READ);
+    if (!file.ok()) throw std::invalid_argument(file.status().ToString());
+    return std::move(file).ValueOrDie();
+  }
+  auto file = arrow::io::ReadableFile::Open(filename, memory_pool());
+  if (!file.ok()) throw std::invalid_argument(file.status().ToString());
+  return std::move(file).ValueOrDie();
+}
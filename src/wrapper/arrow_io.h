@@ -0,0 +1,24 @@
+#ifndef __OCAML_ARROW_IO__
+#define __OCAML_ARROW_IO__
+
+#include<arrow/api.h>
+#include<arrow/io/api.h>
+
+// File access backends, the order has to match the OCaml side.
+enum io_backend {
+  io_pread = 0,
+  io_mmap = 1,
+  io_uring = 2,
+  io_direct = 3,
+};
+
+// Opens [filename] for random access reads using the [io] backend. The
+// io_uring backend falls back to pread when the kernel does not support it.
+// The direct backend bypasses the page cache with O_DIRECT, when the
+// filesystem does not support it the pages read are dropped from the cache.
+std::shared_ptr<arrow::io::RandomAccessFile> open_random_access(const char *filename, int io);
+
+// Returns true when the io_uring backend can be used on this machine.
+bool io_uring_available();
+
+#endif
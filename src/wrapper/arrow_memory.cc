@@ -0,0 +1,137 @@
+/* Huge page backed allocations.
+   Decoding large tables touches a lot of memory and 4KiB pages result in many
+   TLB misses. Large allocations are aligned on the huge page size and the
+   kernel is asked to back them with transparent huge pages, small ones keep
+   going through arrow's default pool. */
+#include "arrow_memory.h"
+
+#include<atomic>
+#include<cstdlib>
+#include<cstring>
+#include<mutex>
+#include<unordered_set>
+
+#if defined(__linux__)
+#include<sys/mman.h>
+#endif
+
+namespace {
+
+const int64_t huge_page_size = 2 << 20;
+
+std::atomic<int64_t> threshold(0);
+std::atomic<int64_t> num_huge_allocations(0);
+
+int64_t round_up(int64_t size) {
+  return (size + huge_page_size - 1) & ~(huge_page_size - 1);
+}
+
+bool is_huge(int64_t size) {
+  int64_t t = threshold.load(std::memory_order_relaxed);
+  return t > 0 && size >= t;
+}
+
+uint8_t *huge_alloc(int64_t size) {
+  void *ptr = nullptr;
+  int64_t rounded = round_up(size);
+  if (posix_memalign(&ptr, huge_page_size, rounded)) return nullptr;
+#if defined(MADV_HUGEPAGE)
+  // This is only a hint, e.g. transparent huge pages may be disabled.
+  madvise(ptr, rounded, MADV_HUGEPAGE);
+#endif
+  num_huge_allocations.fetch_add(1, std::memory_order_relaxed);
+  return (uint8_t*)ptr;
+}
+
+class HugePagePool : public arrow::MemoryPool {
+ public:
+  explicit HugePagePool(arrow::MemoryPool *pool) : pool_(pool) {}
+
+  arrow::Status Allocate(int64_t size, uint8_t **out) override {
+    if (!is_huge(size)) return pool_->Allocate(size, out);
+    uint8_t *ptr = huge_alloc(size);
+    if (ptr == nullptr) return arrow::Status::OutOfMemory("huge page allocation of ", size, " bytes failed");
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      huge_ptrs_.insert(ptr);
+    }
+    Track(size);
+    *out = ptr;
+    return arrow::Status::OK();
+  }
+
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) override {
+    bool old_huge = IsHugePtr(old_size, *ptr);
+    if (!old_huge && !is_huge(new_size)) return pool_->Reallocate(old_size, new_size, ptr);
+    if (old_huge && new_size <= round_up(old_size) && is_huge(new_size)) {
+      // The rounded allocation is large enough.
+      Track(new_size - old_size);
+      return arrow::Status::OK();
+    }
+    uint8_t *new_ptr = nullptr;
+    ARROW_RETURN_NOT_OK(Allocate(new_size, &new_ptr));
+    memcpy(new_ptr, *ptr, std::min(old_size, new_size));
+    Free(*ptr, old_size);
+    *ptr = new_ptr;
+    return arrow::Status::OK();
+  }
+
+  void Free(uint8_t *buffer, int64_t size) override {
+    if (!IsHugePtr(size, buffer)) return pool_->Free(buffer, size);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      huge_ptrs_.erase(buffer);
+    }
+    free(buffer);
+    Track(-size);
+  }
+
+  int64_t bytes_allocated() const override {
+    return pool_->bytes_allocated() + bytes_allocated_.load();
+  }
+
+  int64_t max_memory() const override {
+    return pool_->max_memory() + max_memory_.load();
+  }
+
+ private:
+  // The threshold can change while buffers are alive, so the huge pointers
+  // are tracked rather than relying on the allocation size.
+  bool IsHugePtr(int64_t size, uint8_t *ptr) {
+    if (size < huge_page_size) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return huge_ptrs_.count(ptr) > 0;
+  }
+
+  void Track(int64_t diff) {
+    int64_t allocated = bytes_allocated_.fetch_add(diff) + diff;
+    int64_t max = max_memory_.load();
+    while (allocated > max && !max_memory_.compare_exchange_weak(max, allocated)) {}
+  }
+
+  arrow::MemoryPool *pool_;
+  std::mutex mutex_;
+  std::unordered_set<uint8_t*> huge_ptrs_;
+  std::atomic<int64_t> bytes_allocated_{0};
+  std::atomic<int64_t> max_memory_{0};
+};
+
+}  // namespace
+
+arrow::MemoryPool *memory_pool() {
+  static HugePagePool *pool = new HugePagePool(arrow::default_memory_pool());
+  return pool;
+}
+
+void set_huge_page_threshold(int64_t t) {
+  threshold.store(t > 0 ? round_up(t) : 0);
+}
+
+void *huge_page_malloc(int64_t size) {
+  if (!is_huge(size)) return nullptr;
+  return huge_alloc(size);
+}
+
+int64_t huge_page_allocations() {
+  return num_huge_allocations.load();
+}
@@ -0,0 +1,23 @@
+#ifndef __OCAML_ARROW_MEMORY__
+#define __OCAML_ARROW_MEMORY__
+
+#include<arrow/memory_pool.h>
+
+// The memory pool used for the allocations done by the wrapper. Allocations
+// above the huge page threshold are backed by transparent huge pages, the
+// other ones are forwarded to arrow's default pool.
+arrow::MemoryPool *memory_pool();
+
+// Allocations of at least [threshold] bytes get backed by huge pages, 0
+// disables huge pages. The threshold is rounded up to the huge page size.
+void set_huge_page_threshold(int64_t threshold);
+
+// Returns [size] bytes of memory backed by huge pages to be released with
+// free, or nullptr when [size] is below the threshold or the allocation
+// fails. This is used for OCaml bigarrays.
+void *huge_page_malloc(int64_t size);
+
+// Number of allocations that went through huge pages since the start.
+int64_t huge_page_allocations();
+
+#endif
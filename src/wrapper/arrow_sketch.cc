@@ -0,0 +1,240 @@
+/* Streaming sketches.
+   The sketches are small and mergeable so that they can be computed per
+   batch, per file or per thread and combined afterwards. */
+#include "arrow_sketch.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<stdexcept>
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+const char sketch_magic[4] = {'O', 'A', 'S', '1'};
+
+// Serialized sketches are little-endian whatever the platform, doubles
+// being stored like integers of the same size.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const bool big_endian = true;
+#else
+const bool big_endian = false;
+#endif
+
+template<class T>
+void write_value(std::string &out, T value) {
+  char bytes[sizeof(T)];
+  memcpy(bytes, &value, sizeof(T));
+  if (big_endian) std::reverse(bytes, bytes + sizeof(T));
+  out.append(bytes, sizeof(T));
+}
+
+template<class T>
+T read_value(const std::string &in, size_t &pos) {
+  if (pos + sizeof(T) > in.size()) throw std::invalid_argument("truncated sketch");
+  char bytes[sizeof(T)];
+  memcpy(bytes, in.data() + pos, sizeof(T));
+  if (big_endian) std::reverse(bytes, bytes + sizeof(T));
+  T value;
+  memcpy(&value, bytes, sizeof(T));
+  pos += sizeof(T);
+  return value;
+}
+
+}  // namespace
+
+TDigest::TDigest(double compression)
+  : compression_(compression), total_weight_(0), min_(INFINITY), max_(-INFINITY) {
+  if (!(compression >= 10)) throw std::invalid_argument("t-digest compression has to be at least 10");
+}
+
+void TDigest::add(double value, double weight) {
+  if (std::isnan(value) || weight <= 0) return;
+  buffer_.push_back(Centroid{value, weight});
+  total_weight_ += weight;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  if (buffer_.size() >= 8 * (size_t)compression_) compress();
+}
+
+void TDigest::merge(const TDigest &other) {
+  if (other.total_weight_ == 0) return;
+  // [other] can be this digest, inserting a range of [buffer_] in itself is
+  // undefined so the incoming centroids are copied first.
+  std::vector<Centroid> incoming(other.centroids_);
+  incoming.insert(incoming.end(), other.buffer_.begin(), other.buffer_.end());
+  buffer_.insert(buffer_.end(), incoming.begin(), incoming.end());
+  total_weight_ += other.total_weight_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  compress();
+}
+
+void TDigest::compress() {
+  if (buffer_.empty()) return;
+  buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+  std::sort(buffer_.begin(), buffer_.end(), [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+  // Scale function k(q) = compression / (2 pi) asin(2q - 1), a centroid can
+  // grow as long as it spans at most one unit of k.
+  auto k = [this](double q) { return compression_ / (2 * pi) * std::asin(2 * q - 1); };
+  auto q_of_k = [this](double k) {
+    return k >= compression_ / 4 ? 1 : (std::sin(2 * pi * k / compression_) + 1) / 2;
+  };
+  centroids_.clear();
+  Centroid current = buffer_[0];
+  double weight_so_far = 0;
+  double weight_limit = total_weight_ * q_of_k(k(0) + 1);
+  for (size_t i = 1; i < buffer_.size(); ++i) {
+    const Centroid &next = buffer_[i];
+    if (weight_so_far + current.weight + next.weight <= weight_limit) {
+      current.weight += next.weight;
+      current.mean += (next.mean - current.mean) * next.weight / current.weight;
+    }
+    else {
+      weight_so_far += current.weight;
+      centroids_.push_back(current);
+      weight_limit = total_weight_ * q_of_k(k(weight_so_far / total_weight_) + 1);
+      current = next;
+    }
+  }
+  centroids_.push_back(current);
+  buffer_.clear();
+}
+
+double TDigest::quantile(double q) {
+  compress();
+  if (centroids_.empty()) return NAN;
+  if (q <= 0) return min_;
+  if (q >= 1) return max_;
+  if (centroids_.size() == 1) return centroids_[0].mean;
+  // Values are interpolated between the centroid centers, and between the
+  // extreme centroids and the exact min and max.
+  double target = q * total_weight_;
+  const Centroid &first = centroids_.front();
+  if (target < first.weight / 2) return min_ + (first.mean - min_) * target / (first.weight / 2);
+  double cumulative = 0;
+  for (size_t i = 0; i + 1 < centroids_.size(); ++i) {
+    const Centroid &left = centroids_[i];
+    const Centroid &right = centroids_[i + 1];
+    double left_center = cumulative + left.weight / 2;
+    double right_center = cumulative + left.weight + right.weight / 2;
+    if (target <= right_center) {
+      return left.mean + (right.mean - left.mean) * (target - left_center) / (right_center - left_center);
+    }
+    cumulative += left.weight;
+  }
+  const Centroid &last = centroids_.back();
+  double last_center = total_weight_ - last.weight / 2;
+  return last.mean + (max_ - last.mean) * (target - last_center) / (last.weight / 2);
+}
+
+void TDigest::serialize(std::string &out) {
+  compress();
+  write_value(out, compression_);
+  write_value(out, total_weight_);
+  write_value(out, min_);
+  write_value(out, max_);
+  write_value(out, (int64_t)centroids_.size());
+  for (auto &centroid : centroids_) {
+    write_value(out, centroid.mean);
+    write_value(out, centroid.weight);
+  }
+}
+
+TDigest TDigest::deserialize(const std::string &in, size_t &pos) {
+  TDigest digest(read_value<double>(in, pos));
+  digest.total_weight_ = read_value<double>(in, pos);
+  digest.min_ = read_value<double>(in, pos);
+  digest.max_ = read_value<double>(in, pos);
+  int64_t ncentroids = read_value<int64_t>(in, pos);
+  if (ncentroids < 0 || ncentroids > (int64_t)(in.size() / (2 * sizeof(double)))) {
+    throw std::invalid_argument("invalid sketch");
+  }
+  for (int64_t i = 0; i < ncentroids; ++i) {
+    double mean = read_value<double>(in, pos);
+    double weight = read_value<double>(in, pos);
+    digest.centroids_.push_back(Centroid{mean, weight});
+  }
+  return digest;
+}
+
+HyperLogLog::HyperLogLog(int precision) : precision_(precision) {
+  if (precision < 4 || precision > 18) throw std::invalid_argument("HyperLogLog precision has to be between 4 and 18");
+  registers_.assign(1 << precision, 0);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+  if (other.precision_ != precision_) throw std::invalid_argument("cannot merge HyperLogLogs with different precisions");
+  for (size_t i = 0; i < registers_.size(); ++i) registers_[i] = std::max(registers_[i], other.registers_[i]);
+}
+
+double HyperLogLog::estimate() const {
+  double m = registers_.size();
+  double sum = 0;
+  int64_t zeros = 0;
+  for (uint8_t r : registers_) {
+    sum += std::ldexp(1.0, -r);
+    zeros += r == 0;
+  }
+  double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709 : 0.7213 / (1 + 1.079 / m);
+  double estimate = alpha * m * m / sum;
+  // Linear counting is more accurate for small cardinalities, 64 bits hashes
+  // do not need a large range correction.
+  if (estimate <= 2.5 * m && zeros > 0) return m * std::log(m / zeros);
+  return estimate;
+}
+
+void HyperLogLog::serialize(std::string &out) const {
+  write_value(out, (int32_t)precision_);
+  out.append((const char*)registers_.data(), registers_.size());
+}
+
+HyperLogLog HyperLogLog::deserialize(const std::string &in, size_t &pos) {
+  HyperLogLog hll(read_value<int32_t>(in, pos));
+  if (pos + hll.registers_.size() > in.size()) throw std::invalid_argument("truncated sketch");
+  memcpy(hll.registers_.data(), in.data() + pos, hll.registers_.size());
+  pos += hll.registers_.size();
+  return hll;
+}
+
+void Sketch::merge(const Sketch &other) {
+  count += other.count;
+  null_count += other.null_count;
+  // fmin/fmax ignore nans, i.e. empty sketches.
+  min = std::fmin(min, other.min);
+  max = std::fmax(max, other.max);
+  digest.merge(other.digest);
+  hll.merge(other.hll);
+}
+
+void Sketch::serialize(std::string &out) {
+  out.append(sketch_magic, sizeof(sketch_magic));
+  write_value(out, count);
+  write_value(out, null_count);
+  write_value(out, min);
+  write_value(out, max);
+  digest.serialize(out);
+  hll.serialize(out);
+}
+
+Sketch Sketch::deserialize(const std::string &in) {
+  if (in.size() < sizeof(sketch_magic) || memcmp(in.data(), sketch_magic, sizeof(sketch_magic))) {
+    throw std::invalid_argument("not a serialized sketch");
+  }
+  size_t pos = sizeof(sketch_magic);
+  int64_t count = read_value<int64_t>(in, pos);
+  int64_t null_count = read_value<int64_t>(in, pos);
+  double min = read_value<double>(in, pos);
+  double max = read_value<double>(in, pos);
+  TDigest digest = TDigest::deserialize(in, pos);
+  HyperLogLog hll = HyperLogLog::deserialize(in, pos);
+  if (pos != in.size()) throw std::invalid_argument("trailing bytes after sketch");
+  Sketch sketch(digest.compression(), hll.precision());
+  sketch.count = count;
+  sketch.null_count = null_count;
+  sketch.min = min;
+  sketch.max = max;
+  sketch.digest = std::move(digest);
+  sketch.hll = std::move(hll);
+  return sketch;
+}
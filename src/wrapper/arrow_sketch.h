@@ -0,0 +1,90 @@
+#ifndef __OCAML_ARROW_SKETCH__
+#define __OCAML_ARROW_SKETCH__
+
+#include<cmath>
+#include<cstdint>
+#include<string>
+#include<vector>
+
+// Merging t-digest, an approximation of the distribution of a stream of
+// values that gives accurate quantiles near the tails. Values are buffered
+// and merged in sorted centroids whose sizes are bounded by the arcsine scale
+// function, [compression] bounds the number of centroids.
+class TDigest {
+ public:
+  explicit TDigest(double compression = 100);
+
+  void add(double value, double weight = 1);
+  void merge(const TDigest &other);
+  // Returns nan when no value has been added.
+  double quantile(double q);
+  double total_weight() const { return total_weight_; }
+  double compression() const { return compression_; }
+
+  void serialize(std::string &out);
+  // Reads a digest written by [serialize] at [pos], [pos] is moved past it.
+  static TDigest deserialize(const std::string &in, size_t &pos);
+
+ private:
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  void compress();
+
+  double compression_;
+  double total_weight_;
+  double min_;
+  double max_;
+  std::vector<Centroid> centroids_;
+  std::vector<Centroid> buffer_;
+};
+
+// HyperLogLog distinct count estimator over 64 bits hashes, using 2^precision
+// one byte registers. The standard error is about 1.04 / sqrt(2^precision).
+class HyperLogLog {
+ public:
+  explicit HyperLogLog(int precision = 14);
+
+  void add(uint64_t hash) {
+    size_t idx = hash >> (64 - precision_);
+    // The guard bit bounds the rank when the remaining bits are all zeros.
+    uint64_t rest = (hash << precision_) | (1ULL << (precision_ - 1));
+    uint8_t rank = __builtin_clzll(rest) + 1;
+    if (rank > registers_[idx]) registers_[idx] = rank;
+  }
+
+  void merge(const HyperLogLog &other);
+  double estimate() const;
+  int precision() const { return precision_; }
+
+  void serialize(std::string &out) const;
+  static HyperLogLog deserialize(const std::string &in, size_t &pos);
+
+ private:
+  int precision_;
+  std::vector<uint8_t> registers_;
+};
+
+// Mergeable summary of a column: exact counts, min and max, a t-digest for
+// quantiles and a HyperLogLog for distinct counts. Only numeric values feed
+// the t-digest and min/max, all the non-null values feed the HyperLogLog.
+struct Sketch {
+  Sketch(double compression, int hll_precision) : digest(compression), hll(hll_precision) {}
+
+  void merge(const Sketch &other);
+  void serialize(std::string &out);
+  static Sketch deserialize(const std::string &in);
+
+  int64_t count = 0;
+  int64_t null_count = 0;
+  double min = NAN;
+  double max = NAN;
+  TDigest digest;
+  HyperLogLog hll;
+  // Result of the last serialization, kept alive for the OCaml side.
+  std::string serialized;
+};
+
+#endif
@@ -88,3 +88,41 @@ let of_cstring = function
         | exception _ -> Unknown unknown)
       | _ -> Unknown unknown)
     | _ -> Unknown unknown)
+
+let precision_char = function
+  | `seconds -> "s"
+  | `milliseconds -> "m"
+  | `microseconds -> "u"
+  | `nanoseconds -> "n"
+
+let to_cstring = function
+  | Null -> "n"
+  | Boolean -> "b"
+  | Int8 -> "c"
+  | Uint8 -> "C"
+  | Int16 -> "s"
+  | Uint16 -> "S"
+  | Int32 -> "i"
+  | Uint32 -> "I"
+  | Int64 -> "l"
+  | Uint64 -> "L"
+  | Float16 -> "e"
+  | Float32 -> "f"
+  | Float64 -> "g"
+  | Binary -> "z"
+  | Large_binary -> "Z"
+  | Utf8_string -> "u"
+  | Large_utf8_string -> "U"
+  | Date32 `days -> "tdD"
+  | Date64 `milliseconds -> "tdm"
+  | Time32 precision -> "tt" ^ precision_char precision
+  | Time64 precision -> "tt" ^ precision_char precision
+  | Duration precision -> "tD" ^ precision_char precision
+  | Interval `months -> "tiM"
+  | Interval `days_time -> "tiD"
+  | Timestamp { precision; timezone } -> "ts" ^ precision_char precision ^ ":" ^ timezone
+  | Fixed_width_binary { bytes } -> Printf.sprintf "w:%d" bytes
+  | Decimal128 { precision; scale } -> Printf.sprintf "d:%d,%d" precision scale
+  | Struct -> "+s"
+  | Map -> "+m"
+  | Unknown unknown -> unknown
@@ -39,3 +39,4 @@ type t =
 [@@deriving sexp]
 
 val of_cstring : string -> t
+val to_cstring : t -> string
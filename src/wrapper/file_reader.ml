@@ -3,7 +3,7 @@ open! Base
 let unknown_suffix filename =
   Printf.failwithf
     "cannot infer the file format from suffix %s (supported suffixes are \
-     csv/json/feather/parquet)"
+     arrows/csv/json/feather/parquet)"
     filename
     ()
 
@@ -11,6 +11,7 @@ let schema filename =
   match String.rsplit2 filename ~on:'.' with
   | Some (_, "csv") -> Table.read_csv filename |> Table.schema
   | Some (_, "json") -> Table.read_json filename |> Table.schema
+  | Some (_, "arrows") -> Wrapper.Ipc_stream.read filename |> Table.schema
   | Some (_, "feather") -> Wrapper.Feather_reader.schema filename
   | Some (_, "parquet") -> Wrapper.Parquet_reader.schema filename
   | Some _ | None -> unknown_suffix filename
@@ -25,14 +26,15 @@ let indexes columns ~filename =
         let col_name = schema.Wrapper.Schema.name in
         if Set.mem col_names col_name then Some i else None)
 
-let table ?columns filename =
+let table ?columns ?io filename =
   match String.rsplit2 filename ~on:'.' with
-  | Some (_, "csv") -> Table.read_csv filename
-  | Some (_, "json") -> Table.read_json filename
+  | Some (_, "csv") -> Table.read_csv ?io filename
+  | Some (_, "json") -> Table.read_json ?io filename
+  | Some (_, "arrows") -> Wrapper.Ipc_stream.read ?io filename
   | Some (_, "feather") ->
     let column_idxs = Option.map columns ~f:(indexes ~filename) in
-    Wrapper.Feather_reader.table ?column_idxs filename
+    Wrapper.Feather_reader.table ?column_idxs ?io filename
   | Some (_, "parquet") ->
     let column_idxs = Option.map columns ~f:(indexes ~filename) in
-    Wrapper.Parquet_reader.table ?column_idxs filename
+    Wrapper.Parquet_reader.table ?column_idxs ?io filename
   | Some _ | None -> unknown_suffix filename
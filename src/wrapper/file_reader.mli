@@ -1,2 +1,6 @@
 val schema : string -> Wrapper.Schema.t
-val table : ?columns:[ `indexes of int list | `names of string list ] -> string -> Table.t
+val table
+  :  ?columns:[ `indexes of int list | `names of string list ]
+  -> ?io:Wrapper.Io.t
+  -> string
+  -> Table.t
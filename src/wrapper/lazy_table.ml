@@ -0,0 +1,8 @@
+open! Base
+include Wrapper.Lazy_table
+
+let read ?offset ?length t col_type ~column =
+  Table.read (columns ?offset ?length t [ column ]) col_type ~column:(`Index 0)
+
+let read_opt ?offset ?length t col_type ~column =
+  Table.read_opt (columns ?offset ?length t [ column ]) col_type ~column:(`Index 0)
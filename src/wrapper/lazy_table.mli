@@ -0,0 +1,18 @@
+include module type of Wrapper.Lazy_table with type t = Wrapper.Lazy_table.t
+
+(* Decodes [column] on first access, see [Wrapper.Lazy_table]. *)
+val read
+  :  ?offset:int
+  -> ?length:int
+  -> t
+  -> 'a Table.col_type
+  -> column:Wrapper.Column.column
+  -> 'a array
+
+val read_opt
+  :  ?offset:int
+  -> ?length:int
+  -> t
+  -> 'a Table.col_type
+  -> column:Wrapper.Column.column
+  -> 'a option array
@@ -7,8 +7,19 @@ let create = P.create
 let next = P.next
 let close = P.close
 
-let iter_batches ?use_threads ?column_idxs ?mmap ?buffer_size ?batch_size filename ~f =
-  let t = P.create ?use_threads ?column_idxs ?mmap ?buffer_size ?batch_size filename in
+let iter_batches
+    ?use_threads
+    ?column_idxs
+    ?mmap
+    ?io
+    ?buffer_size
+    ?batch_size
+    filename
+    ~f
+  =
+  let t =
+    P.create ?use_threads ?column_idxs ?mmap ?io ?buffer_size ?batch_size filename
+  in
   Exn.protect
     ~finally:(fun () -> close t)
     ~f:(fun () ->
@@ -25,13 +36,16 @@ let fold_batches
     ?use_threads
     ?column_idxs
     ?mmap
+    ?io
     ?buffer_size
     ?batch_size
     filename
     ~init
     ~f
   =
-  let t = P.create ?use_threads ?column_idxs ?mmap ?buffer_size ?batch_size filename in
+  let t =
+    P.create ?use_threads ?column_idxs ?mmap ?io ?buffer_size ?batch_size filename
+  in
   Exn.protect
     ~finally:(fun () -> close t)
     ~f:(fun () ->
@@ -42,6 +56,188 @@ let fold_batches
       in
       loop_read init)
 
+let parallel_map_batches
+    ?use_threads
+    ?column_idxs
+    ?mmap
+    ?io
+    ?buffer_size
+    ?batch_size
+    ?(ordered = true)
+    ?max_in_flight
+    filename
+    ~num_threads
+    ~f
+    ~init
+    ~reduce
+  =
+  if num_threads <= 0
+  then Printf.invalid_argf "num_threads has to be positive, got %d" num_threads ();
+  let max_in_flight = Option.value max_in_flight ~default:(2 * num_threads) in
+  if max_in_flight <= 0
+  then Printf.invalid_argf "max_in_flight has to be positive, got %d" max_in_flight ();
+  let t =
+    P.create ?use_threads ?column_idxs ?mmap ?io ?buffer_size ?batch_size filename
+  in
+  (* All the state below is protected by [mutex], [changed] is signaled on every
+     update. A batch is in flight from the time it has been read until its result
+     has been reduced, this bounds both the decoded batches and the results waiting
+     for an earlier batch. *)
+  let mutex = Mutex.create () in
+  let changed = Condition.create () in
+  let jobs = Queue.create () in
+  let results = Hashtbl.create (module Int) in
+  let in_flight = ref 0 in
+  let num_read = ref 0 in
+  let reader_done = ref false in
+  let stopped = ref false in
+  let error = ref None in
+  let with_lock f =
+    Mutex.lock mutex;
+    Exn.protect ~f ~finally:(fun () -> Mutex.unlock mutex)
+  in
+  let wait () = Condition.wait changed mutex in
+  let update f =
+    with_lock (fun () ->
+        f ();
+        Condition.broadcast changed)
+  in
+  let failed () = !stopped || Option.is_some !error in
+  let set_error exn = update (fun () -> if Option.is_none !error then error := Some exn) in
+  (* The decoding happens natively without holding the runtime lock, so the next
+     batches get decoded while the workers run [f]. *)
+  let read_batches () =
+    let rec loop () =
+      let continue =
+        with_lock (fun () ->
+            while !in_flight >= max_in_flight && not (failed ()) do
+              wait ()
+            done;
+            not (failed ()))
+      in
+      if continue
+      then (
+        match next t with
+        | None -> ()
+        | Some table ->
+          update (fun () ->
+              Queue.enqueue jobs (!num_read, table);
+              Int.incr num_read;
+              Int.incr in_flight);
+          loop ())
+    in
+    (try loop () with
+    | exn -> set_error exn);
+    update (fun () -> reader_done := true)
+  in
+  let work () =
+    let rec loop () =
+      let job =
+        with_lock (fun () ->
+            while Queue.is_empty jobs && (not !reader_done) && not (failed ()) do
+              wait ()
+            done;
+            if failed () then None else Queue.dequeue jobs)
+      in
+      match job with
+      | None -> ()
+      | Some (index, table) ->
+        (match f table with
+        | result -> update (fun () -> Hashtbl.set results ~key:index ~data:result)
+        | exception exn -> set_error exn);
+        loop ()
+    in
+    loop ()
+  in
+  let rec reduce_results acc num_reduced =
+    let next_result =
+      with_lock (fun () ->
+          let next_key () =
+            if ordered
+            then Option.some_if (Hashtbl.mem results num_reduced) num_reduced
+            else List.hd (Hashtbl.keys results)
+          in
+          while
+            Option.is_none (next_key ())
+            && (not (failed ()))
+            && not (!reader_done && num_reduced = !num_read)
+          do
+            wait ()
+          done;
+          match !error, next_key () with
+          | Some exn, _ -> raise exn
+          | None, None -> None
+          | None, Some key ->
+            let result = Hashtbl.find_and_remove results key in
+            Int.decr in_flight;
+            Condition.broadcast changed;
+            result)
+    in
+    match next_result with
+    | None -> acc
+    | Some result -> reduce_results (reduce acc result) (num_reduced + 1)
+  in
+  let reader = Worker.spawn read_batches in
+  let workers = List.init num_threads ~f:(fun _ -> Worker.spawn work) in
+  Exn.protect
+    ~f:(fun () -> reduce_results init 0)
+    ~finally:(fun () ->
+      update (fun () -> stopped := true);
+      List.iter (reader :: workers) ~f:Worker.join;
+      close t)
+
+let write_text
+    ?use_threads
+    ?column_idxs
+    ?mmap
+    ?io
+    ?buffer_size
+    ?batch_size
+    filename
+    ~writer
+  =
+  Wrapper.Text_writer.with_writer writer ~f:(fun writer ->
+      iter_batches
+        ?use_threads
+        ?column_idxs
+        ?mmap
+        ?io
+        ?buffer_size
+        ?batch_size
+        filename
+        ~f:(Wrapper.Text_writer.write writer))
+
+let resample
+    ?use_threads
+    ?column_idxs
+    ?mmap
+    ?io
+    ?buffer_size
+    ?batch_size
+    filename
+    ~resampler
+    ~f
+  =
+  let f bars = if Wrapper.Table.num_rows bars > 0 then f bars in
+  let pushed =
+    fold_batches
+      ?use_threads
+      ?column_idxs
+      ?mmap
+      ?io
+      ?buffer_size
+      ?batch_size
+      filename
+      ~init:false
+      ~f:(fun _ table ->
+        f (Wrapper.Resampler.push resampler table);
+        true)
+  in
+  if pushed then f (Wrapper.Resampler.finish resampler)
+
 let schema = P.schema
 let schema_and_num_rows = P.schema_and_num_rows
 let table = P.table
+let lookup = P.lookup
+let sample = P.sample
+let sample_n = P.sample_n
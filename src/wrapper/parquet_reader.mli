@@ -4,6 +4,7 @@ val create
   :  ?use_threads:bool
   -> ?column_idxs:int list
   -> ?mmap:bool
+  -> ?io:Wrapper.Io.t
   -> ?buffer_size:int
   -> ?batch_size:int
   -> string
@@ -16,6 +17,7 @@ val iter_batches
   :  ?use_threads:bool
   -> ?column_idxs:int list
   -> ?mmap:bool
+  -> ?io:Wrapper.Io.t
   -> ?buffer_size:int
   -> ?batch_size:int
   -> string
@@ -26,6 +28,7 @@ val fold_batches
   :  ?use_threads:bool
   -> ?column_idxs:int list
   -> ?mmap:bool
+  -> ?io:Wrapper.Io.t
   -> ?buffer_size:int
   -> ?batch_size:int
   -> string
@@ -33,12 +36,100 @@ val fold_batches
   -> f:('a -> Table.t -> 'a)
   -> 'a
 
+(* Applies [f] to the batches of the file on [num_threads] workers and folds the
+   results with [reduce] in the calling thread. The batches are decoded ahead
+   natively by a separate reader. With [ordered] (the default) the results
+   are reduced in the order of the batches, otherwise as soon as they are ready.
+   At most [max_in_flight] batches, defaulting to [2 * num_threads], are decoded
+   or waiting to be reduced at any time.
+   On OCaml 5 the workers are domains and [f] runs in parallel. Before that they
+   are systhreads holding the runtime lock while running OCaml code: only the
+   decoding and the parts of [f] running natively without the lock, e.g. the
+   table operations from [Wrapper], run in parallel. *)
+val parallel_map_batches
+  :  ?use_threads:bool
+  -> ?column_idxs:int list
+  -> ?mmap:bool
+  -> ?io:Wrapper.Io.t
+  -> ?buffer_size:int
+  -> ?batch_size:int
+  -> ?ordered:bool
+  -> ?max_in_flight:int
+  -> string
+  -> num_threads:int
+  -> f:(Table.t -> 'a)
+  -> init:'b
+  -> reduce:('b -> 'a -> 'b)
+  -> 'b
+
+(* Writes all the batches from the file using [writer], e.g. to convert a large
+   parquet file to csv without loading it in memory. [writer] gets closed. *)
+val write_text
+  :  ?use_threads:bool
+  -> ?column_idxs:int list
+  -> ?mmap:bool
+  -> ?io:Wrapper.Io.t
+  -> ?buffer_size:int
+  -> ?batch_size:int
+  -> string
+  -> writer:Wrapper.Text_writer.t
+  -> unit
+
+(* Feeds the batches from the file to [resampler] and calls [f] on the bars as
+   they get closed, the open bars are kept across batch boundaries. *)
+val resample
+  :  ?use_threads:bool
+  -> ?column_idxs:int list
+  -> ?mmap:bool
+  -> ?io:Wrapper.Io.t
+  -> ?buffer_size:int
+  -> ?batch_size:int
+  -> string
+  -> resampler:Wrapper.Resampler.t
+  -> f:(Table.t -> unit)
+  -> unit
+
 val schema : string -> Wrapper.Schema.t
 val schema_and_num_rows : string -> Wrapper.Schema.t * int
 
+(* See [Wrapper.Parquet_reader.table]. *)
 val table
   :  ?only_first:int
   -> ?use_threads:bool
+  -> ?parallelism:[ `Columns | `Row_groups | `Both ]
+  -> ?column_idxs:int list
+  -> ?io:Wrapper.Io.t
+  -> string
+  -> Table.t
+
+(* Returns the rows for which [column] is one of [values], see
+   [Wrapper.Parquet_reader.lookup]. *)
+val lookup
+  :  ?use_threads:bool
+  -> ?column_idxs:int list
+  -> ?io:Wrapper.Io.t
+  -> string
+  -> column:string
+  -> values:[ `ints of int list | `strings of string list ]
+  -> Table.t
+
+(* Random samples of the rows, see [Wrapper.Parquet_reader.sample]. *)
+val sample
+  :  ?use_threads:bool
+  -> ?column_idxs:int list
+  -> ?stratify_by:string
+  -> ?io:Wrapper.Io.t
+  -> ?seed:int
+  -> string
+  -> fraction:float
+  -> Table.t
+
+val sample_n
+  :  ?use_threads:bool
   -> ?column_idxs:int list
+  -> ?stratify_by:string
+  -> ?io:Wrapper.Io.t
+  -> ?seed:int
   -> string
+  -> n:int
   -> Table.t
@@ -1,4 +1,5 @@
 open! Base
+module C = C_api.C
 
 type ba = (int, Bigarray.int8_unsigned_elt, Bigarray.c_layout) Bigarray.Array1.t
 
@@ -25,22 +26,114 @@ let set t i b =
   else t.data.{index} <- t.data.{index} land unmask i
 
 let length t = t.length
+let ba_ptr ba = Ctypes.bigarray_start Array1 ba |> Ctypes.to_voidp
+let ptr t = ba_ptr t.data
 
-let num_true t =
-  let res = ref 0 in
-  let length = t.length in
-  for byte_index = 0 to (length / 8) - 1 do
-    res := !res + Int.popcount t.data.{byte_index}
-  done;
-  let last_byte_index = length / 8 in
-  let last_bits = length % 8 in
-  if last_bits > 0
-  then res := !res + Int.popcount (t.data.{last_byte_index} land ((1 lsl last_bits) - 1));
-  !res
+let create_uninitialized length =
+  { length; data = Bigarray.Array1.create Int8_unsigned C_layout ((length + 7) / 8) }
+
+let count_range t ~pos ~len =
+  if pos < 0 || len < 0 || pos + len > t.length
+  then Printf.invalid_argf "Valid.count_range: pos %d len %d length %d" pos len t.length ();
+  C.Bitmap.count_set_bits (ptr t) (Int64.of_int pos) (Int64.of_int len) |> Int64.to_int_exn
 
+let num_true t = count_range t ~pos:0 ~len:t.length
 let num_false t = length t - num_true t
 let bigarray t = t.data
 
+let find_next_set t pos =
+  if pos < 0 then Printf.invalid_argf "Valid.find_next_set: negative pos %d" pos ();
+  if pos >= t.length
+  then None
+  else (
+    let idx = C.Bitmap.find_next_set (ptr t) (Int64.of_int pos) (Int64.of_int t.length) in
+    if Int64.( < ) idx 0L then None else Some (Int64.to_int_exn idx))
+
+(* The order has to match [bitmap_op] on the C++ side. *)
+let binary_op ~op ~name t1 t2 =
+  if t1.length <> t2.length
+  then Printf.invalid_argf "Valid.%s: length mismatch %d <> %d" name t1.length t2.length ();
+  let res = create_uninitialized t1.length in
+  C.Bitmap.binary_op (ptr t1) (ptr t2) (Int64.of_int t1.length) op (ptr res);
+  res
+
+let and_ = binary_op ~op:0 ~name:"and_"
+let or_ = binary_op ~op:1 ~name:"or_"
+let xor = binary_op ~op:2 ~name:"xor"
+let and_not = binary_op ~op:3 ~name:"and_not"
+
+let of_bool_array bools =
+  let length = Array.length bools in
+  let t = create_uninitialized length in
+  for byte_index = 0 to Bigarray.Array1.dim t.data - 1 do
+    let byte = ref 0 in
+    let offset = 8 * byte_index in
+    for bit = 0 to min 8 (length - offset) - 1 do
+      if bools.(offset + bit) then byte := !byte lor (1 lsl bit)
+    done;
+    t.data.{byte_index} <- !byte
+  done;
+  t
+
+let to_bool_array t = Array.init t.length ~f:(get t)
+
+let iter_set_bits t ~f =
+  let length = t.length in
+  for byte_index = 0 to ((length + 7) / 8) - 1 do
+    let byte = ref t.data.{byte_index} in
+    while !byte <> 0 do
+      let i = (8 * byte_index) + Int.ctz !byte in
+      if i < length then f i;
+      byte := !byte land (!byte - 1)
+    done
+  done
+
+let compress t values =
+  let kind = Bigarray.Array1.kind values in
+  if Bigarray.Array1.dim values <> t.length
+  then
+    Printf.invalid_argf
+      "Valid.compress: %d values for a bitmap of length %d"
+      (Bigarray.Array1.dim values)
+      t.length
+      ();
+  let res = Bigarray.Array1.create kind C_layout (num_true t) in
+  let (_ : Int64.t) =
+    C.Bitmap.compress
+      (ptr t)
+      (Int64.of_int t.length)
+      (ba_ptr values)
+      (Bigarray.kind_size_in_bytes kind)
+      (ba_ptr res)
+  in
+  res
+
+let expand t values ~fill =
+  let kind = Bigarray.Array1.kind values in
+  let num_true = num_true t in
+  if Bigarray.Array1.dim values <> num_true
+  then
+    Printf.invalid_argf
+      "Valid.expand: %d values for a bitmap with %d set bits"
+      (Bigarray.Array1.dim values)
+      num_true
+      ();
+  let res = Bigarray.Array1.create kind C_layout t.length in
+  Bigarray.Array1.fill res fill;
+  C.Bitmap.expand
+    (ptr t)
+    (Int64.of_int t.length)
+    (ba_ptr values)
+    (Bigarray.kind_size_in_bytes kind)
+    (ba_ptr res);
+  res
+
+(* Defined last as it shadows [Base.not]. *)
+let not t =
+  let res = create_uninitialized t.length in
+  C.Bitmap.invert (ptr t) (Int64.of_int t.length) (ptr res);
+  res
+
 let%expect_test _ =
   let of_bool_list bool_list =
     let t = create_all_valid (List.length bool_list) in
@@ -80,3 +173,70 @@ let%expect_test _ =
       if String.( <> ) s round_trip_s then Stdio.printf "<%s> <%s>\n%!" s round_trip_s)
     (strs @ [ "11111111111101111111"; "11101010101011111" ]);
   [%expect {| |}]
+
+let%expect_test _ =
+  let bools ~seed length = Array.init length ~f:(fun i -> ((i * 7) + seed) % 5 < 2) in
+  List.iter [ 0; 1; 7; 8; 9; 63; 64; 65; 130; 1000 ] ~f:(fun length ->
+      let b1 = bools ~seed:0 length in
+      let b2 = bools ~seed:3 length in
+      let t1 = of_bool_array b1 in
+      let t2 = of_bool_array b2 in
+      let check name t f =
+        let expected = Array.init length ~f:(fun i -> f b1.(i) b2.(i)) in
+        if Poly.( <> ) (to_bool_array t) expected
+        then Stdio.printf "%s mismatch for length %d\n" name length
+      in
+      check "and_" (and_ t1 t2) ( && );
+      check "or_" (or_ t1 t2) ( || );
+      check "xor" (xor t1 t2) Bool.( <> );
+      check "and_not" (and_not t1 t2) (fun x y -> x && Base.not y);
+      check "not" (not t1) (fun x _ -> Base.not x);
+      let set_bits = ref [] in
+      iter_set_bits t1 ~f:(fun i -> set_bits := i :: !set_bits);
+      let expected_bits = List.filter (List.init length ~f:Fn.id) ~f:(fun i -> b1.(i)) in
+      if Poly.( <> ) (List.rev !set_bits) expected_bits
+      then Stdio.printf "iter_set_bits mismatch for length %d\n" length;
+      for pos = 0 to length - 1 do
+        let expected = List.find expected_bits ~f:(fun i -> i >= pos) in
+        if Poly.( <> ) (find_next_set t1 pos) expected
+        then Stdio.printf "find_next_set mismatch for length %d pos %d\n" length pos;
+        let len = (length - pos) / 2 in
+        let expected = List.count expected_bits ~f:(fun i -> i >= pos && i < pos + len) in
+        if count_range t1 ~pos ~len <> expected
+        then Stdio.printf "count_range mismatch for length %d pos %d\n" length pos
+      done);
+  [%expect {| |}];
+  let t = of_bool_array [| false; false; true; false; false; false; false; false; false; true |] in
+  Stdio.printf
+    "%d %s %s\n"
+    (num_true t)
+    (find_next_set t 3 |> Option.value_map ~default:"none" ~f:Int.to_string)
+    (find_next_set t 10 |> Option.value_map ~default:"none" ~f:Int.to_string);
+  [%expect {| 2 9 none |}]
+
+let%expect_test _ =
+  let t = of_bool_array (Array.init 150 ~f:(fun i -> i < 70 || i % 9 = 0)) in
+  let values = Bigarray.Array1.of_array Float64 C_layout (Array.init 150 ~f:Float.of_int) in
+  let compressed = compress t values in
+  let expanded = expand t compressed ~fill:Float.nan in
+  let mismatches = ref 0 in
+  for i = 0 to 149 do
+    let expected = if get t i then values.{i} else Float.nan in
+    let got = expanded.{i} in
+    if Base.not (Float.equal got expected || (Float.is_nan got && Float.is_nan expected))
+    then Int.incr mismatches
+  done;
+  Stdio.printf
+    "%d %d %.0f %.0f\n"
+    (Bigarray.Array1.dim compressed)
+    !mismatches
+    compressed.{69}
+    compressed.{70};
+  [%expect {| 79 0 69 72 |}];
+  let t = of_bool_array [| true; false; false; true; true |] in
+  let values = Bigarray.Array1.of_array Int64 C_layout [| 1L; 2L; 3L; 4L; 5L |] in
+  let compressed = compress t values in
+  let expanded = expand t compressed ~fill:0L in
+  let to_list ba = List.init (Bigarray.Array1.dim ba) ~f:(fun i -> ba.{i}) in
+  Stdio.print_s [%sexp (to_list compressed : Int64.t list), (to_list expanded : Int64.t list)];
+  [%expect {| ((1 4 5) (1 0 0 4 5)) |}]
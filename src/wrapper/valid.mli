@@ -9,3 +9,36 @@ val set : t -> int -> bool -> unit
 val bigarray : t -> ba
 val num_true : t -> int
 val num_false : t -> int
+
+(** [count_range t ~pos ~len] is the number of set bits in [pos, pos + len). *)
+val count_range : t -> pos:int -> len:int -> int
+
+(** [find_next_set t pos] returns the index of the first set bit at or after [pos]. *)
+val find_next_set : t -> int -> int option
+
+(** Bitwise operations on whole bitmaps, these run on 64 bits words in the C++ side
+    and raise if the lengths differ. The result is a fresh bitmap. *)
+val and_ : t -> t -> t
+
+val or_ : t -> t -> t
+val xor : t -> t -> t
+val and_not : t -> t -> t
+val not : t -> t
+val of_bool_array : bool array -> t
+val to_bool_array : t -> bool array
+val iter_set_bits : t -> f:(int -> unit) -> unit
+
+(** [compress t values] returns the values at the positions set in [t], [values]
+    must have the same length as [t]. *)
+val compress
+  :  t
+  -> ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t
+  -> ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t
+
+(** [expand t values ~fill] is the inverse of [compress], [values] are scattered to
+    the positions set in [t] and the other positions are set to [fill]. *)
+val expand
+  :  t
+  -> ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t
+  -> fill:'a
+  -> ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t
@@ -0,0 +1,6 @@
+(* The workers of [Parquet_reader.parallel_map_batches]: domains on OCaml 5 and
+   systhreads on older versions, see the dune file. *)
+type t
+
+val spawn : (unit -> unit) -> t
+val join : t -> unit
@@ -31,6 +31,22 @@ let get_string ptr_char =
   in
   loop [] ptr_char
 
+module Memory = struct
+  let set_huge_page_threshold bytes =
+    C.Memory.set_huge_page_threshold (Int64.of_int bytes)
+
+  let disable_huge_pages () = set_huge_page_threshold 0
+  let bytes_allocated () = C.Memory.bytes_allocated () |> Int64.to_int_exn
+  let max_memory () = C.Memory.max_memory () |> Int64.to_int_exn
+  let huge_page_allocations () = C.Memory.huge_page_allocations () |> Int64.to_int_exn
+
+  external bigarray_create
+    :  ('a, 'b) Bigarray.kind
+    -> int
+    -> ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t
+    = "arrow_bigarray_create"
+end
+
 module Schema = struct
   module Flags : sig
     type t [@@deriving sexp_of]
@@ -132,11 +148,170 @@ module ChunkedArray = struct
     t
 end
 
+module Text_writer = struct
+  type t = C.Text_writer.t
+
+  let create ~format ~header ~delimiter ~quoting ~null filename =
+    let quoting =
+      match quoting with
+      | `needed -> 0
+      | `all_strings -> 1
+      | `none -> 2
+    in
+    let t =
+      C.Text_writer.open_
+        filename
+        format
+        (if header then 1 else 0)
+        delimiter
+        quoting
+        null
+    in
+    Caml.Gc.finalise C.Text_writer.free t;
+    t
+
+  let create_csv
+      ?(header = true)
+      ?(delimiter = ',')
+      ?(quoting = `needed)
+      ?(null = "")
+      filename
+    =
+    create ~format:0 ~header ~delimiter ~quoting ~null filename
+
+  let create_ndjson filename =
+    create ~format:1 ~header:false ~delimiter:',' ~quoting:`needed ~null:"" filename
+
+  let write = C.Text_writer.write
+  let close = C.Text_writer.close
+
+  let with_writer t ~f =
+    Exn.protect ~f:(fun () -> f t) ~finally:(fun () -> close t)
+end
+
+module Io = struct
+  type t =
+    [ `Pread
+    | `Mmap
+    | `Uring
+    | `Direct
+    ]
+
+  let to_cint = function
+    | `Pread -> 0
+    | `Mmap -> 1
+    | `Uring -> 2
+    | `Direct -> 3
+
+  let uring_available () = C.io_uring_available () <> 0
+end
+
+let column_name_and_idx = function
+  | `Name name -> name, -1
+  | `Index index -> "", index
+
+module Resample_agg = struct
+  type column =
+    [ `Index of int
+    | `Name of string
+    ]
+
+  type t =
+    [ `First of column
+    | `Last of column
+    | `Min of column
+    | `Max of column
+    | `Sum of column
+    | `Mean of column
+    | `Count of column
+    | `Vwap of column * column
+    ]
+
+  (* Returns the aggregation kind with the value and volume columns. *)
+  let to_cint : t -> int * column * column = function
+    | `First c -> 0, c, `Index (-1)
+    | `Last c -> 1, c, `Index (-1)
+    | `Min c -> 2, c, `Index (-1)
+    | `Max c -> 3, c, `Index (-1)
+    | `Sum c -> 4, c, `Index (-1)
+    | `Mean c -> 5, c, `Index (-1)
+    | `Count c -> 6, c, `Index (-1)
+    | `Vwap (price, volume) -> 7, price, volume
+
+  (* Utc offsets of [zone] in nanoseconds with the time from which each of them
+     applies, covering 1970 to 2100. *)
+  let zone_offsets zone =
+    let module Time = Core_kernel.Time in
+    let to_ns span = Time.Span.to_ns span |> Float.iround_nearest_exn in
+    let offset time = Time.Zone.utc_offset zone ~time |> to_ns in
+    let until = Time.of_span_since_epoch (Time.Span.of_day (130. *. 365.25)) in
+    let rec loop time acc =
+      match Time.Zone.next_clock_shift zone ~strictly_after:time with
+      | Some (shift, _) when Time.( < ) shift until ->
+        loop shift ((Time.to_span_since_epoch shift |> to_ns, offset shift) :: acc)
+      | _ -> List.rev acc
+    in
+    loop Time.epoch [ Int.min_value, offset Time.epoch ]
+
+  (* Calls [f] with the arguments describing a resampling on the C side. *)
+  let with_args ?(by = []) ?zone ~time ~every ~aggs ~f () =
+    let every = Core_kernel.Time_ns.Span.to_int_ns every in
+    if every <= 0 then Printf.invalid_argf "resample: every must be positive (%d ns)" every ();
+    let time_name, time_idx = column_name_and_idx time in
+    let zone_starts, zone_offsets =
+      Option.value_map zone ~default:[] ~f:zone_offsets |> List.unzip
+    in
+    let int64s l = List.map l ~f:Int64.of_int |> Ctypes.CArray.of_list Ctypes.int64_t in
+    let ints l = Ctypes.CArray.of_list Ctypes.int l in
+    let zone_starts = int64s zone_starts in
+    let zone_offsets = int64s zone_offsets in
+    let by_names, by_idxs = List.map by ~f:column_name_and_idx |> List.unzip in
+    let by_idxs = ints by_idxs in
+    let aggs =
+      List.map aggs ~f:(fun (out_name, agg) ->
+          let kind, value, volume = to_cint agg in
+          let value_name, value_idx = column_name_and_idx value in
+          let volume_name, volume_idx = column_name_and_idx volume in
+          out_name, kind, value_name, value_idx, volume_name, volume_idx)
+    in
+    let kinds = List.map aggs ~f:(fun (_, kind, _, _, _, _) -> kind) |> ints in
+    let value_idxs = List.map aggs ~f:(fun (_, _, _, idx, _, _) -> idx) |> ints in
+    let volume_idxs = List.map aggs ~f:(fun (_, _, _, _, _, idx) -> idx) |> ints in
+    let result =
+      f
+        time_name
+        time_idx
+        (Int64.of_int every)
+        (Ctypes.CArray.start zone_starts)
+        (Ctypes.CArray.start zone_offsets)
+        (Ctypes.CArray.length zone_starts)
+        (ptr_of_strings by_names)
+        (Ctypes.CArray.start by_idxs)
+        (List.length by)
+        (Ctypes.CArray.start kinds)
+        (List.map aggs ~f:(fun (_, _, name, _, _, _) -> name) |> ptr_of_strings)
+        (Ctypes.CArray.start value_idxs)
+        (List.map aggs ~f:(fun (_, _, _, _, name, _) -> name) |> ptr_of_strings)
+        (Ctypes.CArray.start volume_idxs)
+        (List.map aggs ~f:(fun (out_name, _, _, _, _, _) -> out_name) |> ptr_of_strings)
+        (List.length aggs)
+    in
+    use_value (zone_starts, zone_offsets, by_idxs, kinds, value_idxs, volume_idxs);
+    result
+end
+
 module Table = struct
   type t = C.Table.t
 
   let schema t = C.Table.schema t |> Schema.of_c
-  let num_rows t = C.Table.num_rows t |> Int64.to_int_exn
+  let schema_fingerprint t = C.Table.schema_fingerprint t |> Int64.to_int_exn
+  external num_rows
+    :  _ Cstubs_internals.fatptr
+    -> (int[@untagged])
+    = "fast_table_num_rows_byte" "fast_table_num_rows"
+    [@@noalloc]
+
+  let num_rows (Cstubs_internals.CPointer t : t) = num_rows t
   let to_string_debug = C.Table.to_string
 
   let with_free t =
@@ -155,16 +330,40 @@ module Table = struct
   let slice t ~offset ~length =
     C.Table.slice t (Int64.of_int offset) (Int64.of_int length) |> with_free
 
-  let read_csv filename = C.csv_read_table filename |> with_free
-  let read_json filename = C.json_read_table filename |> with_free
+  let read_csv ?(schema = []) ?(io = `Pread) filename =
+    C.csv_read_table
+      filename
+      (Io.to_cint io)
+      (ptr_of_strings (List.map schema ~f:fst))
+      (ptr_of_strings (List.map schema ~f:(fun (_, dt) -> Datatype.to_cstring dt)))
+      (List.length schema)
+    |> with_free
+
+  let read_json ?(io = `Pread) filename =
+    C.json_read_table filename (Io.to_cint io) |> with_free
 
   let write_parquet
       ?(chunk_size = 1024 * 1024)
       ?(compression = Compression.Snappy)
+      ?(bloom_filter_columns = [])
       t
       filename
     =
-    C.Table.parquet_write filename t chunk_size (Compression.to_cint compression)
+    C.Table.parquet_write
+      filename
+      t
+      chunk_size
+      (Compression.to_cint compression)
+      (ptr_of_strings bloom_filter_columns)
+      (List.length bloom_filter_columns)
+
+  let write_csv ?header ?delimiter ?quoting ?null t filename =
+    Text_writer.create_csv ?header ?delimiter ?quoting ?null filename
+    |> Text_writer.with_writer ~f:(fun writer -> Text_writer.write writer t)
+
+  let write_ndjson t filename =
+    Text_writer.create_ndjson filename
+    |> Text_writer.with_writer ~f:(fun writer -> Text_writer.write writer t)
 
   let write_feather
       ?(chunk_size = 1024 * 1024)
@@ -177,25 +376,142 @@ module Table = struct
   let get_column t col_name = C.Table.get_column t col_name |> ChunkedArray.with_free
   let add_column t col_name array = C.Table.add_column t col_name array |> with_free
   let add_all_columns t t' = C.Table.add_all_columns t t' |> with_free
+
+  let filter t valid =
+    let mask = Valid.bigarray valid in
+    let filtered =
+      C.Table.filter
+        t
+        (Ctypes.bigarray_start Array1 mask |> Ctypes.to_voidp)
+        (Valid.length valid |> Int64.of_int)
+      |> with_free
+    in
+    use_value mask;
+    filtered
+
+  let with_columns columns ~f =
+    let names, idxs = List.map columns ~f:column_name_and_idx |> List.unzip in
+    let idxs = Ctypes.CArray.of_list Ctypes.int idxs in
+    let result = f (ptr_of_strings names) (Ctypes.CArray.start idxs) (List.length columns) in
+    use_value idxs;
+    result
+
+  let hash_rows t columns =
+    let dst = Memory.bigarray_create Int64 (num_rows t) in
+    with_columns columns ~f:(fun names idxs ncols ->
+        C.Table.hash_rows t names idxs ncols (Ctypes.bigarray_start Array1 dst));
+    dst
+
+  let partition_by_hash t columns ~n =
+    if n <= 0 then Printf.invalid_argf "partition_by_hash: n must be positive (%d)" n ();
+    let tables = Ctypes.CArray.make C.Table.t n in
+    with_columns columns ~f:(fun names idxs ncols ->
+        C.Table.partition_by_hash t names idxs ncols n (Ctypes.CArray.start tables));
+    Array.init n ~f:(fun i -> Ctypes.CArray.get tables i |> with_free)
+
+  let distinct ?(keys = []) ~keep t =
+    let keep_last =
+      match keep with
+      | `First -> 0
+      | `Last -> 1
+    in
+    with_columns keys ~f:(fun names idxs ncols ->
+        C.Table.distinct t names idxs ncols keep_last)
+    |> with_free
+
+  let top_k_by_group ?(smallest = false) t ~by ~group_by ~k =
+    if k <= 0 then Printf.invalid_argf "top_k: k must be positive (%d)" k ();
+    let name, idx = column_name_and_idx by in
+    with_columns group_by ~f:(fun names idxs ncols ->
+        C.Table.top_k
+          t
+          name
+          idx
+          (Int64.of_int k)
+          (if smallest then 1 else 0)
+          names
+          idxs
+          ncols)
+    |> with_free
+
+  let top_k ?smallest t ~by ~k = top_k_by_group ?smallest t ~by ~group_by:[] ~k
+
+  let resample ?by ?zone t ~time ~every ~aggs =
+    Resample_agg.with_args ?by ?zone ~time ~every ~aggs ~f:(C.Resampler.resample t) ()
+    |> with_free
+
+  let rolling ?(by = []) t ~time ~window ~aggs =
+    let window_ns = Core_kernel.Time_ns.Span.to_int_ns window in
+    if window_ns <= 0
+    then
+      Printf.invalid_argf
+        "rolling: window must be positive (%s)"
+        (Core_kernel.Time_ns.Span.to_string window)
+        ();
+    let time_name, time_idx = column_name_and_idx time in
+    let unit_ns = C.Table.timestamp_unit_in_ns t time_name time_idx in
+    let aggs =
+      List.map aggs ~f:(fun (out_name, agg) ->
+          let agg, column =
+            match agg with
+            | `Sum column -> 0, column
+            | `Mean column -> 1, column
+            | `Min column -> 2, column
+            | `Max column -> 3, column
+            | `Count column -> 4, column
+          in
+          let name, idx = column_name_and_idx column in
+          out_name, agg, name, idx)
+    in
+    let ints l = Ctypes.CArray.of_list Ctypes.int l in
+    let value_idxs = List.map aggs ~f:(fun (_, _, _, idx) -> idx) |> ints in
+    let agg_kinds = List.map aggs ~f:(fun (_, agg, _, _) -> agg) |> ints in
+    let rolled =
+      with_columns by ~f:(fun by_names by_idxs nby ->
+          C.Table.rolling
+            t
+            time_name
+            time_idx
+            ((window_ns - 1) / unit_ns |> Int64.of_int)
+            by_names
+            by_idxs
+            nby
+            (List.map aggs ~f:(fun (_, _, name, _) -> name) |> ptr_of_strings)
+            (Ctypes.CArray.start value_idxs)
+            (Ctypes.CArray.start agg_kinds)
+            (List.map aggs ~f:(fun (out_name, _, _, _) -> out_name) |> ptr_of_strings)
+            (List.length aggs))
+      |> with_free
+    in
+    use_value (value_idxs, agg_kinds);
+    rolled
 end
 
 module Parquet_reader = struct
   type t = C.Parquet_reader.t
 
+  let use_threads_to_cint = function
+    | None -> -1
+    | Some false -> 0
+    | Some true -> 1
+
   let create
       ?use_threads
       ?(column_idxs = [])
       ?(mmap = false)
+      ?io
       ?(buffer_size = 0)
       ?(batch_size = 0)
       filename
     =
-    let use_threads =
-      match use_threads with
-      | None -> -1
-      | Some false -> 0
-      | Some true -> 1
-    in
+    let io =
+      match mmap, io with
+      | false, io -> Option.value io ~default:`Pread
+      | true, (None | Some `Pread | Some `Mmap) -> `Mmap
+      | true, Some (`Uring | `Direct) ->
+        invalid_arg "Parquet_reader.create: ~mmap:true conflicts with ~io"
+    in
+    let use_threads = use_threads_to_cint use_threads in
     let column_idxs = Ctypes.CArray.of_list Ctypes.int column_idxs in
     let t =
       C.Parquet_reader.open_
@@ -203,7 +519,7 @@ module Parquet_reader = struct
         (Ctypes.CArray.start column_idxs)
         (Ctypes.CArray.length column_idxs)
         use_threads
-        (if mmap then 1 else 0)
+        (Io.to_cint io)
         buffer_size
         batch_size
     in
@@ -226,13 +542,21 @@ module Parquet_reader = struct
 
   let schema filename = schema_and_num_rows filename |> fst
 
-  let table ?(only_first = -1) ?use_threads ?(column_idxs = []) filename =
-    let use_threads =
-      match use_threads with
-      | None -> -1
-      | Some false -> 0
-      | Some true -> 1
-    in
+  (* The order here has to match the C side. *)
+  let parallelism_to_cint = function
+    | `Columns -> 0
+    | `Row_groups -> 1
+    | `Both -> 2
+
+  let table
+      ?(only_first = -1)
+      ?use_threads
+      ?(parallelism = `Columns)
+      ?(column_idxs = [])
+      ?(io = `Pread)
+      filename
+    =
+    let use_threads = use_threads_to_cint use_threads in
     let column_idxs = Ctypes.CArray.of_list Ctypes.int column_idxs in
     C.Parquet_reader.read_table
       filename
@@ -240,23 +564,236 @@ module Parquet_reader = struct
       (Ctypes.CArray.length column_idxs)
       use_threads
       (Int64.of_int only_first)
+      (Io.to_cint io)
+      (parallelism_to_cint parallelism)
     |> Table.with_free
+
+  let lookup ?use_threads ?(column_idxs = []) ?(io = `Pread) filename ~column ~values =
+    let use_threads = use_threads_to_cint use_threads in
+    let column_idxs = Ctypes.CArray.of_list Ctypes.int column_idxs in
+    let table =
+      match values with
+      | `ints values ->
+        let values = List.map values ~f:Int64.of_int |> Ctypes.CArray.of_list Ctypes.int64_t in
+        let table =
+          C.Parquet_reader.lookup_int64
+            filename
+            column
+            (Ctypes.CArray.start values)
+            (Ctypes.CArray.length values)
+            (Ctypes.CArray.start column_idxs)
+            (Ctypes.CArray.length column_idxs)
+            use_threads
+            (Io.to_cint io)
+        in
+        use_value values;
+        table
+      | `strings values ->
+        C.Parquet_reader.lookup_utf8
+          filename
+          column
+          (ptr_of_strings values)
+          (List.length values)
+          (Ctypes.CArray.start column_idxs)
+          (Ctypes.CArray.length column_idxs)
+          use_threads
+          (Io.to_cint io)
+    in
+    Table.with_free table
+
+  let sample_
+      ?use_threads
+      ?(column_idxs = [])
+      ?(stratify_by = "")
+      ?(io = `Pread)
+      ~seed
+      ~n
+      ~fraction
+      filename
+    =
+    let use_threads = use_threads_to_cint use_threads in
+    let column_idxs = Ctypes.CArray.of_list Ctypes.int column_idxs in
+    C.Parquet_reader.sample
+      filename
+      (Ctypes.CArray.start column_idxs)
+      (Ctypes.CArray.length column_idxs)
+      (Int64.of_int n)
+      fraction
+      stratify_by
+      (Int64.of_int seed)
+      use_threads
+      (Io.to_cint io)
+    |> Table.with_free
+
+  let sample ?use_threads ?column_idxs ?stratify_by ?io ?(seed = 0) filename ~fraction =
+    sample_ ?use_threads ?column_idxs ?stratify_by ?io ~seed ~n:(-1) ~fraction filename
+
+  let sample_n ?use_threads ?column_idxs ?stratify_by ?io ?(seed = 0) filename ~n =
+    if n < 0 then Printf.invalid_argf "sample_n: negative number of rows %d" n ();
+    sample_ ?use_threads ?column_idxs ?stratify_by ?io ~seed ~n ~fraction:0. filename
+end
+
+module Ipc_stream = struct
+  type t = C.Ipc_stream.t
+
+  let fsync_to_cint = function
+    | `never -> 0
+    | `on_flush -> 1
+    | `every_append -> 2
+
+  let create ?(fsync = `never) filename =
+    let t = C.Ipc_stream.open_ filename (fsync_to_cint fsync) in
+    Caml.Gc.finalise C.Ipc_stream.free t;
+    t
+
+  let append = C.Ipc_stream.append
+  let flush = C.Ipc_stream.flush
+  let close = C.Ipc_stream.close
+
+  let read ?(io = `Pread) filename =
+    C.Ipc_stream.read_table filename (Io.to_cint io) |> Table.with_free
+end
+
+module Resampler = struct
+  type t = C.Resampler.t
+
+  let create ?by ?zone ~time ~every ~aggs () =
+    let t = Resample_agg.with_args ?by ?zone ~time ~every ~aggs ~f:C.Resampler.create () in
+    Caml.Gc.finalise C.Resampler.free t;
+    t
+
+  let push t table = C.Resampler.push t table |> Table.with_free
+  let finish t = C.Resampler.finish t |> Table.with_free
+end
+
+module Sketch = struct
+  type t = C.Sketch.t
+
+  let with_free t =
+    Caml.Gc.finalise C.Sketch.free t;
+    t
+
+  let create ?(compression = 200.) ?(hll_precision = 14) () =
+    C.Sketch.create compression hll_precision |> with_free
+
+  let update_from_table t table column =
+    let column_name, column_idx = column_name_and_idx column in
+    C.Sketch.update t table column_name column_idx
+
+  let merge = C.Sketch.merge
+
+  let serialize t =
+    let length = Ctypes.allocate Ctypes.int64_t 0L in
+    let data = C.Sketch.serialize t length in
+    let serialized =
+      Ctypes.string_from_ptr data ~length:(Int64.to_int_exn Ctypes.(!@length))
+    in
+    use_value t;
+    serialized
+
+  let deserialize str =
+    C.Sketch.deserialize (ptr_of_string str) (String.length str |> Int64.of_int)
+    |> with_free
+
+  let nan_to_option f = if Float.is_nan f then None else Some f
+  let count t = C.Sketch.count t |> Int64.to_int_exn
+  let null_count t = C.Sketch.null_count t |> Int64.to_int_exn
+  let min t = C.Sketch.min t |> nan_to_option
+  let max t = C.Sketch.max t |> nan_to_option
+  let quantile t q = C.Sketch.quantile t q |> nan_to_option
+  let distinct_count = C.Sketch.distinct_count
+end
+
+module Convert = struct
+  type stats =
+    { rows : int
+    ; row_groups : int
+    ; bytes_read : int
+    ; bytes_written : int
+    ; elapsed : Core_kernel.Time_ns.Span.t
+    }
+  [@@deriving sexp_of]
+
+  let bytes_per_second stats =
+    Float.of_int stats.bytes_read /. Core_kernel.Time_ns.Span.to_sec stats.elapsed
+
+  let to_parquet
+      ?schema
+      ?(row_group_rows = 1024 * 1024)
+      ?(compression = Compression.Snappy)
+      ?(max_in_flight = 8)
+      ~format
+      ~src
+      ~dst
+      ()
+    =
+    let schema = Option.value schema ~default:[] in
+    let col_names = List.map schema ~f:fst in
+    let col_formats = List.map schema ~f:(fun (_, dt) -> Datatype.to_cstring dt) in
+    let stats = Ctypes.CArray.make Ctypes.int64_t 5 in
+    C.convert_to_parquet
+      src
+      dst
+      format
+      (ptr_of_strings col_names)
+      (ptr_of_strings col_formats)
+      (List.length schema)
+      (Int64.of_int row_group_rows)
+      (Compression.to_cint compression)
+      max_in_flight
+      (Ctypes.CArray.start stats);
+    let stat i = Ctypes.CArray.get stats i |> Int64.to_int_exn in
+    { rows = stat 0
+    ; row_groups = stat 1
+    ; bytes_read = stat 2
+    ; bytes_written = stat 3
+    ; elapsed = Core_kernel.Time_ns.Span.of_int_ns (stat 4)
+    }
+
+  let csv_to_parquet = to_parquet ~format:0
+  let json_to_parquet = to_parquet ~format:1
 end
 
 module Feather_reader = struct
   let schema filename = C.Feather_reader.schema filename |> Schema.of_c
 
-  let table ?(column_idxs = []) filename =
+  let table ?(column_idxs = []) ?(io = `Pread) filename =
     let column_idxs = Ctypes.CArray.of_list Ctypes.int column_idxs in
     C.Feather_reader.read_table
       filename
       (Ctypes.CArray.start column_idxs)
       (Ctypes.CArray.length column_idxs)
+      (Io.to_cint io)
     |> Table.with_free
 end
 
 (* https://arrow.apache.org/docs/format/Columnar.html *)
 module Column = struct
+  (* How [prepare] reads a schema field: the datatype of its values on the C side
+     and, for time based fields, the unit in nanoseconds. *)
+  let field_datatype (field : Schema.t) =
+    let unit_in_ns = function
+      | `seconds -> 1_000_000_000
+      | `milliseconds -> 1_000_000
+      | `microseconds -> 1_000
+      | `nanoseconds -> 1
+    in
+    match field.format with
+    | Datatype.Int64 -> Some (`Int64, 1)
+    | Int32 -> Some (`Int32, 1)
+    | Float64 -> Some (`Float64, 1)
+    | Float32 -> Some (`Float32, 1)
+    | Utf8_string -> Some (`Utf8, 1)
+    | Boolean -> Some (`Bool, 1)
+    | Date32 `days -> Some (`Date32, 1)
+    | Timestamp { precision; timezone = _ } -> Some (`Timestamp, unit_in_ns precision)
+    | Time64 precision -> Some (`Time64, unit_in_ns precision)
+    | Duration precision -> Some (`Duration, unit_in_ns precision)
+    | _ -> None
+
+  let field_format_to_string (field : Schema.t) =
+    Datatype.sexp_of_t field.format |> Sexp.to_string
+
   let sexp_of_int64_bigarray ba =
     Array.init (Bigarray.Array1.dim ba) ~f:(Bigarray.Array1.get ba)
     |> [%sexp_of: int64 array]
@@ -367,6 +904,7 @@ module Column = struct
       | Int32
       | Time64
       | Duration
+      | Int8
 
     let to_int = function
       | Int64 -> 0
@@ -379,6 +917,7 @@ module Column = struct
       | Int32 -> 7
       | Time64 -> 8
       | Duration -> 9
+      | Int8 -> 10
   end
 
   let with_column table dt ~column ~f =
@@ -415,7 +954,7 @@ module Column = struct
 
   let of_chunks chunks ~kind ~ctype =
     let num_rows = num_rows chunks in
-    let dst = Bigarray.Array1.create kind C_layout num_rows in
+    let dst = Memory.bigarray_create kind num_rows in
     let _num_rows =
       List.fold chunks ~init:0 ~f:(fun dst_offset chunk ->
           let chunk = Chunk.create chunk ~fail_on_null:true ~fail_on_offset:false in
@@ -433,7 +972,7 @@ module Column = struct
   let read_ba_opt table ~datatype ~kind ~ctype ~column =
     with_column table datatype ~column ~f:(fun chunks ->
         let num_rows = num_rows chunks in
-        let dst = Bigarray.Array1.create kind C_layout num_rows in
+        let dst = Memory.bigarray_create kind num_rows in
         let valid = Valid.create_all_valid num_rows in
         let _num_rows =
           List.fold chunks ~init:0 ~f:(fun dst_offset chunk ->
@@ -539,28 +1078,39 @@ module Column = struct
         in
         bitset, valid)
 
+  let read_i8_ba = read_ba ~datatype:Int8 ~kind:Int8_signed ~ctype:Ctypes.int8_t
+  let read_i8_ba_opt = read_ba_opt ~datatype:Int8 ~kind:Int8_signed ~ctype:Ctypes.int8_t
   let read_i32_ba = read_ba ~datatype:Int32 ~kind:Int32 ~ctype:Ctypes.int32_t
   let read_i32_ba_opt = read_ba_opt ~datatype:Int32 ~kind:Int32 ~ctype:Ctypes.int32_t
   let read_i64_ba = read_ba ~datatype:Int64 ~kind:Int64 ~ctype:Ctypes.int64_t
   let read_i64_ba_opt = read_ba_opt ~datatype:Int64 ~kind:Int64 ~ctype:Ctypes.int64_t
 
-  let read_date table ~column =
-    let dst = read_ba table ~datatype:Date32 ~kind:Int32 ~ctype:Ctypes.int32_t ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        Core_kernel.Date.(add_days unix_epoch (Int32.to_int_exn dst.{idx})))
+  let map_ba ba ~f = Array.init (Bigarray.Array1.dim ba) ~f:(fun idx -> f ba.{idx})
 
-  let read_date_opt table ~column =
-    let dst, valid =
-      read_ba_opt table ~datatype:Date32 ~kind:Int32 ~ctype:Ctypes.int32_t ~column
-    in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        if Valid.get valid idx
-        then
-          Core_kernel.Date.(add_days unix_epoch (Int32.to_int_exn dst.{idx}))
-          |> Option.some
-        else None)
+  let map_ba_opt (ba, valid) ~f =
+    Array.init (Bigarray.Array1.dim ba) ~f:(fun idx ->
+        if Valid.get valid idx then Some (f ba.{idx}) else None)
+
+  let date_of_days days = Core_kernel.Date.(add_days unix_epoch (Int32.to_int_exn days))
+
+  let time_ns_of_int64 ~mult v =
+    Core_kernel.Time_ns.of_int_ns_since_epoch (mult * Int64.to_int_exn v)
+
+  let ofday_ns_of_int64 ~mult v =
+    Core_kernel.Time_ns.Span.of_int_ns (mult * Int64.to_int_exn v)
+    |> Core_kernel.Time_ns.Ofday.of_span_since_start_of_day_exn
+
+  let span_ns_of_int64 ~mult v = Core_kernel.Time_ns.Span.of_int_ns (mult * Int64.to_int_exn v)
+  let read_date32 = read_ba ~datatype:Date32 ~kind:Int32 ~ctype:Ctypes.int32_t
+  let read_date32_opt = read_ba_opt ~datatype:Date32 ~kind:Int32 ~ctype:Ctypes.int32_t
+  let read_timestamp = read_ba ~datatype:Timestamp ~kind:Int64 ~ctype:Ctypes.int64_t
+  let read_timestamp_opt = read_ba_opt ~datatype:Timestamp ~kind:Int64 ~ctype:Ctypes.int64_t
+  let read_time64 = read_ba ~datatype:Time64 ~kind:Int64 ~ctype:Ctypes.int64_t
+  let read_time64_opt = read_ba_opt ~datatype:Time64 ~kind:Int64 ~ctype:Ctypes.int64_t
+  let read_duration = read_ba ~datatype:Duration ~kind:Int64 ~ctype:Ctypes.int64_t
+  let read_duration_opt = read_ba_opt ~datatype:Duration ~kind:Int64 ~ctype:Ctypes.int64_t
+  let read_date table ~column = read_date32 table ~column |> map_ba ~f:date_of_days
+  let read_date_opt table ~column = read_date32_opt table ~column |> map_ba_opt ~f:date_of_days
 
   let timestamp_unit_in_ns table ~column =
     let column_name, column_idx =
@@ -587,70 +1137,34 @@ module Column = struct
     C.Table.duration_unit_in_ns table column_name column_idx
 
   let read_time_ns table ~column =
-    let dst =
-      read_ba table ~datatype:Timestamp ~kind:Int64 ~ctype:Ctypes.int64_t ~column
-    in
+    let dst = read_timestamp table ~column in
     let mult = timestamp_unit_in_ns table ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        Core_kernel.Time_ns.of_int_ns_since_epoch (mult * Int64.to_int_exn dst.{idx}))
+    map_ba dst ~f:(time_ns_of_int64 ~mult)
 
   let read_time_ns_opt table ~column =
-    let dst, valid =
-      read_ba_opt table ~datatype:Timestamp ~kind:Int64 ~ctype:Ctypes.int64_t ~column
-    in
+    let dst = read_timestamp_opt table ~column in
     let mult = timestamp_unit_in_ns table ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        if Valid.get valid idx
-        then
-          Core_kernel.Time_ns.of_int_ns_since_epoch (mult * Int64.to_int_exn dst.{idx})
-          |> Option.some
-        else None)
+    map_ba_opt dst ~f:(time_ns_of_int64 ~mult)
 
   let read_ofday_ns table ~column =
-    let dst = read_ba table ~datatype:Time64 ~kind:Int64 ~ctype:Ctypes.int64_t ~column in
+    let dst = read_time64 table ~column in
     let mult = time64_unit_in_ns table ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        Core_kernel.Time_ns.Span.of_int_ns (mult * Int64.to_int_exn dst.{idx})
-        |> Core_kernel.Time_ns.Ofday.of_span_since_start_of_day_exn)
+    map_ba dst ~f:(ofday_ns_of_int64 ~mult)
 
   let read_ofday_ns_opt table ~column =
-    let dst, valid =
-      read_ba_opt table ~datatype:Time64 ~kind:Int64 ~ctype:Ctypes.int64_t ~column
-    in
+    let dst = read_time64_opt table ~column in
     let mult = time64_unit_in_ns table ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        if Valid.get valid idx
-        then
-          Core_kernel.Time_ns.Span.of_int_ns (mult * Int64.to_int_exn dst.{idx})
-          |> Core_kernel.Time_ns.Ofday.of_span_since_start_of_day_exn
-          |> Option.some
-        else None)
+    map_ba_opt dst ~f:(ofday_ns_of_int64 ~mult)
 
   let read_span_ns table ~column =
-    let dst =
-      read_ba table ~datatype:Duration ~kind:Int64 ~ctype:Ctypes.int64_t ~column
-    in
+    let dst = read_duration table ~column in
     let mult = duration_unit_in_ns table ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        Core_kernel.Time_ns.Span.of_int_ns (mult * Int64.to_int_exn dst.{idx}))
+    map_ba dst ~f:(span_ns_of_int64 ~mult)
 
   let read_span_ns_opt table ~column =
-    let dst, valid =
-      read_ba_opt table ~datatype:Duration ~kind:Int64 ~ctype:Ctypes.int64_t ~column
-    in
+    let dst = read_duration_opt table ~column in
     let mult = duration_unit_in_ns table ~column in
-    let num_rows = Bigarray.Array1.dim dst in
-    Array.init num_rows ~f:(fun idx ->
-        if Valid.get valid idx
-        then
-          Core_kernel.Time_ns.Span.of_int_ns (mult * Int64.to_int_exn dst.{idx})
-          |> Option.some
-        else None)
+    map_ba_opt dst ~f:(span_ns_of_int64 ~mult)
 
   let read_f64_ba = read_ba ~datatype:Float64 ~kind:Float64 ~ctype:Ctypes.double
   let read_f64_ba_opt = read_ba_opt ~datatype:Float64 ~kind:Float64 ~ctype:Ctypes.double
@@ -773,42 +1287,314 @@ module Column = struct
     let ba, valid = read_f64_ba_opt table ~column in
     Array.init (Bigarray.Array1.dim ba) ~f:(fun i ->
         if Valid.get valid i then Some ba.{i} else None)
-end
 
-module Writer = struct
-  let verbose = false
+  (* The order here has to match the C side. *)
+  let utf8_predicate_to_cint = function
+    | `equal -> 0
+    | `starts_with -> 1
+    | `ends_with -> 2
+    | `contains -> 3
+    | `match_regex -> 4
+    | `in_set -> 5
+
+  let utf8_predicate table ~column predicate values =
+    let column_name, column_idx = column_name_and_idx column in
+    let valid = Valid.create_all_valid (Table.num_rows table) in
+    let mask = Valid.bigarray valid in
+    C.Table.utf8_predicate
+      table
+      column_name
+      column_idx
+      (utf8_predicate_to_cint predicate)
+      (ptr_of_strings values)
+      (List.length values)
+      (Ctypes.bigarray_start Array1 mask |> Ctypes.to_voidp);
+    valid
+
+  let utf8_equal table ~column ~value = utf8_predicate table ~column `equal [ value ]
+
+  let utf8_starts_with table ~column ~prefix =
+    utf8_predicate table ~column `starts_with [ prefix ]
+
+  let utf8_ends_with table ~column ~suffix =
+    utf8_predicate table ~column `ends_with [ suffix ]
+
+  let utf8_contains table ~column ~substring =
+    utf8_predicate table ~column `contains [ substring ]
+
+  let utf8_match_regex table ~column ~regex =
+    utf8_predicate table ~column `match_regex [ regex ]
+
+  let utf8_in_set table ~column ~values = utf8_predicate table ~column `in_set values
+
+  let utf8_length table ~column =
+    let column_name, column_idx = column_name_and_idx column in
+    let dst = Memory.bigarray_create Int32 (Table.num_rows table) in
+    C.Table.utf8_length
+      table
+      column_name
+      column_idx
+      (Ctypes.bigarray_start Array1 dst);
+    dst
 
-  module Release_array_fn_ptr =
-  (val Foreign.dynamic_funptr Ctypes.(C.ArrowArray.t @-> returning void))
+  type _ kind =
+    | Int : int array kind
+    | Int_opt : int option array kind
+    | Int32 : Int32.t array kind
+    | Int32_opt : Int32.t option array kind
+    | Float : float array kind
+    | Float_opt : float option array kind
+    | Utf8 : string array kind
+    | Utf8_opt : string option array kind
+    | Date : Core_kernel.Date.t array kind
+    | Date_opt : Core_kernel.Date.t option array kind
+    | Time_ns : Core_kernel.Time_ns.t array kind
+    | Time_ns_opt : Core_kernel.Time_ns.t option array kind
+    | Ofday_ns : Core_kernel.Time_ns.Ofday.t array kind
+    | Ofday_ns_opt : Core_kernel.Time_ns.Ofday.t option array kind
+    | Span_ns : Core_kernel.Time_ns.Span.t array kind
+    | Span_ns_opt : Core_kernel.Time_ns.Span.t option array kind
+    | Bitset : Valid.t kind
+    | Bitset_opt : (Valid.t * Valid.t) kind
+    | I32_ba : (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | I32_ba_opt :
+        ((int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+    | I64_ba : (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | I64_ba_opt :
+        ((int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+    | F32_ba : (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | F32_ba_opt :
+        ((float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+    | F64_ba : (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | F64_ba_opt :
+        ((float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+
+  type 'a accessor =
+    { column_idx : int
+    ; read : Table.t -> 'a
+    }
 
-  module Release_schema_fn_ptr =
-  (val Foreign.dynamic_funptr Ctypes.(C.ArrowSchema.t @-> returning void))
+  let prepare : type a. Schema.t -> column -> a kind -> a accessor =
+   fun schema column kind ->
+    let column_idx, field =
+      match column with
+      | `Index column_idx ->
+        (match List.nth schema.children column_idx with
+        | Some field -> column_idx, field
+        | None -> Printf.failwithf "invalid column index %d" column_idx ())
+      | `Name name ->
+        (match
+           List.findi schema.children ~f:(fun _ (field : Schema.t) ->
+               String.( = ) field.name name)
+         with
+        | Some (column_idx, field) -> column_idx, field
+        | None -> Printf.failwithf "cannot find column %s" name ())
+    in
+    let datatype, mult =
+      match field_datatype field with
+      | Some datatype_and_mult -> datatype_and_mult
+      | None ->
+        Printf.failwithf
+          "unsupported type %s for column %s"
+          (field_format_to_string field)
+          field.name
+          ()
+    in
+    let expect expected =
+      if Poly.( <> ) datatype expected
+      then
+        Printf.failwithf
+          "unexpected type %s for column %s"
+          (field_format_to_string field)
+          field.name
+          ()
+    in
+    (* Reading by index skips the name lookup, the C side still checks the type
+       of each table. *)
+    let column = `Index column_idx in
+    let read : Table.t -> a =
+      match kind with
+      | Int ->
+        expect `Int64;
+        read_int ~column
+      | Int_opt ->
+        expect `Int64;
+        read_int_opt ~column
+      | Int32 ->
+        expect `Int32;
+        read_int32 ~column
+      | Int32_opt ->
+        expect `Int32;
+        read_int32_opt ~column
+      | Float ->
+        expect `Float64;
+        read_float ~column
+      | Float_opt ->
+        expect `Float64;
+        read_float_opt ~column
+      | Utf8 ->
+        expect `Utf8;
+        read_utf8 ~column
+      | Utf8_opt ->
+        expect `Utf8;
+        read_utf8_opt ~column
+      | Date ->
+        expect `Date32;
+        read_date ~column
+      | Date_opt ->
+        expect `Date32;
+        read_date_opt ~column
+      | Time_ns ->
+        expect `Timestamp;
+        fun table -> read_timestamp table ~column |> map_ba ~f:(time_ns_of_int64 ~mult)
+      | Time_ns_opt ->
+        expect `Timestamp;
+        fun table ->
+          read_timestamp_opt table ~column |> map_ba_opt ~f:(time_ns_of_int64 ~mult)
+      | Ofday_ns ->
+        expect `Time64;
+        fun table -> read_time64 table ~column |> map_ba ~f:(ofday_ns_of_int64 ~mult)
+      | Ofday_ns_opt ->
+        expect `Time64;
+        fun table ->
+          read_time64_opt table ~column |> map_ba_opt ~f:(ofday_ns_of_int64 ~mult)
+      | Span_ns ->
+        expect `Duration;
+        fun table -> read_duration table ~column |> map_ba ~f:(span_ns_of_int64 ~mult)
+      | Span_ns_opt ->
+        expect `Duration;
+        fun table ->
+          read_duration_opt table ~column |> map_ba_opt ~f:(span_ns_of_int64 ~mult)
+      | Bitset ->
+        expect `Bool;
+        read_bitset ~column
+      | Bitset_opt ->
+        expect `Bool;
+        read_bitset_opt ~column
+      | I32_ba ->
+        expect `Int32;
+        read_i32_ba ~column
+      | I32_ba_opt ->
+        expect `Int32;
+        read_i32_ba_opt ~column
+      | I64_ba ->
+        expect `Int64;
+        read_i64_ba ~column
+      | I64_ba_opt ->
+        expect `Int64;
+        read_i64_ba_opt ~column
+      | F32_ba ->
+        expect `Float32;
+        read_f32_ba ~column
+      | F32_ba_opt ->
+        expect `Float32;
+        read_f32_ba_opt ~column
+      | F64_ba ->
+        expect `Float64;
+        read_f64_ba ~column
+      | F64_ba_opt ->
+        expect `Float64;
+        read_f64_ba_opt ~column
+    in
+    { column_idx; read }
+
+  let read accessor table = accessor.read table
+  let column_index accessor = accessor.column_idx
+end
 
-  (* Since [release_schema] and [release_array] are morally globals, we don't ever intend
-     to free them. However, flambda2 optimizes them into locals, so they're liable to get
-     collected, at which point the finalizer in [Foreign] complains that we never called
-     [Foreign.Funptr.free]. So we need to suppress that error by freeing the pointer
-     first. *)
-  let free_global_ptr_on_finalise ptr ~free =
-    Caml.Gc.finalise (fun ptr -> free ptr) ptr;
-    ptr
+module Lazy_table = struct
+  type t =
+    { ptr : C.Lazy_table.t
+    ; schema : Schema.t
+    }
 
-  (* For now [release_schema] and [release_array] don't do anything as the
-     memory is entirely managed on the ocaml side. *)
-  let release_schema =
-    let release_schema _ = if verbose then Stdio.printf "release schema\n%!" in
-    Release_schema_fn_ptr.of_fun release_schema
-    |> free_global_ptr_on_finalise ~free:Release_schema_fn_ptr.free
+  let create ?use_threads ?(io = `Pread) filename =
+    let format =
+      match String.rsplit2 filename ~on:'.' with
+      | Some (_, "parquet") -> 0
+      | Some (_, "feather") -> 1
+      | Some _ | None ->
+        Printf.failwithf
+          "cannot infer the file format from suffix %s (supported suffixes are \
+           feather/parquet)"
+          filename
+          ()
+    in
+    let ptr =
+      C.Lazy_table.open_
+        filename
+        format
+        (Parquet_reader.use_threads_to_cint use_threads)
+        (Io.to_cint io)
+    in
+    Caml.Gc.finalise C.Lazy_table.free ptr;
+    { ptr; schema = C.Lazy_table.schema ptr |> Schema.of_c }
+
+  let schema t = t.schema
+  let num_rows t = C.Lazy_table.num_rows t.ptr |> Int64.to_int_exn
+
+  let column_index t = function
+    | `Index index -> index
+    | `Name name ->
+      (match
+         List.findi t.schema.children ~f:(fun _ child ->
+             String.equal child.Schema.name name)
+       with
+      | Some (index, _) -> index
+      | None -> Printf.failwithf "cannot find column %s" name ())
+
+  let read_columns ?(offset = 0) ?length t columns =
+    let column_idxs = List.map columns ~f:(column_index t) in
+    let column_idxs = Ctypes.CArray.of_list Ctypes.int column_idxs in
+    C.Lazy_table.read
+      t.ptr
+      (Ctypes.CArray.start column_idxs)
+      (Ctypes.CArray.length column_idxs)
+      (Int64.of_int offset)
+      (Option.value_map length ~default:(-1L) ~f:Int64.of_int)
+    |> Table.with_free
 
-  let release_array =
-    let release_array _ = if verbose then Stdio.printf "release array\n%!" in
-    Release_array_fn_ptr.of_fun release_array
-    |> free_global_ptr_on_finalise ~free:Release_array_fn_ptr.free
+  let columns ?offset ?length t columns =
+    if List.is_empty columns
+    then invalid_arg "Lazy_table.columns: empty list of columns"
+    else read_columns ?offset ?length t columns
 
-  let release_array_ptr = Ctypes.(coerce Release_array_fn_ptr.t (ptr void) release_array)
+  let column ?offset ?length t col = columns ?offset ?length t [ col ]
+  let fast_read ?offset ?length t col = Column.fast_read (column ?offset ?length t col) 0
+  let to_table ?offset ?length t = read_columns ?offset ?length t []
+end
 
-  let release_schema_ptr =
-    Ctypes.(coerce Release_schema_fn_ptr.t (ptr void) release_schema)
+module Writer = struct
+  (* The structs built below live in OCaml memory. When exported with [export], their
+     [release] callbacks are set to native functions that drop a keepalive rooting the
+     OCaml values, so that arrow can hold onto them for as long as needed and release
+     them from any thread. *)
+  external export_keepalive
+    :  _ Cstubs_internals.fatptr
+    -> _ Cstubs_internals.fatptr
+    -> _
+    -> unit
+    = "arrow_export_keepalive"
+
+  external release_exported
+    :  _ Cstubs_internals.fatptr
+    -> _ Cstubs_internals.fatptr
+    -> unit
+    = "arrow_release_exported"
+
+  (* Roots are only removed while holding the runtime lock, this is done on each export
+     and at the end of each major collection. *)
+  external release_keepalives : unit -> unit = "arrow_release_keepalives"
+
+  let (_ : Caml.Gc.alarm) = Caml.Gc.create_alarm release_keepalives
+
+  let export array_struct schema_struct ~keepalive ~f =
+    let (Cstubs_internals.CPointer array_ptr) = Ctypes.addr array_struct in
+    let (Cstubs_internals.CPointer schema_ptr) = Ctypes.addr schema_struct in
+    export_keepalive array_ptr schema_ptr (array_struct, schema_struct, keepalive);
+    Exn.protect
+      ~f:(fun () -> f (Ctypes.addr array_struct) (Ctypes.addr schema_struct))
+      ~finally:(fun () -> release_exported array_ptr schema_ptr)
 
   let empty_schema_l = Ctypes.CArray.of_list (Ctypes.ptr C.ArrowSchema.t) []
   let empty_array_l = Ctypes.CArray.of_list (Ctypes.ptr C.ArrowArray.t) []
@@ -835,7 +1621,7 @@ module Writer = struct
       s
       C.ArrowSchema.dictionary
       (Ctypes.null |> Ctypes.from_voidp C.ArrowSchema.t);
-    Ctypes.setf s C.ArrowSchema.release release_schema_ptr;
+    Ctypes.setf s C.ArrowSchema.release Ctypes.null;
     s
 
   let array_struct ~null_count ~buffers ~children ~length ~finalise =
@@ -855,7 +1641,7 @@ module Writer = struct
     Ctypes.setf a C.ArrowArray.n_children (Ctypes.CArray.length children |> Int64.of_int);
     Ctypes.setf a C.ArrowArray.children (Ctypes.CArray.start children);
     Ctypes.setf a C.ArrowArray.dictionary (Ctypes.null |> Ctypes.from_voidp C.ArrowArray.t);
-    Ctypes.setf a C.ArrowArray.release release_array_ptr;
+    Ctypes.setf a C.ArrowArray.release Ctypes.null;
     a
 
   let int64_ba
@@ -912,6 +1698,60 @@ module Writer = struct
     in
     (array_struct, schema_struct : col)
 
+  let int8_ba
+      (array : (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t)
+      ~name
+    =
+    let buffers =
+      Ctypes.CArray.of_list
+        (Ctypes.ptr Ctypes.void)
+        [ Ctypes.null; Ctypes.bigarray_start Array1 array |> Ctypes.to_voidp ]
+    in
+    let array_struct =
+      array_struct
+        ~buffers
+        ~children:empty_array_l
+        ~null_count:0
+        ~finalise:(fun _ -> use_value array)
+        ~length:(Bigarray.Array1.dim array)
+    in
+    let schema_struct =
+      schema_struct ~format:"c" ~name ~children:empty_schema_l ~flag:Schema.Flags.none
+    in
+    (array_struct, schema_struct : col)
+
+  let int8_ba_opt
+      (array : (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t)
+      valid
+      ~name
+    =
+    if Bigarray.Array1.dim array <> Valid.length valid then failwith "incoherent lengths";
+    let buffers =
+      Ctypes.CArray.of_list
+        (Ctypes.ptr Ctypes.void)
+        [ Ctypes.bigarray_start Array1 (Valid.bigarray valid) |> Ctypes.to_voidp
+        ; Ctypes.bigarray_start Array1 array |> Ctypes.to_voidp
+        ]
+    in
+    let array_struct =
+      array_struct
+        ~buffers
+        ~children:empty_array_l
+        ~null_count:(Valid.num_false valid)
+        ~finalise:(fun _ ->
+          use_value array;
+          use_value valid)
+        ~length:(Bigarray.Array1.dim array)
+    in
+    let schema_struct =
+      schema_struct
+        ~format:"c"
+        ~name
+        ~children:empty_schema_l
+        ~flag:Schema.Flags.nullable_
+    in
+    (array_struct, schema_struct : col)
+
   let date date_array ~name =
     let array = Ctypes.CArray.make Ctypes.int32_t (Array.length date_array) in
     Array.iteri date_array ~f:(fun idx date ->
@@ -1364,7 +2204,12 @@ module Writer = struct
     in
     (array_struct, schema_struct : col)
 
-  let write ?(chunk_size = 1024 * 1024) ?(compression = Compression.Snappy) filename ~cols
+  let write
+      ?(chunk_size = 1024 * 1024)
+      ?(compression = Compression.Snappy)
+      ?(bloom_filter_columns = [])
+      filename
+      ~cols
     =
     let children_arrays, children_schemas = List.unzip cols in
     let num_rows =
@@ -1400,16 +2245,24 @@ module Writer = struct
       if String.is_suffix filename ~suffix:".feather"
       then C.feather_write_file
       else if String.is_suffix filename ~suffix:".parquet"
-      then C.parquet_write_file
+      then
+        fun f a s cs comp ->
+        C.parquet_write_file
+          f
+          a
+          s
+          cs
+          comp
+          (ptr_of_strings bloom_filter_columns)
+          (List.length bloom_filter_columns)
       else fun f a s cs _comp -> C.arrow_write_file f a s cs
     in
-    write_fn
-      filename
-      (Ctypes.addr array_struct)
-      (Ctypes.addr schema_struct)
-      chunk_size
-      (Compression.to_cint compression);
-    use_value cols
+    export
+      array_struct
+      schema_struct
+      ~keepalive:(cols, children_arrays, children_schemas)
+      ~f:(fun array schema ->
+        write_fn filename array schema chunk_size (Compression.to_cint compression))
 
   let create_table ~cols =
     let children_arrays, children_schemas = List.unzip cols in
@@ -1442,13 +2295,12 @@ module Writer = struct
         ~flag:Schema.Flags.none
     in
     if add_compact then Caml.Gc.compact ();
-    let table =
-      C.Table.create (Ctypes.addr array_struct) (Ctypes.addr schema_struct)
-      |> Table.with_free
-    in
-    use_value cols;
-    Caml.Gc.finalise (fun _ -> use_value cols) table;
-    table
+    export
+      array_struct
+      schema_struct
+      ~keepalive:(cols, children_arrays, children_schemas)
+      ~f:C.Table.create
+    |> Table.with_free
 
   let int array ~name =
     let ba = Bigarray.Array1.create Int64 C_layout (Array.length array) in
@@ -1481,60 +2333,180 @@ module Writer = struct
     float64_ba_opt ba valid ~name
 end
 
+(* The builder entry points are called once per value, they use direct externals
+   rather than the ctypes stubs to avoid boxing their arguments and results. *)
+module Fast_builder = struct
+  external last_error : unit -> string = "fast_builder_last_error"
+
+  let check status = if status <> 0 then failwith (last_error ())
+end
+
 module DoubleBuilder = struct
   type t = C.DoubleBuilder.t
 
+  external append
+    :  _ Cstubs_internals.fatptr
+    -> (float[@unboxed])
+    -> (int[@untagged])
+    = "fast_append_double_builder_byte" "fast_append_double_builder"
+    [@@noalloc]
+
+  external append_null
+    :  _ Cstubs_internals.fatptr
+    -> (int[@untagged])
+    -> (int[@untagged])
+    = "fast_append_null_double_builder_byte" "fast_append_null_double_builder"
+    [@@noalloc]
+
+  external length
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_length_double_builder_byte" "fast_length_double_builder"
+    [@@noalloc]
+
+  external null_count
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_null_count_double_builder_byte" "fast_null_count_double_builder"
+    [@@noalloc]
+
   let create () =
     let t = C.DoubleBuilder.create () in
     Caml.Gc.finalise C.DoubleBuilder.free t;
     t
 
-  let append_null ?(n = 1) t = C.DoubleBuilder.append_null t n
-  let append t v = C.DoubleBuilder.append t v
-  let length t = C.DoubleBuilder.length t
-  let null_count t = C.DoubleBuilder.null_count t
+  let append_null ?(n = 1) (Cstubs_internals.CPointer t : t) =
+    Fast_builder.check (append_null t n)
+
+  let append (Cstubs_internals.CPointer t : t) v = Fast_builder.check (append t v)
+  let length (Cstubs_internals.CPointer t : t) = length t
+  let null_count (Cstubs_internals.CPointer t : t) = null_count t
 end
 
 module Int32Builder = struct
   type t = C.Int32Builder.t
 
+  external append
+    :  _ Cstubs_internals.fatptr
+    -> (int32[@unboxed])
+    -> (int[@untagged])
+    = "fast_append_int32_builder_byte" "fast_append_int32_builder"
+    [@@noalloc]
+
+  external append_null
+    :  _ Cstubs_internals.fatptr
+    -> (int[@untagged])
+    -> (int[@untagged])
+    = "fast_append_null_int32_builder_byte" "fast_append_null_int32_builder"
+    [@@noalloc]
+
+  external length
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_length_int32_builder_byte" "fast_length_int32_builder"
+    [@@noalloc]
+
+  external null_count
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_null_count_int32_builder_byte" "fast_null_count_int32_builder"
+    [@@noalloc]
+
   let create () =
     let t = C.Int32Builder.create () in
     Caml.Gc.finalise C.Int32Builder.free t;
     t
 
-  let append_null ?(n = 1) t = C.Int32Builder.append_null t n
-  let append t v = C.Int32Builder.append t v
-  let length t = C.Int32Builder.length t
-  let null_count t = C.Int32Builder.null_count t
+  let append_null ?(n = 1) (Cstubs_internals.CPointer t : t) =
+    Fast_builder.check (append_null t n)
+
+  let append (Cstubs_internals.CPointer t : t) v = Fast_builder.check (append t v)
+  let length (Cstubs_internals.CPointer t : t) = length t
+  let null_count (Cstubs_internals.CPointer t : t) = null_count t
 end
 
 module Int64Builder = struct
   type t = C.Int64Builder.t
 
+  external append
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    -> (int[@untagged])
+    = "fast_append_int64_builder_byte" "fast_append_int64_builder"
+    [@@noalloc]
+
+  external append_null
+    :  _ Cstubs_internals.fatptr
+    -> (int[@untagged])
+    -> (int[@untagged])
+    = "fast_append_null_int64_builder_byte" "fast_append_null_int64_builder"
+    [@@noalloc]
+
+  external length
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_length_int64_builder_byte" "fast_length_int64_builder"
+    [@@noalloc]
+
+  external null_count
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_null_count_int64_builder_byte" "fast_null_count_int64_builder"
+    [@@noalloc]
+
   let create () =
     let t = C.Int64Builder.create () in
     Caml.Gc.finalise C.Int64Builder.free t;
     t
 
-  let append_null ?(n = 1) t = C.Int64Builder.append_null t n
-  let append t v = C.Int64Builder.append t v
-  let length t = C.Int64Builder.length t
-  let null_count t = C.Int64Builder.null_count t
+  let append_null ?(n = 1) (Cstubs_internals.CPointer t : t) =
+    Fast_builder.check (append_null t n)
+
+  let append (Cstubs_internals.CPointer t : t) v = Fast_builder.check (append t v)
+  let length (Cstubs_internals.CPointer t : t) = length t
+  let null_count (Cstubs_internals.CPointer t : t) = null_count t
 end
 
 module StringBuilder = struct
   type t = C.StringBuilder.t
 
+  external append
+    :  _ Cstubs_internals.fatptr
+    -> string
+    -> (int[@untagged])
+    = "fast_append_string_builder_byte" "fast_append_string_builder"
+    [@@noalloc]
+
+  external append_null
+    :  _ Cstubs_internals.fatptr
+    -> (int[@untagged])
+    -> (int[@untagged])
+    = "fast_append_null_string_builder_byte" "fast_append_null_string_builder"
+    [@@noalloc]
+
+  external length
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_length_string_builder_byte" "fast_length_string_builder"
+    [@@noalloc]
+
+  external null_count
+    :  _ Cstubs_internals.fatptr
+    -> (int64[@unboxed])
+    = "fast_null_count_string_builder_byte" "fast_null_count_string_builder"
+    [@@noalloc]
+
   let create () =
     let t = C.StringBuilder.create () in
     Caml.Gc.finalise C.StringBuilder.free t;
     t
 
-  let append_null ?(n = 1) t = C.StringBuilder.append_null t n
-  let append t v = C.StringBuilder.append t v
-  let length t = C.StringBuilder.length t
-  let null_count t = C.StringBuilder.null_count t
+  let append_null ?(n = 1) (Cstubs_internals.CPointer t : t) =
+    Fast_builder.check (append_null t n)
+
+  let append (Cstubs_internals.CPointer t : t) v = Fast_builder.check (append t v)
+  let length (Cstubs_internals.CPointer t : t) = length t
+  let null_count (Cstubs_internals.CPointer t : t) = null_count t
 end
 
 module Builder = struct
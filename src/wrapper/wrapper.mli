@@ -1,5 +1,29 @@
 open! Base
 
+(* Memory used by the arrow buffers and by the bigarrays returned when reading
+   columns. Allocations of at least the huge page threshold are aligned on 2MiB
+   and backed by transparent huge pages when the kernel allows it, this reduces
+   TLB misses when decoding or scanning large tables. The threshold is rounded
+   up to the huge page size, huge pages are disabled by default. *)
+module Memory : sig
+  val set_huge_page_threshold : int -> unit
+  val disable_huge_pages : unit -> unit
+
+  (* Bytes allocated by arrow buffers, bigarrays are not included. *)
+  val bytes_allocated : unit -> int
+
+  val max_memory : unit -> int
+
+  (* Number of arrow buffers and bigarrays allocated with huge pages so far. *)
+  val huge_page_allocations : unit -> int
+
+  (* Same as [Bigarray.Array1.create] with the huge page allocator. *)
+  val bigarray_create
+    :  ('a, 'b) Bigarray.kind
+    -> int
+    -> ('a, 'b, Bigarray.c_layout) Bigarray.Array1.t
+end
+
 module Schema : sig
   module Flags : sig
     type t [@@deriving sexp_of]
@@ -27,6 +51,46 @@ module ChunkedArray : sig
   type t
 end
 
+(* Backends used to read files. [`Uring] submits reads through io_uring with
+   batched prefetching, which mostly helps on fast NVMe drives and network
+   filesystems with many small column chunks. It falls back to [`Pread] when
+   the kernel does not support io_uring. [`Direct] bypasses the page cache with
+   large aligned reads, so that one-pass scans of cold files do not evict the
+   data used by other processes. On filesystems without O_DIRECT support, the
+   pages read are dropped from the cache instead. *)
+module Io : sig
+  type t =
+    [ `Pread
+    | `Mmap
+    | `Uring
+    | `Direct
+    ]
+
+  val uring_available : unit -> bool
+end
+
+(* Aggregations of the rows falling in a time bucket. Nulls and nans are
+   skipped, a bar with no value left gives a null for all the aggregations but
+   [`Count] which gives 0. [`Vwap (price, volume)] is the volume weighted
+   average price. *)
+module Resample_agg : sig
+  type column =
+    [ `Index of int
+    | `Name of string
+    ]
+
+  type t =
+    [ `First of column
+    | `Last of column
+    | `Min of column
+    | `Max of column
+    | `Sum of column
+    | `Mean of column
+    | `Count of column
+    | `Vwap of column * column
+    ]
+end
+
 module Table : sig
   type t
 
@@ -34,23 +98,169 @@ module Table : sig
   val slice : t -> offset:int -> length:int -> t
   val num_rows : t -> int
   val schema : t -> Schema.t
-  val read_csv : string -> t
-  val read_json : string -> t
-  val write_parquet : ?chunk_size:int -> ?compression:Compression.t -> t -> string -> unit
+
+  (* A hash of the schema that is much cheaper than [schema], tables with equal
+     schemas have the same fingerprint. Batch readers can use it to only resolve
+     columns again when the schema changes, see [Column.prepare]. *)
+  val schema_fingerprint : t -> int
+
+  (* Column types are inferred unless given by [schema], only the columns of
+     [schema] are read then. *)
+  val read_csv : ?schema:(string * Datatype.t) list -> ?io:Io.t -> string -> t
+  val read_json : ?io:Io.t -> string -> t
+  (* [bloom_filter_columns] adds a bloom filter per row group for each of these
+     columns to the file metadata, see [Parquet_reader.lookup]. *)
+  val write_parquet
+    :  ?chunk_size:int
+    -> ?compression:Compression.t
+    -> ?bloom_filter_columns:string list
+    -> t
+    -> string
+    -> unit
+
+  (* Values are formatted natively, in parallel over ranges of rows. With the
+     default [`needed] quoting, strings are quoted when they contain the
+     delimiter, a quote or a newline, or when they would read back as null. *)
+  val write_csv
+    :  ?header:bool
+    -> ?delimiter:char
+    -> ?quoting:[ `needed | `all_strings | `none ]
+    -> ?null:string
+    -> t
+    -> string
+    -> unit
+
+  (* Writes one json object per row, temporal values are written as strings. *)
+  val write_ndjson : t -> string -> unit
+
   val write_feather : ?chunk_size:int -> ?compression:Compression.t -> t -> string -> unit
   val to_string_debug : t -> string
   val add_column : t -> string -> ChunkedArray.t -> t
   val get_column : t -> string -> ChunkedArray.t
   val add_all_columns : t -> t -> t
+
+  (* Keeps the rows that are set in the mask, e.g. as returned by the
+     [Column.utf8_*] predicates. *)
+  val filter : t -> Valid.t -> t
+
+  (* Hash of each row over the given columns, nulls and values of any
+     primitive, temporal or string type are supported. Integer like values are
+     hashed as int64, so that keys of different integer widths hash the same.
+     Hashes only depend on the values and are stable across processes. *)
+  val hash_rows
+    :  t
+    -> [ `Index of int | `Name of string ] list
+    -> (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+  (* Splits the table in [n] tables according to the hash of the given columns
+     modulo [n], rows with the same key end up in the same table. Rows keep
+     their relative order. *)
+  val partition_by_hash : t -> [ `Index of int | `Name of string ] list -> n:int -> t array
+
+  (* Removes the rows with duplicate [keys], all the columns by default. The
+     first or last row of each key is kept and rows keep their relative order.
+     Nulls are equal to each other, as are nans. *)
+  val distinct
+    :  ?keys:[ `Index of int | `Name of string ] list
+    -> keep:[ `First | `Last ]
+    -> t
+    -> t
+
+  (* The [k] rows with the largest values in column [by], or the smallest ones
+     when [smallest] is set, sorted from best to worst. Integer, temporal and
+     float columns are supported, nulls and nans are skipped and ties are
+     broken by row order. This runs in O(n log k) without sorting the table. *)
+  val top_k
+    :  ?smallest:bool
+    -> t
+    -> by:[ `Index of int | `Name of string ]
+    -> k:int
+    -> t
+
+  (* [top_k] for each group of rows with the same values in the [group_by]
+     columns, groups come in order of first appearance. *)
+  val top_k_by_group
+    :  ?smallest:bool
+    -> t
+    -> by:[ `Index of int | `Name of string ]
+    -> group_by:[ `Index of int | `Name of string ] list
+    -> k:int
+    -> t
+
+  (* Aggregates the rows in bars per group of [by] values and time bucket of
+     size [every], e.g. one second OHLCV bars with
+     [~aggs:[ "open", `First px; "high", `Max px; "low", `Min px; "close", `Last px;
+     "volume", `Sum size ]]. Buckets are aligned on multiples of [every] since
+     midnight in [zone], utc by default, so that daily bars follow the local
+     day boundaries. Rows have to be sorted by [time] within each group.
+     The result has the [by] columns, the bucket start in the [time] column and
+     a column per aggregation, sorted by bucket then group. Aggregated values
+     are floats and counts are ints. *)
+  val resample
+    :  ?by:[ `Index of int | `Name of string ] list
+    -> ?zone:Core_kernel.Time.Zone.t
+    -> t
+    -> time:[ `Index of int | `Name of string ]
+    -> every:Core_kernel.Time_ns.Span.t
+    -> aggs:(string * Resample_agg.t) list
+    -> t
+
+  (* Adds a column per element of [aggs] with the aggregation of a column over
+     a trailing time [window]. The window of a row holds the previous rows with
+     the same [by] values, and the row itself, whose [time] is less than [window]
+     before its own. Rows have to be sorted by [time] within each group and
+     [time] has to be a timestamp column without nulls.
+     Aggregated values are converted to floats, nulls and nans are skipped.
+     Windows with no value left give nulls, except for [`Count] which gives
+     ints and so 0 there. *)
+  val rolling
+    :  ?by:[ `Index of int | `Name of string ] list
+    -> t
+    -> time:[ `Index of int | `Name of string ]
+    -> window:Core_kernel.Time_ns.Span.t
+    -> aggs:
+         (string
+         * [ `Sum of [ `Index of int | `Name of string ]
+           | `Mean of [ `Index of int | `Name of string ]
+           | `Min of [ `Index of int | `Name of string ]
+           | `Max of [ `Index of int | `Name of string ]
+           | `Count of [ `Index of int | `Name of string ]
+           ])
+         list
+    -> t
+end
+
+(* Streaming csv/ndjson writers, the csv header is written with the first table.
+   This can be used to convert large files batch by batch. *)
+module Text_writer : sig
+  type t
+
+  val create_csv
+    :  ?header:bool
+    -> ?delimiter:char
+    -> ?quoting:[ `needed | `all_strings | `none ]
+    -> ?null:string
+    -> string
+    -> t
+
+  val create_ndjson : string -> t
+  val write : t -> Table.t -> unit
+  val close : t -> unit
+
+  (* Closes the writer once [f] returns or raises. *)
+  val with_writer : t -> f:(t -> 'a) -> 'a
 end
 
 module Parquet_reader : sig
   type t
 
+  (* [~mmap:true] is the same as [~io:`Mmap], it raises when combined with the
+     io_uring or direct backends. *)
   val create
     :  ?use_threads:bool
     -> ?column_idxs:int list
     -> ?mmap:bool
+    -> ?io:Io.t
     -> ?buffer_size:int
     -> ?batch_size:int
     -> string
@@ -61,17 +271,178 @@ module Parquet_reader : sig
   val schema : string -> Schema.t
   val schema_and_num_rows : string -> Schema.t * int
 
+  (* By default arrow decodes the columns in parallel when [use_threads] is set,
+     which gives little speedup on files with few columns. [`Row_groups] decodes
+     disjoint row groups concurrently instead and [`Both] combines the two,
+     [use_threads] is ignored for these. The row groups modes do not apply with
+     [only_first]. *)
   val table
     :  ?only_first:int
     -> ?use_threads:bool
+    -> ?parallelism:[ `Columns | `Row_groups | `Both ]
+    -> ?column_idxs:int list
+    -> ?io:Io.t
+    -> string
+    -> Table.t
+
+  (* Returns the rows for which [column] is one of [values], integer values are
+     compared to the integers of the arrow column, e.g. days for date32 or the
+     column unit for timestamps, whatever unit the file stores them in. Only the
+     row groups that may contain these values according to their statistics and
+     to the bloom filters written via [bloom_filter_columns] get decoded. *)
+  val lookup
+    :  ?use_threads:bool
+    -> ?column_idxs:int list
+    -> ?io:Io.t
+    -> string
+    -> column:string
+    -> values:[ `ints of int list | `strings of string list ]
+    -> Table.t
+
+  (* Returns a random sample of the rows without replacement, in file order.
+     Only the row groups that contain sampled rows get decoded, one at a time
+     so that memory usage is bounded by a row group and the sample. With
+     [stratify_by], each distinct value of this column gets a number of rows
+     proportional to its frequency. The sample only depends on [seed] and on the
+     file content. *)
+  val sample
+    :  ?use_threads:bool
+    -> ?column_idxs:int list
+    -> ?stratify_by:string
+    -> ?io:Io.t
+    -> ?seed:int
+    -> string
+    -> fraction:float
+    -> Table.t
+
+  val sample_n
+    :  ?use_threads:bool
     -> ?column_idxs:int list
+    -> ?stratify_by:string
+    -> ?io:Io.t
+    -> ?seed:int
     -> string
+    -> n:int
     -> Table.t
 end
 
+(* Arrow IPC stream files that tables can be appended to. Each append writes a
+   record batch, so the file can be read while it is still being written. *)
+module Ipc_stream : sig
+  type t
+
+  (* [fsync] controls when the data is synced to disk, after each [flush] or
+     after each [append]. Unless [fsync] is [`never], the file is also synced on
+     [close]. *)
+  val create : ?fsync:[ `never | `on_flush | `every_append ] -> string -> t
+  val append : t -> Table.t -> unit
+  val flush : t -> unit
+  val close : t -> unit
+
+  (* Returns all the complete batches, a trailing partially written batch is
+     ignored. A stream that nothing has been appended to yet reads as an empty
+     table without columns. *)
+  val read : ?io:Io.t -> string -> Table.t
+end
+
+(* Streaming version of [Table.resample], bars are kept open between tables
+   so that files can be resampled batch by batch. *)
+module Resampler : sig
+  type t
+
+  val create
+    :  ?by:[ `Index of int | `Name of string ] list
+    -> ?zone:Core_kernel.Time.Zone.t
+    -> time:[ `Index of int | `Name of string ]
+    -> every:Core_kernel.Time_ns.Span.t
+    -> aggs:(string * Resample_agg.t) list
+    -> unit
+    -> t
+
+  (* Adds the rows of a table, returns the bars that got closed, i.e. the bars
+     of the groups which have a row in a later bucket. *)
+  val push : t -> Table.t -> Table.t
+
+  (* Returns the bars that are still open, this should be called after the
+     last table has been pushed. *)
+  val finish : t -> Table.t
+end
+
+(* Mergeable column summaries: exact counts, min and max, a t-digest for
+   quantiles and a HyperLogLog for distinct counts. Sketches are updated
+   natively from tables, e.g. from the batches of [Parquet_reader.iter_batches],
+   and can be merged and serialized to combine results over many files. *)
+module Sketch : sig
+  type t
+
+  (* [compression] bounds the number of t-digest centroids, higher values give
+     more accurate quantiles. The HyperLogLog uses [2^hll_precision] bytes and
+     has a standard error of about [1.04 / sqrt (2^hll_precision)]. *)
+  val create : ?compression:float -> ?hll_precision:int -> unit -> t
+
+  (* Integer, temporal and float values feed all the estimators, with min, max
+     and quantiles computed on floats. String values only feed the counts and
+     the distinct count. *)
+  val update_from_table : t -> Table.t -> [ `Index of int | `Name of string ] -> unit
+
+  (* [merge t other] adds the values of [other] to [t], the HyperLogLog
+     precisions have to be the same. *)
+  val merge : t -> t -> unit
+
+  val serialize : t -> string
+  val deserialize : string -> t
+
+  (* Number of non-null values. *)
+  val count : t -> int
+
+  val null_count : t -> int
+  val min : t -> float option
+  val max : t -> float option
+  val quantile : t -> float -> float option
+  val distinct_count : t -> float
+end
+
+(* Converts csv or newline delimited json files to parquet in a streaming way:
+   parsing runs on a background thread and row groups are written as batches
+   come, so memory usage is bounded by [max_in_flight] batches and a row group
+   whatever the size of the input. Column types are inferred from the first
+   block of the input unless given by [schema]. *)
+module Convert : sig
+  type stats =
+    { rows : int
+    ; row_groups : int
+    ; bytes_read : int
+    ; bytes_written : int
+    ; elapsed : Core_kernel.Time_ns.Span.t
+    }
+  [@@deriving sexp_of]
+
+  val bytes_per_second : stats -> float
+
+  val csv_to_parquet
+    :  ?schema:(string * Datatype.t) list
+    -> ?row_group_rows:int
+    -> ?compression:Compression.t
+    -> ?max_in_flight:int
+    -> src:string
+    -> dst:string
+    -> unit
+    -> stats
+
+  val json_to_parquet
+    :  ?schema:(string * Datatype.t) list
+    -> ?row_group_rows:int
+    -> ?compression:Compression.t
+    -> ?max_in_flight:int
+    -> src:string
+    -> dst:string
+    -> unit
+    -> stats
+end
+
 module Feather_reader : sig
   val schema : string -> Schema.t
-  val table : ?column_idxs:int list -> string -> Table.t
+  val table : ?column_idxs:int list -> ?io:Io.t -> string -> Table.t
 end
 
 module Column : sig
@@ -80,6 +451,11 @@ module Column : sig
     | `Name of string
     ]
 
+  val read_i8_ba
+    :  Table.t
+    -> column:column
+    -> (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t
+
   val read_i32_ba
     :  Table.t
     -> column:column
@@ -111,6 +487,11 @@ module Column : sig
   val read_bitset : Table.t -> column:column -> Valid.t
   val read_bitset_opt : Table.t -> column:column -> Valid.t * Valid.t
 
+  val read_i8_ba_opt
+    :  Table.t
+    -> column:column
+    -> (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t
+
   val read_i32_ba_opt
     :  Table.t
     -> column:column
@@ -161,6 +542,88 @@ module Column : sig
   [@@deriving sexp_of]
 
   val fast_read : Table.t -> int -> t
+
+  (* Native predicates on utf8 columns returning the mask of the matching rows,
+     null values never match. These run in parallel over ranges of rows without
+     materializing the strings on the OCaml side. Regexes use the ECMAScript
+     syntax and match anywhere in the value. *)
+  val utf8_equal : Table.t -> column:column -> value:string -> Valid.t
+  val utf8_starts_with : Table.t -> column:column -> prefix:string -> Valid.t
+  val utf8_ends_with : Table.t -> column:column -> suffix:string -> Valid.t
+  val utf8_contains : Table.t -> column:column -> substring:string -> Valid.t
+  val utf8_match_regex : Table.t -> column:column -> regex:string -> Valid.t
+  val utf8_in_set : Table.t -> column:column -> values:string list -> Valid.t
+
+  (* Number of unicode code points of each value, 0 for null values. *)
+  val utf8_length
+    :  Table.t
+    -> column:column
+    -> (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+  (* The result of reading a column, one constructor per [read_*] function. *)
+  type _ kind =
+    | Int : int array kind
+    | Int_opt : int option array kind
+    | Int32 : Int32.t array kind
+    | Int32_opt : Int32.t option array kind
+    | Float : float array kind
+    | Float_opt : float option array kind
+    | Utf8 : string array kind
+    | Utf8_opt : string option array kind
+    | Date : Core_kernel.Date.t array kind
+    | Date_opt : Core_kernel.Date.t option array kind
+    | Time_ns : Core_kernel.Time_ns.t array kind
+    | Time_ns_opt : Core_kernel.Time_ns.t option array kind
+    | Ofday_ns : Core_kernel.Time_ns.Ofday.t array kind
+    | Ofday_ns_opt : Core_kernel.Time_ns.Ofday.t option array kind
+    | Span_ns : Core_kernel.Time_ns.Span.t array kind
+    | Span_ns_opt : Core_kernel.Time_ns.Span.t option array kind
+    | Bitset : Valid.t kind
+    | Bitset_opt : (Valid.t * Valid.t) kind
+    | I32_ba : (int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | I32_ba_opt :
+        ((int32, Bigarray.int32_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+    | I64_ba : (int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | I64_ba_opt :
+        ((int64, Bigarray.int64_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+    | F32_ba : (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | F32_ba_opt :
+        ((float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+    | F64_ba : (float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t kind
+    | F64_ba_opt :
+        ((float, Bigarray.float64_elt, Bigarray.c_layout) Bigarray.Array1.t * Valid.t) kind
+
+  type 'a accessor
+
+  (* [prepare schema column kind] resolves the column index, checks its type and
+     extracts the time unit once so that [read] can then be applied to each batch
+     sharing this schema without going through the schema again. Use
+     [Table.schema_fingerprint] to detect batches with a different schema. *)
+  val prepare : Schema.t -> column -> 'a kind -> 'a accessor
+
+  val read : 'a accessor -> Table.t -> 'a
+  val column_index : _ accessor -> int
+end
+
+(* A handle over a parquet or feather file whose columns only get decoded on
+   first access, e.g. for tools that only know at runtime which columns are
+   needed. For parquet files, only the row groups overlapping the requested
+   rows are decoded. Decoded data is cached in the handle so the following
+   accesses are free. *)
+module Lazy_table : sig
+  type t
+
+  val create : ?use_threads:bool -> ?io:Io.t -> string -> t
+  val schema : t -> Schema.t
+  val num_rows : t -> int
+
+  (* Returns a table with the given columns, restricted to the rows
+     [offset, offset + length) when specified. *)
+  val columns : ?offset:int -> ?length:int -> t -> Column.column list -> Table.t
+
+  val column : ?offset:int -> ?length:int -> t -> Column.column -> Table.t
+  val fast_read : ?offset:int -> ?length:int -> t -> Column.column -> Column.t
+  val to_table : ?offset:int -> ?length:int -> t -> Table.t
 end
 
 module Writer : sig
@@ -177,6 +640,17 @@ module Writer : sig
     -> name:string
     -> col
 
+  val int8_ba
+    :  (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t
+    -> name:string
+    -> col
+
+  val int8_ba_opt
+    :  (int, Bigarray.int8_signed_elt, Bigarray.c_layout) Bigarray.Array1.t
+    -> Valid.t
+    -> name:string
+    -> col
+
   val int : int array -> name:string -> col
   val int_opt : int option array -> name:string -> col
 
@@ -209,13 +683,17 @@ module Writer : sig
   val bitset : Valid.t -> name:string -> col
   val bitset_opt : Valid.t -> valid:Valid.t -> name:string -> col
 
+  (* [bloom_filter_columns] is only used when writing parquet files. *)
   val write
     :  ?chunk_size:int
     -> ?compression:Compression.t
+    -> ?bloom_filter_columns:string list
     -> string
     -> cols:col list
     -> unit
 
+  (* The returned table keeps the column buffers alive on its own, it can outlive [cols]
+     and be released from any thread. *)
   val create_table : cols:col list -> Table.t
 end
 
@@ -0,0 +1,66 @@
+open Core_kernel
+open Arrow_c_api
+
+let with_files ~suffix ~f =
+  let src = Caml.Filename.temp_file "test" suffix in
+  let dst = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () -> f ~src ~dst)
+    ~finally:(fun () ->
+      Caml.Sys.remove src;
+      Caml.Sys.remove dst)
+
+let print_parquet (stats : Convert.stats) dst =
+  Stdio.printf "rows: %d, row groups: %d\n" stats.rows stats.row_groups;
+  let table = Parquet_reader.table dst in
+  let x = Table.read table Int ~column:(`Name "x") in
+  let y = Table.read table Utf8 ~column:(`Name "y") in
+  Array.iteri x ~f:(fun i x -> Stdio.printf "%d %s\n" x y.(i))
+
+let%expect_test _ =
+  with_files ~suffix:".csv" ~f:(fun ~src ~dst ->
+      List.init 10 ~f:(fun i -> Printf.sprintf "%d,v%d,%f" i i (Float.of_int i))
+      |> List.cons "x,y,z"
+      |> Out_channel.write_lines src;
+      let stats =
+        Convert.csv_to_parquet
+          ~schema:[ "x", Int64; "y", Utf8_string ]
+          ~row_group_rows:4
+          ~src
+          ~dst
+          ()
+      in
+      print_parquet stats dst;
+      let schema = Parquet_reader.schema dst in
+      List.map schema.children ~f:(fun s -> s.Schema.name)
+      |> String.concat ~sep:","
+      |> print_endline);
+  [%expect
+    {|
+    rows: 10, row groups: 3
+    0 v0
+    1 v1
+    2 v2
+    3 v3
+    4 v4
+    5 v5
+    6 v6
+    7 v7
+    8 v8
+    9 v9
+    x,y |}]
+
+let%expect_test _ =
+  with_files ~suffix:".json" ~f:(fun ~src ~dst ->
+      List.init 5 ~f:(fun i -> Printf.sprintf {|{"x": %d, "y": "v%d"}|} i i)
+      |> Out_channel.write_lines src;
+      let stats = Convert.json_to_parquet ~row_group_rows:2 ~src ~dst () in
+      print_parquet stats dst);
+  [%expect
+    {|
+    rows: 5, row groups: 3
+    0 v0
+    1 v1
+    2 v2
+    3 v3
+    4 v4 |}]
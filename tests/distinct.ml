@@ -0,0 +1,47 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col [| 1; 2; 1; 3; 2; 1 |] Int ~name:"seq"
+      ; Table.col_opt [| Some "a"; None; Some "a"; Some "b"; None; Some "c" |] Utf8 ~name:"src"
+      ; Table.col [| 0.; 1.; 2.; 3.; 4.; 5. |] Float ~name:"x"
+      ]
+  in
+  let print table =
+    let seq = Table.read table Int ~column:(`Name "seq") in
+    let src = Table.read_opt table Utf8 ~column:(`Name "src") in
+    let x = Table.read table Float ~column:(`Name "x") in
+    Array.iteri seq ~f:(fun i seq ->
+        Stdio.printf "%d %s %.0f\n" seq (Option.value src.(i) ~default:"null") x.(i))
+  in
+  print (Table.distinct table ~keys:[ `Name "seq" ] ~keep:`First);
+  [%expect {|
+    1 a 0
+    2 null 1
+    3 b 3 |}];
+  print (Table.distinct table ~keys:[ `Name "seq" ] ~keep:`Last);
+  [%expect {|
+    3 b 3
+    2 null 4
+    1 c 5 |}];
+  print (Table.distinct table ~keys:[ `Name "seq"; `Index 1 ] ~keep:`Last);
+  [%expect {|
+    1 a 2
+    3 b 3
+    2 null 4
+    1 c 5 |}];
+  Stdio.printf "%d\n" (Table.distinct table ~keep:`First |> Table.num_rows);
+  [%expect {| 6 |}];
+  let num_rows = 1_000_000 in
+  let seq = Array.init num_rows ~f:(fun i -> i % 300_000) in
+  let table = Table.create [ Table.col seq Int ~name:"seq" ] in
+  let table = Table.concatenate [ table; Table.slice table ~offset:0 ~length:1000 ] in
+  let distinct = Table.distinct table ~keep:`First in
+  let seq = Table.read distinct Int ~column:(`Name "seq") in
+  Stdio.printf
+    "%d %b\n"
+    (Array.length seq)
+    (Array.for_alli seq ~f:(fun i s -> s = i));
+  [%expect {| 300000 true |}]
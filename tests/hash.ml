@@ -0,0 +1,61 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let num_rows = 200_000 in
+  let syms = Array.init num_rows ~f:(fun i -> Printf.sprintf "S%d" (i % 37)) in
+  let venues = Array.init num_rows ~f:(fun i -> if i % 5 = 0 then None else Some (i % 3)) in
+  let table =
+    Table.create
+      [ Table.col syms Utf8 ~name:"sym"
+      ; Table.col_opt venues Int ~name:"venue"
+      ; Table.col (Array.init num_rows ~f:Fn.id) Int ~name:"x"
+      ]
+  in
+  let table = Table.concatenate [ table; table ] in
+  let hashes = Table.hash_rows table [ `Name "sym"; `Name "venue" ] in
+  let by_key = Hashtbl.create (module String) in
+  Array.iteri syms ~f:(fun i sym ->
+      let key = Printf.sprintf "%s/%s" sym ([%sexp_of: int option] venues.(i) |> Sexp.to_string) in
+      Hashtbl.add_multi by_key ~key ~data:hashes.{i};
+      Hashtbl.add_multi by_key ~key ~data:hashes.{num_rows + i});
+  let distinct_hashes =
+    Hashtbl.data by_key
+    |> List.map ~f:(fun hashes -> List.dedup_and_sort hashes ~compare:Int64.compare)
+  in
+  Stdio.printf
+    "keys %d, one hash per key %b, distinct hashes %d\n"
+    (Hashtbl.length by_key)
+    (List.for_all distinct_hashes ~f:(fun hashes -> List.length hashes = 1))
+    (List.concat distinct_hashes |> List.dedup_and_sort ~compare:Int64.compare |> List.length);
+  let column_order = Table.hash_rows table [ `Name "venue"; `Name "sym" ] in
+  Stdio.printf "column order matters %b\n" (Int64.( <> ) column_order.{1} hashes.{1});
+  let partitions = Table.partition_by_hash table [ `Index 0; `Index 1 ] ~n:4 in
+  let sizes = Array.map partitions ~f:Table.num_rows in
+  Stdio.printf
+    "rows %d, non empty %b\n"
+    (Array.sum (module Int) sizes ~f:Fn.id)
+    (Array.for_all sizes ~f:(fun size -> size > 0));
+  let keys_per_partition =
+    Array.map partitions ~f:(fun table ->
+        let syms = Table.read table Utf8 ~column:(`Name "sym") in
+        let venues = Table.read_opt table Int ~column:(`Name "venue") in
+        Array.mapi syms ~f:(fun i sym -> sym, venues.(i))
+        |> Array.to_list
+        |> List.dedup_and_sort ~compare:[%compare: string * int option])
+  in
+  let all_keys = Array.to_list keys_per_partition |> List.concat in
+  Stdio.printf
+    "keys in a single partition %b\n"
+    (List.length all_keys = Hashtbl.length by_key);
+  let xs = Table.read partitions.(0) Int ~column:(`Name "x") in
+  Stdio.printf
+    "order kept %b\n"
+    (Array.is_sorted (Array.sub xs ~pos:0 ~len:(Array.length xs / 2)) ~compare:Int.compare);
+  [%expect
+    {|
+    keys 148, one hash per key true, distinct hashes 148
+    column order matters true
+    rows 400000, non empty true
+    keys in a single partition true
+    order kept true |}]
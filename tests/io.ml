@@ -0,0 +1,65 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col (Array.init 100_000 ~f:Fn.id) Int ~name:"x"
+      ; Table.col (Array.init 100_000 ~f:(Printf.sprintf "v%d")) Utf8 ~name:"y"
+      ]
+  in
+  List.iter [ ".parquet"; ".feather"; ".csv"; ".arrows" ] ~f:(fun suffix ->
+      let filename = Caml.Filename.temp_file "test" suffix in
+      Exn.protect
+        ~f:(fun () ->
+          (match suffix with
+          | ".parquet" -> Table.write_parquet table filename ~chunk_size:10_000
+          | ".feather" -> Table.write_feather table filename
+          | ".csv" -> Table.write_csv table filename
+          | _ ->
+            let writer = Ipc_stream.create filename in
+            Ipc_stream.append writer table;
+            Ipc_stream.close writer);
+          List.iter [ `Pread; `Mmap; `Uring; `Direct ] ~f:(fun io ->
+              let table = File_reader.table filename ~io in
+              let ys = Table.read table Utf8 ~column:(`Name "y") in
+              Stdio.printf "%d %s %s\n" (Table.num_rows table) ys.(0) ys.(99_999));
+          if String.equal suffix ".parquet"
+          then
+            Parquet_reader.fold_batches
+              filename
+              ~io:`Uring
+              ~batch_size:30_000
+              ~init:0
+              ~f:(fun acc table -> acc + Table.num_rows table)
+            |> Stdio.printf "%d\n")
+        ~finally:(fun () -> Caml.Sys.remove filename));
+  [%expect
+    {|
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999
+    100000 v0 v99999 |}]
+
+let%expect_test _ =
+  (try
+     let (_ : Parquet_reader.t) =
+       Parquet_reader.create "unused.parquet" ~mmap:true ~io:`Uring
+     in
+     ()
+   with
+  | exn -> Stdio.printf "%s\n%!" (Exn.to_string exn));
+  [%expect {| (Invalid_argument "Parquet_reader.create: ~mmap:true conflicts with ~io") |}]
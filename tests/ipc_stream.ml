@@ -0,0 +1,56 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let filename = Caml.Filename.temp_file "test" ".arrows" in
+  let truncated = Caml.Filename.temp_file "test" ".arrows" in
+  Exn.protect
+    ~f:(fun () ->
+      let table offset =
+        Table.create
+          [ Table.col (Array.init 3 ~f:(fun i -> offset + i)) Int ~name:"x"
+          ; Table.col (Array.init 3 ~f:(fun i -> Int.to_string (offset + i))) Utf8 ~name:"y"
+          ]
+      in
+      let print filename =
+        let table = Ipc_stream.read filename in
+        let x = Table.read table Int ~column:(`Name "x") in
+        Stdio.printf
+          "%d rows: %s\n%!"
+          (Table.num_rows table)
+          ([%sexp_of: int array] x |> Sexp.to_string)
+      in
+      let writer = Ipc_stream.create ~fsync:`on_flush filename in
+      Ipc_stream.append writer (table 0);
+      Ipc_stream.append writer (table 10);
+      Ipc_stream.flush writer;
+      print filename;
+      [%expect {| 6 rows: (0 1 2 10 11 12) |}];
+      Ipc_stream.append writer (table 20);
+      (* Simulate a crash in the middle of writing the last batch. *)
+      let data = In_channel.read_all filename in
+      Out_channel.write_all truncated ~data:(String.drop_suffix data 10);
+      print truncated;
+      [%expect {| 6 rows: (0 1 2 10 11 12) |}];
+      Ipc_stream.close writer;
+      print filename;
+      [%expect {| 9 rows: (0 1 2 10 11 12 20 21 22) |}];
+      File_reader.table filename |> Table.num_rows |> Stdio.printf "%d\n";
+      [%expect {| 9 |}])
+    ~finally:(fun () ->
+      Caml.Sys.remove filename;
+      Caml.Sys.remove truncated)
+
+let%expect_test _ =
+  let filename = Caml.Filename.temp_file "test" ".arrows" in
+  Exn.protect
+    ~f:(fun () ->
+      let writer = Ipc_stream.create filename in
+      let table = Ipc_stream.read filename in
+      Stdio.printf
+        "%d rows, %d columns\n%!"
+        (Table.num_rows table)
+        (List.length (Table.schema table).children);
+      Ipc_stream.close writer)
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect {| 0 rows, 0 columns |}]
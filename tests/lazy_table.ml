@@ -0,0 +1,48 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col (Array.init 10 ~f:Fn.id) Int ~name:"x"
+      ; Table.col (Array.init 10 ~f:(Printf.sprintf "v%d")) Utf8 ~name:"y"
+      ; Table.col (Array.init 10 ~f:Float.of_int) Float ~name:"z"
+      ]
+  in
+  List.iter [ ".parquet"; ".feather" ] ~f:(fun suffix ->
+      let filename = Caml.Filename.temp_file "test" suffix in
+      Exn.protect
+        ~f:(fun () ->
+          if String.equal suffix ".parquet"
+          then Table.write_parquet table filename ~chunk_size:3
+          else Table.write_feather table filename;
+          let t = Lazy_table.create filename in
+          let names = List.map (Lazy_table.schema t).children ~f:(fun s -> s.Schema.name) in
+          Stdio.printf "%s %d\n" (String.concat names ~sep:",") (Lazy_table.num_rows t);
+          Lazy_table.read t Utf8 ~column:(`Name "y") ~offset:4 ~length:4
+          |> [%sexp_of: string array]
+          |> Sexp.to_string
+          |> print_endline;
+          Lazy_table.read t Utf8 ~column:(`Name "y")
+          |> [%sexp_of: string array]
+          |> Sexp.to_string
+          |> print_endline;
+          Lazy_table.fast_read t (`Index 0) ~offset:8
+          |> [%sexp_of: Column.t]
+          |> Sexp.to_string
+          |> print_endline;
+          let table = Lazy_table.to_table t in
+          Stdio.printf "%d %d\n" (Table.num_rows table) (List.length (Table.schema table).children))
+        ~finally:(fun () -> Caml.Sys.remove filename));
+  [%expect
+    {|
+    x,y,z 10
+    (v4 v5 v6 v7)
+    (v0 v1 v2 v3 v4 v5 v6 v7 v8 v9)
+    (Int64(8 9))
+    10 3
+    x,y,z 10
+    (v4 v5 v6 v7)
+    (v0 v1 v2 v3 v4 v5 v6 v7 v8 v9)
+    (Int64(8 9))
+    10 3 |}]
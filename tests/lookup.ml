@@ -0,0 +1,150 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      let table =
+        Table.create
+          [ Table.col (Array.init 10 ~f:(fun i -> i * 10)) Int ~name:"id"
+          ; Table.col (Array.init 10 ~f:(Printf.sprintf "sym%d")) Utf8 ~name:"sym"
+          ; Table.col (Array.init 10 ~f:Float.of_int) Float ~name:"px"
+          ]
+      in
+      Table.write_parquet
+        table
+        filename
+        ~chunk_size:3
+        ~bloom_filter_columns:[ "id"; "sym" ];
+      let print table =
+        let id = Table.read table Int ~column:(`Name "id") in
+        let sym = Table.read table Utf8 ~column:(`Name "sym") in
+        Array.iteri id ~f:(fun i id -> Stdio.printf "%d %s\n" id sym.(i));
+        Stdio.printf "--\n%!"
+      in
+      Parquet_reader.lookup filename ~column:"id" ~values:(`ints [ 30; 35; 90 ]) |> print;
+      Parquet_reader.lookup filename ~column:"sym" ~values:(`strings [ "sym7"; "sym12" ])
+      |> print;
+      let schema =
+        Parquet_reader.lookup
+          filename
+          ~column:"sym"
+          ~values:(`strings [ "sym1"; "sym8" ])
+          ~column_idxs:[ 0 ]
+        |> Table.schema
+      in
+      List.iter schema.children ~f:(fun { name; _ } -> Stdio.printf "%s\n%!" name);
+      Parquet_reader.lookup filename ~column:"id" ~values:(`ints [ 1000 ])
+      |> Table.num_rows
+      |> Stdio.printf "%d\n%!")
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect
+    {|
+    30 sym3
+    90 sym9
+    --
+    70 sym7
+    --
+    id
+    0 |}]
+
+(* Parquet has no second unit, timestamp[s] columns are stored as milliseconds
+   while lookup values are given in the unit of the arrow column. *)
+let%expect_test _ =
+  let src = Caml.Filename.temp_file "test" ".csv" in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      List.init 10 ~f:(fun i -> Printf.sprintf "1970-01-01 00:00:%02d,%d" (i * 5) i)
+      |> List.cons "ts,x"
+      |> Out_channel.write_lines src;
+      let (_ : Convert.stats) =
+        Convert.csv_to_parquet
+          ~schema:[ "ts", Timestamp { precision = `seconds; timezone = "" }; "x", Int64 ]
+          ~row_group_rows:4
+          ~src
+          ~dst:filename
+          ()
+      in
+      let unit_ns =
+        match (Parquet_reader.schema filename).children with
+        | { Schema.format = Timestamp { precision; timezone = _ }; _ } :: _ ->
+          (match precision with
+          | `seconds -> 1_000_000_000
+          | `milliseconds -> 1_000_000
+          | `microseconds -> 1_000
+          | `nanoseconds -> 1)
+        | _ -> failwith "unexpected schema"
+      in
+      let values = List.map [ 15; 40 ] ~f:(fun sec -> sec * 1_000_000_000 / unit_ns) in
+      let table = Parquet_reader.lookup filename ~column:"ts" ~values:(`ints values) in
+      Table.read table Int ~column:(`Name "x")
+      |> Array.iter ~f:(Stdio.printf "%d\n%!"))
+    ~finally:(fun () ->
+      Caml.Sys.remove src;
+      Caml.Sys.remove filename);
+  [%expect {|
+    3
+    8 |}]
+
+(* The bloom filters hash values in the unit parquet stores, not in the one of
+   the written table: timestamp[s] columns are stored as milliseconds and date64
+   ones as days, and read back as such. *)
+let%expect_test _ =
+  let src = Caml.Filename.temp_file "test" ".csv" in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      List.init 10 ~f:(fun i ->
+          Printf.sprintf "1970-01-01 00:00:%02d,1970-01-%02d,%d" (i * 5) (i + 1) i)
+      |> List.cons "ts,d,x"
+      |> Out_channel.write_lines src;
+      let table =
+        Table.read_csv
+          src
+          ~schema:
+            [ "ts", Timestamp { precision = `seconds; timezone = "" }
+            ; "d", Date64 `milliseconds
+            ; "x", Int64
+            ]
+      in
+      Table.write_parquet table filename ~chunk_size:4 ~bloom_filter_columns:[ "ts"; "d" ];
+      let format name =
+        List.find_map_exn
+          (Parquet_reader.schema filename).children
+          ~f:(fun { Schema.name = field_name; format; _ } ->
+            Option.some_if (String.equal field_name name) format)
+      in
+      let ts_values =
+        let unit_ns =
+          match format "ts" with
+          | Timestamp { precision = `seconds; _ } -> 1_000_000_000
+          | Timestamp { precision = `milliseconds; _ } -> 1_000_000
+          | Timestamp { precision = `microseconds; _ } -> 1_000
+          | Timestamp { precision = `nanoseconds; _ } -> 1
+          | _ -> failwith "unexpected ts type"
+        in
+        List.map [ 15; 40 ] ~f:(fun sec -> sec * 1_000_000_000 / unit_ns)
+      in
+      let d_values =
+        let unit_per_day =
+          match format "d" with
+          | Date32 `days -> 1
+          | Date64 `milliseconds -> 86_400_000
+          | _ -> failwith "unexpected d type"
+        in
+        List.map [ 2; 7 ] ~f:(fun day -> day * unit_per_day)
+      in
+      List.iter [ "ts", ts_values; "d", d_values ] ~f:(fun (column, values) ->
+          let table = Parquet_reader.lookup filename ~column ~values:(`ints values) in
+          Table.read table Int ~column:(`Name "x")
+          |> Array.iter ~f:(Stdio.printf "%s %d\n%!" column)))
+    ~finally:(fun () ->
+      Caml.Sys.remove src;
+      Caml.Sys.remove filename);
+  [%expect {|
+    ts 3
+    ts 8
+    d 2
+    d 7 |}]
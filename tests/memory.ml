@@ -0,0 +1,58 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let num_rows = 1_000_000 in
+  let table =
+    Table.create
+      [ Table.col (Array.init num_rows ~f:Fn.id) Int ~name:"x"
+      ; Table.col (Array.init num_rows ~f:Float.of_int) Float ~name:"y"
+      ]
+  in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Table.write_parquet table filename;
+      List.iter [ 0; 1 ] ~f:(fun threshold ->
+          Memory.set_huge_page_threshold threshold;
+          let huge_page_allocations = Memory.huge_page_allocations () in
+          let table = Parquet_reader.table filename in
+          let xs = Table.read table Int ~column:(`Name "x") in
+          let sum = Array.fold xs ~init:0 ~f:( + ) in
+          (match Column.fast_read table 1 with
+          | Double ys ->
+            Stdio.printf "%d %d %.0f\n" (Array.length xs) sum ys.{num_rows - 1}
+          | _ -> assert false);
+          Stdio.printf
+            "%b %b\n"
+            (Memory.bytes_allocated () > 0)
+            (Memory.huge_page_allocations () > huge_page_allocations));
+      Memory.disable_huge_pages ())
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect
+    {|
+    1000000 499999500000 999999
+    true false
+    1000000 499999500000 999999
+    true true |}]
+
+(* The threshold is rounded up to the 2MiB huge page size, bigarrays get huge
+   pages from the threshold on. *)
+let%expect_test _ =
+  Exn.protect
+    ~f:(fun () ->
+      Memory.set_huge_page_threshold ((3 lsl 20) + 1);
+      List.iter [ (4 lsl 20) - 8; 4 lsl 20; 8 lsl 20 ] ~f:(fun bytes ->
+          let huge_page_allocations = Memory.huge_page_allocations () in
+          let ba = Memory.bigarray_create Bigarray.float64 (bytes / 8) in
+          Bigarray.Array1.fill ba 1.;
+          Stdio.printf
+            "%d %d %.0f\n"
+            bytes
+            (Memory.huge_page_allocations () - huge_page_allocations)
+            ba.{Bigarray.Array1.dim ba - 1}))
+    ~finally:Memory.disable_huge_pages;
+  [%expect {|
+    4194296 0 1
+    4194304 1 1
+    8388608 1 1 |}]
@@ -0,0 +1,76 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col (Array.init 100_000 ~f:Fn.id) Int ~name:"x"
+      ; Table.col
+          (Array.init 100_000 ~f:(fun i -> Printf.sprintf "v%d" (i % 7)))
+          Utf8
+          ~name:"y"
+      ]
+  in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Table.write_parquet table filename;
+      let first_and_count table =
+        let xs = Table.read table Int ~column:(`Name "x") in
+        let matches = Column.utf8_equal table ~column:(`Name "y") ~value:"v3" in
+        xs.(0), Valid.num_true matches
+      in
+      let serial =
+        Parquet_reader.fold_batches
+          filename
+          ~batch_size:7_000
+          ~init:[]
+          ~f:(fun acc table -> first_and_count table :: acc)
+        |> List.rev
+      in
+      List.iter [ 1; 4 ] ~f:(fun num_threads ->
+          List.iter [ true; false ] ~f:(fun ordered ->
+              let parallel =
+                Parquet_reader.parallel_map_batches
+                  filename
+                  ~batch_size:7_000
+                  ~ordered
+                  ~max_in_flight:3
+                  ~num_threads
+                  ~f:first_and_count
+                  ~init:[]
+                  ~reduce:(fun acc result -> result :: acc)
+                |> List.rev
+              in
+              let parallel =
+                if ordered
+                then parallel
+                else List.sort parallel ~compare:[%compare: int * int]
+              in
+              Stdio.printf
+                "%d %b %d %b\n"
+                num_threads
+                ordered
+                (List.length parallel)
+                ([%compare.equal: (int * int) list] serial parallel)));
+      match
+        Parquet_reader.parallel_map_batches
+          filename
+          ~batch_size:7_000
+          ~num_threads:4
+          ~f:(fun table ->
+            let xs = Table.read table Int ~column:(`Name "x") in
+            if xs.(0) > 50_000 then failwith "boom")
+          ~init:()
+          ~reduce:(fun () () -> ())
+      with
+      | () -> ()
+      | exception exn -> Stdio.print_s [%sexp (exn : exn)])
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect
+    {|
+    1 true 15 true
+    1 false 15 true
+    4 true 15 true
+    4 false 15 true
+    (Failure boom) |}]
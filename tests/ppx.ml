@@ -291,3 +291,116 @@ module Test6 = struct
     ((p 19)(is_prime true)(is_prime_opt(true))(largest_prime()))
     ((p 20)(is_prime false)(is_prime_opt())(largest_prime(5))) |}]
 end
+
+module Test7 = struct
+  module Side = struct
+    type t =
+      | Buy
+      | Sell
+      | Short
+    [@@deriving arrow, sexp_of]
+  end
+
+  type t =
+    { x : int
+    ; side : Side.t [@arrow.enum]
+    ; prev_side : Side.t option [@arrow.enum]
+    }
+  [@@deriving arrow, sexp_of]
+
+  let%expect_test _ =
+    let ts =
+      [| { x = 1; side = Buy; prev_side = None }
+       ; { x = 2; side = Sell; prev_side = Some Buy }
+       ; { x = 3; side = Short; prev_side = Some Short }
+      |]
+    in
+    let filename = "/tmp/abc.parquet" in
+    arrow_write_t ts filename;
+    let ts = arrow_read_t filename in
+    Array.iter ts ~f:(fun t ->
+        sexp_of_t t |> Sexp.to_string_mach |> Stdio.printf "%s\n%!");
+    [%expect
+      {|
+    ((x 1)(side Buy)(prev_side()))
+    ((x 2)(side Sell)(prev_side(Buy)))
+    ((x 3)(side Short)(prev_side(Short))) |}];
+    let table = arrow_table_of_t ts in
+    let codes = Arrow_c_api.Column.read_i8_ba table ~column:(`Name "side") in
+    let prev_codes, valid =
+      Arrow_c_api.Column.read_i8_ba_opt table ~column:(`Name "prev_side")
+    in
+    for idx = 0 to Bigarray.Array1.dim codes - 1 do
+      let prev_code =
+        if Arrow_c_api.Valid.get valid idx then Int.to_string prev_codes.{idx} else "-"
+      in
+      Stdio.printf "%d %s\n%!" codes.{idx} prev_code
+    done;
+    [%expect {|
+      0 -
+      1 0
+      2 2 |}];
+    (match Side.arrow_t_of_code 3 with
+    | side -> Stdio.printf "unexpected %s\n" (Side.sexp_of_t side |> Sexp.to_string)
+    | exception exn -> Stdio.printf "%s\n" (Exn.to_string exn));
+    [%expect {| (Failure "ppx_arrow: invalid code 3 for type t") |}]
+end
+
+module Test8 = struct
+  module Price = struct
+    type t =
+      { px : float
+      ; size : int
+      }
+    [@@deriving arrow, sexp_of]
+  end
+
+  module Quote = struct
+    type t =
+      { bid : Price.t [@arrow.nested]
+      ; ask : Price.t option [@arrow.nested]
+      ; venue : string option
+      }
+    [@@deriving arrow, sexp_of]
+  end
+
+  type t =
+    { id : int
+    ; quote : Quote.t [@arrow.nested]
+    ; last : Price.t option [@arrow.nested]
+    }
+  [@@deriving arrow, sexp_of]
+
+  let%expect_test _ =
+    arrow_t_columns ~prefix:"" |> String.concat ~sep:" " |> Stdio.printf "%s\n%!";
+    [%expect
+      {| id quote_bid_px quote_bid_size quote_ask quote_ask_px quote_ask_size quote_venue last last_px last_size |}];
+    let ts =
+      [| { id = 1
+         ; quote =
+             { bid = { px = 99.5; size = 10 }
+             ; ask = Some { px = 100.5; size = 20 }
+             ; venue = Some "X"
+             }
+         ; last = None
+         }
+       ; { id = 2
+         ; quote = { bid = { px = 98.; size = 5 }; ask = None; venue = None }
+         ; last = Some { px = 98.5; size = 1 }
+         }
+      |]
+    in
+    let filename = "/tmp/abc.parquet" in
+    arrow_write_t ts filename;
+    let ts = arrow_read_t filename in
+    Array.iter ts ~f:(fun t ->
+        sexp_of_t t |> Sexp.to_string_mach |> Stdio.printf "%s\n%!");
+    [%expect
+      {|
+    ((id 1)(quote((bid((px 99.5)(size 10)))(ask(((px 100.5)(size 20))))(venue(X))))(last()))
+    ((id 2)(quote((bid((px 98)(size 5)))(ask())(venue())))(last(((px 98.5)(size 1))))) |}];
+    let table = arrow_table_of_t ts in
+    let quote = Quote.arrow_t_getter table ~prefix:"quote_" in
+    Quote.sexp_of_t (quote 0) |> Sexp.to_string_mach |> Stdio.printf "%s\n%!";
+    [%expect {| ((bid((px 99.5)(size 10)))(ask(((px 100.5)(size 20))))(venue(X))) |}]
+end
@@ -0,0 +1,60 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let start = Time_ns.of_string "2021-03-01 14:30:00Z" in
+  let batch ~offset syms xs =
+    Table.create
+      [ Table.col syms Utf8 ~name:"sym"
+      ; Table.col_opt xs Int ~name:"x"
+      ; Table.col
+          (Array.init (Array.length syms) ~f:(fun i ->
+               Time_ns.add start (Time_ns.Span.of_int_sec (offset + i))))
+          Time_ns
+          ~name:"time"
+      ]
+  in
+  let batches =
+    [ batch ~offset:0 [| "a"; "b" |] [| Some 1; None |]
+    ; batch ~offset:2 [| "c"; "d"; "e" |] [| Some 3; Some 4; None |]
+    ]
+  in
+  let schema = Table.schema (List.hd_exn batches) in
+  let sym = Column.prepare schema (`Name "sym") Utf8 in
+  let x = Column.prepare schema (`Name "x") Int_opt in
+  let time = Column.prepare schema (`Name "time") Time_ns in
+  Stdio.printf
+    "%d %d %d\n"
+    (Column.column_index sym)
+    (Column.column_index x)
+    (Column.column_index time);
+  [%expect {| 0 1 2 |}];
+  (* The accessors apply to any batch with the same schema. *)
+  List.iter batches ~f:(fun batch ->
+      let seconds =
+        Column.read time batch
+        |> Array.map ~f:(fun time -> Time_ns.diff time start |> Time_ns.Span.to_int_sec)
+      in
+      Stdio.printf
+        "%b %s\n"
+        (Table.schema_fingerprint batch
+        = Table.schema_fingerprint (List.hd_exn batches))
+        ([%sexp_of: string array * int option array * int array]
+           (Column.read sym batch, Column.read x batch, seconds)
+        |> Sexp.to_string));
+  [%expect {|
+    true ((a b)((1)())(0 1))
+    true ((c d e)((3)(4)())(2 3 4)) |}];
+  let other = Table.create [ Table.col [| 1.5 |] Float ~name:"sym" ] in
+  Stdio.printf
+    "%b\n"
+    (Table.schema_fingerprint other = Table.schema_fingerprint (List.hd_exn batches));
+  [%expect {| false |}];
+  (match Column.prepare schema (`Name "sym") Float with
+  | _ -> ()
+  | exception exn -> Stdio.print_s [%sexp (exn : exn)]);
+  [%expect {| (Failure "unexpected type Utf8_string for column sym") |}];
+  (match Column.prepare schema (`Name "y") Int with
+  | _ -> ()
+  | exception exn -> Stdio.print_s [%sexp (exn : exn)]);
+  [%expect {| (Failure "cannot find column y") |}]
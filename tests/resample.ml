@@ -0,0 +1,180 @@
+open Core_kernel
+open Arrow_c_api
+
+let start = Time_ns.of_string "2021-03-01 14:30:00Z"
+let time seconds = Time_ns.add start (Time_ns.Span.of_int_sec seconds)
+
+let bars table =
+  let sym = Table.read table Utf8 ~column:(`Name "sym") in
+  let time = Table.read table Time_ns ~column:(`Name "time") in
+  let volume = Table.read table Float ~column:(`Name "volume") in
+  let count = Table.read table Int ~column:(`Name "count") in
+  Array.mapi sym ~f:(fun i sym ->
+      sym, Time_ns.diff time.(i) start |> Time_ns.Span.to_int_sec, volume.(i), count.(i))
+
+let aggs =
+  [ "open", `First (`Name "px")
+  ; "high", `Max (`Name "px")
+  ; "low", `Min (`Name "px")
+  ; "close", `Last (`Name "px")
+  ; "volume", `Sum (`Name "size")
+  ; "vwap", `Vwap (`Name "px", `Name "size")
+  ; "count", `Count (`Name "px")
+  ]
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col [| "a"; "b"; "a"; "a"; "b"; "a"; "a" |] Utf8 ~name:"sym"
+      ; Table.col (Array.map [| 0; 5; 30; 59; 61; 65; 125 |] ~f:time) Time_ns ~name:"time"
+      ; Table.col [| 10.; 20.; 12.; 11.; 21.; 13.; 9. |] Float ~name:"px"
+      ; Table.col [| 1.; 2.; 3.; 1.; 1.; 2.; 4. |] Float ~name:"size"
+      ]
+  in
+  let resampled =
+    Table.resample
+      table
+      ~by:[ `Name "sym" ]
+      ~time:(`Name "time")
+      ~every:(Time_ns.Span.of_int_sec 60)
+      ~aggs
+  in
+  let column name = Table.read resampled Float ~column:(`Name name) in
+  let open_ = column "open" in
+  let high = column "high" in
+  let low = column "low" in
+  let close = column "close" in
+  let vwap = column "vwap" in
+  Array.iteri (bars resampled) ~f:(fun i (sym, time, volume, count) ->
+      Stdio.printf
+        "%s %d %.1f %.1f %.1f %.1f %.1f %.1f %d\n"
+        sym
+        time
+        open_.(i)
+        high.(i)
+        low.(i)
+        close.(i)
+        volume
+        vwap.(i)
+        count);
+  [%expect
+    {|
+    a 0 10.0 12.0 10.0 11.0 5.0 11.4 3
+    b 0 20.0 20.0 20.0 20.0 2.0 20.0 1
+    a 60 13.0 13.0 13.0 13.0 2.0 13.0 1
+    b 60 21.0 21.0 21.0 21.0 1.0 21.0 1
+    a 120 9.0 9.0 9.0 9.0 4.0 9.0 1 |}]
+
+let%expect_test _ =
+  let num_rows = 100_000 in
+  let table =
+    Table.create
+      [ Table.col
+          (Array.init num_rows ~f:(fun i -> Printf.sprintf "s%d" (i % 7)))
+          Utf8
+          ~name:"sym"
+      ; Table.col (Array.init num_rows ~f:(fun i -> time (i / 3))) Time_ns ~name:"time"
+      ; Table.col (Array.init num_rows ~f:(fun i -> Float.of_int (i % 13))) Float ~name:"px"
+      ; Table.col (Array.init num_rows ~f:(fun i -> Float.of_int (i % 5))) Float ~name:"size"
+      ]
+  in
+  let every = Time_ns.Span.of_int_sec 10 in
+  let expected =
+    Table.resample table ~by:[ `Name "sym" ] ~time:(`Name "time") ~every ~aggs |> bars
+  in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Table.write_parquet table filename ~chunk_size:7_777;
+      let resampler =
+        Resampler.create ~by:[ `Name "sym" ] ~time:(`Name "time") ~every ~aggs ()
+      in
+      let streamed = ref [] in
+      Parquet_reader.resample
+        filename
+        ~batch_size:1_000
+        ~resampler
+        ~f:(fun bars -> streamed := bars :: !streamed);
+      let streamed = Table.concatenate (List.rev !streamed) |> bars in
+      let sort = Array.sorted_copy ~compare:[%compare: string * int * float * int] in
+      Stdio.printf
+        "%d %b\n"
+        (Array.length expected)
+        ([%compare.equal: (string * int * float * int) array] (sort expected) (sort streamed)))
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect {| 23338 true |}]
+
+(* Daily bars follow the local days of the zone, a failed push leaves the
+   resampler as it was. *)
+let%expect_test _ =
+  let zone = Time.Zone.of_utc_offset ~hours:(-5) in
+  let midnight = Time_ns.of_string "2021-03-01 00:00:00Z" in
+  let table times =
+    Table.create
+      [ Table.col
+          (Array.map times ~f:(fun hours ->
+               Time_ns.add midnight (Time_ns.Span.of_min (60. *. hours))))
+          Time_ns
+          ~name:"time"
+      ; Table.col (Array.map times ~f:(fun _ -> 1.)) Float ~name:"px"
+      ]
+  in
+  let print bars =
+    let time = Table.read bars Time_ns ~column:(`Name "time") in
+    let count = Table.read bars Int ~column:(`Name "count") in
+    Array.iteri time ~f:(fun i time ->
+        Stdio.printf
+          "%d %d\n"
+          (Time_ns.diff time midnight |> Time_ns.Span.to_int_sec |> fun s -> s / 3600)
+          count.(i))
+  in
+  let every = Time_ns.Span.of_day 1. in
+  let aggs = [ "count", `Count (`Name "px") ] in
+  Table.resample (table [| 4.; 6.; 28.5; 29.5 |]) ~zone ~time:(`Name "time") ~every ~aggs
+  |> print;
+  [%expect {|
+    -19 1
+    5 2
+    29 1 |}];
+  let resampler = Resampler.create ~zone ~time:(`Name "time") ~every ~aggs () in
+  Resampler.push resampler (table [| 4.; 6. |]) |> print;
+  [%expect {| -19 1 |}];
+  (try
+     let _bars = Resampler.push resampler (table [| 34.; 3. |]) in
+     ()
+   with
+  | exn -> Stdio.printf "%s\n%!" (Exn.to_string exn));
+  [%expect {| (Failure "rows are not sorted by time at row 1") |}];
+  Resampler.push resampler (table [| 28.5; 29.5 |]) |> print;
+  [%expect {| 5 2 |}];
+  Resampler.finish resampler |> print;
+  [%expect {| 29 1 |}]
+
+(* Bars where all the values are null give null sums, as the other
+   aggregations, and a zero count. *)
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col (Array.map [| 0; 30; 65; 70 |] ~f:time) Time_ns ~name:"time"
+      ; Table.col_opt [| Some 1.; Some 2.; None; None |] Float ~name:"size"
+      ]
+  in
+  let resampled =
+    Table.resample
+      table
+      ~time:(`Name "time")
+      ~every:(Time_ns.Span.of_int_sec 60)
+      ~aggs:
+        [ "volume", `Sum (`Name "size")
+        ; "high", `Max (`Name "size")
+        ; "count", `Count (`Name "size")
+        ]
+  in
+  let volume = Table.read_opt resampled ~column:(`Name "volume") Float in
+  let high = Table.read_opt resampled ~column:(`Name "high") Float in
+  let count = Table.read resampled ~column:(`Name "count") Int in
+  Stdio.printf
+    "%s\n"
+    ([%sexp_of: float option array * float option array * int array] (volume, high, count)
+    |> Sexp.to_string);
+  [%expect {| (((3)())((2)())(2 0)) |}]
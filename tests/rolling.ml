@@ -0,0 +1,85 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let start = Time_ns.of_string "2021-03-01 14:30:00Z" in
+  let time seconds = Time_ns.add start (Time_ns.Span.of_int_sec seconds) in
+  let table =
+    Table.create
+      [ Table.col [| "a"; "b"; "a"; "a"; "b"; "a" |] Utf8 ~name:"sym"
+      ; Table.col (Array.map [| 0; 1; 2; 4; 6; 7 |] ~f:time) Time_ns ~name:"time"
+      ; Table.col_opt [| Some 1.; Some 10.; Some 3.; None; Some 20.; Some 5. |] Float ~name:"px"
+      ]
+  in
+  let rolled =
+    Table.rolling
+      table
+      ~by:[ `Name "sym" ]
+      ~time:(`Name "time")
+      ~window:(Time_ns.Span.of_int_sec 5)
+      ~aggs:
+        [ "sum", `Sum (`Name "px")
+        ; "mean", `Mean (`Name "px")
+        ; "max", `Max (`Name "px")
+        ; "count", `Count (`Name "px")
+        ]
+  in
+  let sym = Table.read rolled Utf8 ~column:(`Name "sym") in
+  let sum = Table.read rolled Float ~column:(`Name "sum") in
+  let mean = Table.read rolled Float ~column:(`Name "mean") in
+  let max = Table.read rolled Float ~column:(`Name "max") in
+  let count = Table.read rolled Int ~column:(`Name "count") in
+  Array.iteri sym ~f:(fun i sym ->
+      Stdio.printf "%s %.1f %.1f %.1f %d\n" sym sum.(i) mean.(i) max.(i) count.(i));
+  [%expect
+    {|
+    a 1.0 1.0 1.0 1
+    b 10.0 10.0 10.0 1
+    a 4.0 2.0 3.0 2
+    a 4.0 2.0 3.0 2
+    b 20.0 20.0 20.0 1
+    a 5.0 5.0 5.0 1 |}];
+  let min =
+    Table.rolling
+      table
+      ~time:(`Name "time")
+      ~window:(Time_ns.Span.of_int_sec 3)
+      ~aggs:[ "min", `Min (`Name "px") ]
+    |> Table.read_opt ~column:(`Name "min") Float
+  in
+  [%sexp_of: float option array] min |> Sexp.to_string |> Stdio.print_endline;
+  [%expect {| ((1)(1)(1)(3)(20)(5)) |}];
+  let unsorted = Table.concatenate [ Table.slice table ~offset:3 ~length:3; table ] in
+  (try
+     let _table =
+       Table.rolling
+         unsorted
+         ~time:(`Name "time")
+         ~window:(Time_ns.Span.of_int_sec 5)
+         ~aggs:[ "sum", `Sum (`Name "px") ]
+     in
+     ()
+   with
+  | exn -> Stdio.printf "%s\n%!" (Exn.to_string exn));
+  [%expect {| (Failure "rows are not sorted by time at row 3") |}]
+
+(* Windows holding only nulls have no sum. *)
+let%expect_test _ =
+  let start = Time_ns.of_string "2021-03-01 14:30:00Z" in
+  let time seconds = Time_ns.add start (Time_ns.Span.of_int_sec seconds) in
+  let table =
+    Table.create
+      [ Table.col (Array.map [| 0; 10; 11; 12 |] ~f:time) Time_ns ~name:"time"
+      ; Table.col_opt [| Some 1.; None; None; Some 2. |] Float ~name:"px"
+      ]
+  in
+  Table.rolling
+    table
+    ~time:(`Name "time")
+    ~window:(Time_ns.Span.of_int_sec 5)
+    ~aggs:[ "sum", `Sum (`Name "px") ]
+  |> Table.read_opt ~column:(`Name "sum") Float
+  |> [%sexp_of: float option array]
+  |> Sexp.to_string
+  |> Stdio.print_endline;
+  [%expect {| ((1)()()(2)) |}]
@@ -0,0 +1,40 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let num_rows = 100_000 in
+  let table =
+    Table.create
+      [ Table.col (Array.init num_rows ~f:Fn.id) Int ~name:"x"
+      ; Table.col_opt
+          (Array.init num_rows ~f:(fun i -> if i % 3 = 0 then None else Some (Float.of_int i)))
+          Float
+          ~name:"y"
+      ; Table.col (Array.init num_rows ~f:(Printf.sprintf "v%d")) Utf8 ~name:"z"
+      ]
+  in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Table.write_parquet table filename ~chunk_size:7_000;
+      let expected_xs = Table.read table Int ~column:(`Name "x") in
+      let expected_ys = Table.read_opt table Float ~column:(`Name "y") in
+      List.iter [ `Columns; `Row_groups; `Both ] ~f:(fun parallelism ->
+          let table = Parquet_reader.table filename ~parallelism in
+          let xs = Table.read table Int ~column:(`Name "x") in
+          let ys = Table.read_opt table Float ~column:(`Name "y") in
+          let zs = Table.read table Utf8 ~column:(`Name "z") in
+          let only_y = Parquet_reader.table filename ~parallelism ~column_idxs:[ 1 ] in
+          Stdio.printf
+            "%d %b %b %s %d\n"
+            (Table.num_rows table)
+            ([%compare.equal: int array] xs expected_xs)
+            ([%compare.equal: float option array] ys expected_ys)
+            zs.(num_rows - 1)
+            (List.length (Table.schema only_y).children)))
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect
+    {|
+    100000 true true v99999 1
+    100000 true true v99999 1
+    100000 true true v99999 1 |}]
@@ -0,0 +1,45 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      let num_rows = 1000 in
+      let table =
+        Table.create
+          [ Table.col (Array.init num_rows ~f:Fn.id) Int ~name:"id"
+          ; Table.col
+              (Array.init num_rows ~f:(fun i -> if i % 10 = 0 then "rare" else "common"))
+              Utf8
+              ~name:"key"
+          ]
+      in
+      Table.write_parquet table filename ~chunk_size:100;
+      let print table =
+        let ids = Table.read table Int ~column:(`Name "id") in
+        let keys = Table.read table Utf8 ~column:(`Name "key") in
+        let rare = Array.count keys ~f:(String.equal "rare") in
+        let sorted = Array.is_sorted_strictly ids ~compare:Int.compare in
+        Stdio.printf "rows: %d, rare: %d, sorted: %b\n" (Array.length ids) rare sorted
+      in
+      Parquet_reader.sample filename ~fraction:0.05 ~seed:42
+      |> Table.num_rows
+      |> Stdio.printf "%d\n";
+      [%expect {| 50 |}];
+      Parquet_reader.sample filename ~fraction:0.05 ~seed:42 ~stratify_by:"key" |> print;
+      [%expect {| rows: 50, rare: 5, sorted: true |}];
+      Parquet_reader.sample_n filename ~n:20 ~stratify_by:"key" |> print;
+      [%expect {| rows: 20, rare: 2, sorted: true |}];
+      Parquet_reader.sample_n filename ~n:2000 |> print;
+      [%expect {| rows: 1000, rare: 100, sorted: true |}];
+      let same_seed =
+        let ids seed =
+          Parquet_reader.sample_n filename ~n:10 ~seed ~column_idxs:[ 0 ]
+          |> Table.read ~column:(`Name "id") Int
+        in
+        [%equal: int array] (ids 1) (ids 1)
+      in
+      Stdio.printf "deterministic: %b\n" same_seed;
+      [%expect {| deterministic: true |}])
+    ~finally:(fun () -> Caml.Sys.remove filename)
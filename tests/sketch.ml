@@ -0,0 +1,71 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let num_rows = 1_000_000 in
+  let table =
+    Table.create
+      [ Table.col_opt
+          (Array.init num_rows ~f:(fun i -> if i % 10 = 0 then None else Some (i % 100_003)))
+          Int
+          ~name:"x"
+      ; Table.col
+          (Array.init num_rows ~f:(fun i -> Printf.sprintf "s%d" (i % 5_000)))
+          Utf8
+          ~name:"s"
+      ]
+  in
+  let filename = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Table.write_parquet table filename ~chunk_size:100_000;
+      (* One sketch per batch, merged after a serialization round-trip. *)
+      let xs = Sketch.create () in
+      let ss = Sketch.create () in
+      Parquet_reader.iter_batches filename ~batch_size:250_000 ~f:(fun batch ->
+          let sketch = Sketch.create () in
+          Sketch.update_from_table sketch batch (`Name "x");
+          Sketch.merge xs (Sketch.serialize sketch |> Sketch.deserialize);
+          Sketch.update_from_table ss batch (`Name "s"));
+      let within ~expected ~tolerance value =
+        Float.( <= ) (Float.abs (value -. expected)) (tolerance *. expected)
+      in
+      Stdio.printf
+        "count %d nulls %d min %.0f max %.0f\n"
+        (Sketch.count xs)
+        (Sketch.null_count xs)
+        (Option.value_exn (Sketch.min xs))
+        (Option.value_exn (Sketch.max xs));
+      List.iter [ 0.1; 0.5; 0.9; 0.99 ] ~f:(fun q ->
+          let value = Sketch.quantile xs q |> Option.value_exn in
+          Stdio.printf "q%.2f %b\n" q (within value ~expected:(q *. 100_003.) ~tolerance:0.02));
+      Stdio.printf
+        "distinct %b %b\n"
+        (within (Sketch.distinct_count xs) ~expected:100_003. ~tolerance:0.03)
+        (within (Sketch.distinct_count ss) ~expected:5_000. ~tolerance:0.03);
+      Stdio.printf "strings %d %b\n" (Sketch.count ss) (Option.is_none (Sketch.quantile ss 0.5)))
+    ~finally:(fun () -> Caml.Sys.remove filename);
+  [%expect
+    {|
+    count 900000 nulls 100000 min 0 max 100002
+    q0.10 true
+    q0.50 true
+    q0.90 true
+    q0.99 true
+    distinct true true
+    strings 1000000 true |}]
+
+let%expect_test _ =
+  let table =
+    Table.create [ Table.col (Array.init 1_000 ~f:Float.of_int) Float ~name:"x" ]
+  in
+  let sketch = Sketch.create () in
+  Sketch.update_from_table sketch table (`Name "x");
+  Sketch.merge sketch sketch;
+  Stdio.printf
+    "count %d min %.0f max %.0f median %b\n"
+    (Sketch.count sketch)
+    (Option.value_exn (Sketch.min sketch))
+    (Option.value_exn (Sketch.max sketch))
+    (Float.( < ) (Float.abs (Option.value_exn (Sketch.quantile sketch 0.5) -. 500.)) 20.);
+  [%expect {| count 2000 min 0 max 999 median true |}]
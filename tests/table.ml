@@ -85,3 +85,72 @@ let%expect_test _ =
     v1 v2 v3 v1 v2 v3 v1 v2 v3
     w0 w1 w2 w3 w4 w5 w6 w7 w8
     v1 v2 v3 v1 v2 v3 v1 v2 v3 |}]
+
+let%expect_test _ =
+  (* Tables built from OCaml columns keep their buffers alive on their own, derived
+     tables remain valid once the original tables and columns have been collected. *)
+  let table =
+    List.init 2 ~f:(fun i ->
+        let cols =
+          [ Wrapper.Writer.int (Array.init 4 ~f:(fun j -> (10 * i) + j)) ~name:"x"
+          ; Wrapper.Writer.utf8 (Array.init 4 ~f:(Printf.sprintf "s%d-%d" i)) ~name:"s"
+          ]
+        in
+        Wrapper.Writer.create_table ~cols)
+    |> Wrapper.Table.concatenate
+  in
+  Gc.full_major ();
+  Gc.full_major ();
+  let x = Wrapper.Column.read_int table ~column:(`Name "x") in
+  let s = Wrapper.Column.read_utf8 table ~column:(`Name "s") in
+  Array.iter x ~f:(Stdio.printf "%d ");
+  Stdio.printf "\n";
+  Array.iter s ~f:(Stdio.printf "%s ");
+  Stdio.printf "\n";
+  [%expect {|
+    0 1 2 3 10 11 12 13
+    s0-0 s0-1 s0-2 s0-3 s1-0 s1-1 s1-2 s1-3 |}]
+
+let%expect_test _ =
+  let ints = Wrapper.Int64Builder.create () in
+  let floats = Wrapper.DoubleBuilder.create () in
+  let strings = Wrapper.StringBuilder.create () in
+  for i = 0 to 4 do
+    Wrapper.Int64Builder.append ints (Int64.of_int (i * i));
+    if i % 2 = 0
+    then Wrapper.DoubleBuilder.append floats (Float.of_int i /. 4.)
+    else Wrapper.DoubleBuilder.append_null floats;
+    Wrapper.StringBuilder.append strings (Printf.sprintf "s%d\000%d" i i)
+  done;
+  Stdio.printf
+    "%Ld %Ld %Ld %Ld\n"
+    (Wrapper.Int64Builder.length ints)
+    (Wrapper.DoubleBuilder.length floats)
+    (Wrapper.DoubleBuilder.null_count floats)
+    (Wrapper.StringBuilder.null_count strings);
+  [%expect {| 5 5 2 0 |}];
+  let table =
+    Wrapper.Builder.make_table
+      [ "i", Wrapper.Builder.Int64 ints
+      ; "f", Wrapper.Builder.Double floats
+      ; "s", Wrapper.Builder.String strings
+      ]
+  in
+  Stdio.printf "%d\n" (Wrapper.Table.num_rows table);
+  let i = Wrapper.Column.read_int table ~column:(`Name "i") in
+  let f = Wrapper.Column.read_float_opt table ~column:(`Name "f") in
+  let s = Wrapper.Column.read_utf8 table ~column:(`Name "s") in
+  Array.iteri i ~f:(fun idx i ->
+      Stdio.printf
+        "%d %s %S\n"
+        i
+        (Option.value_map f.(idx) ~f:Float.to_string ~default:"none")
+        s.(idx));
+  [%expect
+    {|
+    5
+    0 0. "s0\0000"
+    1 none "s1\0001"
+    4 0.5 "s2\0002"
+    9 none "s3\0003"
+    16 1. "s4\0004" |}]
@@ -0,0 +1,59 @@
+open Core_kernel
+open Arrow_c_api
+
+let table () =
+  Table.create
+    [ Table.col [| 1; 2; 3 |] Int ~name:"x"
+    ; Table.col [| 0.1; 1.5; -2. |] Float ~name:"y"
+    ; Table.col_opt [| Some "a,b"; None; Some "say \"hi\"" |] Utf8 ~name:"z"
+    ; Table.col
+        [| Date.of_string "2021-01-02"; Date.of_string "1969-12-31"; Date.unix_epoch |]
+        Date
+        ~name:"d"
+    ]
+
+let print_file ~suffix ~f =
+  let filename = Caml.Filename.temp_file "test" suffix in
+  Exn.protect
+    ~f:(fun () ->
+      f filename;
+      In_channel.read_all filename |> Stdio.print_string)
+    ~finally:(fun () -> Caml.Sys.remove filename)
+
+let%expect_test _ =
+  print_file ~suffix:".csv" ~f:(Table.write_csv (table ()));
+  [%expect
+    {|
+    x,y,z,d
+    1,0.1,"a,b",2021-01-02
+    2,1.5,,1969-12-31
+    3,-2,"say ""hi""",1970-01-01 |}];
+  print_file
+    ~suffix:".csv"
+    ~f:(Table.write_csv (table ()) ~header:false ~delimiter:'|' ~null:"NA");
+  [%expect
+    {|
+    1|0.1|a,b|2021-01-02
+    2|1.5|NA|1969-12-31
+    3|-2|"say ""hi"""|1970-01-01 |}];
+  print_file ~suffix:".json" ~f:(Table.write_ndjson (table ()));
+  [%expect
+    {|
+    {"x":1,"y":0.1,"z":"a,b","d":"2021-01-02"}
+    {"x":2,"y":1.5,"z":null,"d":"1969-12-31"}
+    {"x":3,"y":-2,"z":"say \"hi\"","d":"1970-01-01"} |}]
+
+let%expect_test _ =
+  let src = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Table.write_parquet (table ()) src;
+      print_file ~suffix:".csv" ~f:(fun dst ->
+          let writer = Text_writer.create_csv dst ~quoting:`all_strings in
+          Parquet_reader.write_text src ~batch_size:2 ~column_idxs:[ 0; 2 ] ~writer))
+    ~finally:(fun () -> Caml.Sys.remove src);
+  [%expect {|
+    "x","z"
+    1,"a,b"
+    2,
+    3,"say ""hi""" |}]
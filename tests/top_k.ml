@@ -0,0 +1,89 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col [| "a"; "b"; "a"; "b"; "a"; "c"; "a" |] Utf8 ~name:"sym"
+      ; Table.col_opt
+          [| Some 10.; Some 5.; None; Some 7.; Some 12.; Some 1.; Some 10. |]
+          Float
+          ~name:"size"
+      ; Table.col [| 0; 1; 2; 3; 4; 5; 6 |] Int ~name:"seq"
+      ]
+  in
+  let print table =
+    let sym = Table.read table Utf8 ~column:(`Name "sym") in
+    let seq = Table.read table Int ~column:(`Name "seq") in
+    Array.iteri sym ~f:(fun i sym -> Stdio.printf "%s %d\n" sym seq.(i))
+  in
+  print (Table.top_k table ~by:(`Name "size") ~k:3);
+  [%expect {|
+    a 4
+    a 0
+    a 6 |}];
+  print (Table.top_k table ~by:(`Name "seq") ~k:2 ~smallest:true);
+  [%expect {|
+    a 0
+    b 1 |}];
+  print (Table.top_k_by_group table ~by:(`Name "size") ~group_by:[ `Name "sym" ] ~k:2);
+  [%expect {|
+    a 4
+    a 0
+    b 3
+    b 1
+    c 5 |}];
+  let num_rows = 1_000_000 in
+  let values = Array.init num_rows ~f:(fun i -> i * 7919 % num_rows) in
+  let table =
+    Table.create
+      [ Table.col values Int ~name:"x"
+      ; Table.col (Array.init num_rows ~f:(fun i -> i % 10)) Int ~name:"g"
+      ]
+  in
+  let table =
+    Table.concatenate
+      [ Table.slice table ~offset:0 ~length:300_000
+      ; Table.slice table ~offset:300_000 ~length:700_000
+      ]
+  in
+  let top = Table.top_k table ~by:(`Name "x") ~k:5 in
+  Table.read top Int ~column:(`Name "x")
+  |> [%sexp_of: int array]
+  |> Sexp.to_string
+  |> Stdio.print_endline;
+  [%expect {| (999999 999998 999997 999996 999995) |}];
+  let top = Table.top_k_by_group table ~by:(`Name "x") ~group_by:[ `Name "g" ] ~k:2 in
+  Table.read top Int ~column:(`Name "g")
+  |> [%sexp_of: int array]
+  |> Sexp.to_string
+  |> Stdio.print_endline;
+  [%expect {| (0 0 1 1 2 2 3 3 4 4 5 5 6 6 7 7 8 8 9 9) |}]
+
+(* uint64 values above the int64 range rank above the smaller ones. *)
+let%expect_test _ =
+  let src = Caml.Filename.temp_file "test" ".csv" in
+  let dst = Caml.Filename.temp_file "test" ".parquet" in
+  Exn.protect
+    ~f:(fun () ->
+      Out_channel.write_lines
+        src
+        [ "v,x"; "1,0"; "9223372036854775813,1"; "3,2"; "18446744073709551615,3" ];
+      let (_ : Convert.stats) =
+        Convert.csv_to_parquet ~schema:[ "v", Uint64; "x", Int64 ] ~src ~dst ()
+      in
+      let table = Parquet_reader.table dst in
+      let print table =
+        Table.read table Int ~column:(`Name "x")
+        |> [%sexp_of: int array]
+        |> Sexp.to_string
+        |> Stdio.print_endline
+      in
+      print (Table.top_k table ~by:(`Name "v") ~k:2);
+      print (Table.top_k table ~by:(`Name "v") ~k:2 ~smallest:true))
+    ~finally:(fun () ->
+      Caml.Sys.remove src;
+      Caml.Sys.remove dst);
+  [%expect {|
+    (3 1)
+    (0 2) |}]
@@ -0,0 +1,47 @@
+open Core_kernel
+open Arrow_c_api
+
+let%expect_test _ =
+  let table =
+    Table.create
+      [ Table.col_opt
+          [| Some "apple"; None; Some "banana"; Some "apricot"; Some "été"; Some "" |]
+          Utf8
+          ~name:"s"
+      ; Table.col (Array.init 6 ~f:Fn.id) Int ~name:"x"
+      ]
+  in
+  (* Multiple chunks, the second one starting in the middle of a byte. *)
+  let table = Table.concatenate [ table; Table.slice table ~offset:1 ~length:5 ] in
+  let column = `Name "s" in
+  let print valid =
+    List.init (Valid.length valid) ~f:(fun i -> if Valid.get valid i then '1' else '0')
+    |> String.of_char_list
+    |> print_endline
+  in
+  print (Column.utf8_equal table ~column ~value:"banana");
+  print (Column.utf8_starts_with table ~column ~prefix:"ap");
+  print (Column.utf8_ends_with table ~column ~suffix:"a");
+  print (Column.utf8_contains table ~column ~substring:"an");
+  print (Column.utf8_contains table ~column ~substring:"");
+  print (Column.utf8_match_regex table ~column ~regex:"^a.*[et]$");
+  print (Column.utf8_in_set table ~column ~values:[ "apple"; "été"; "kiwi" ]);
+  print (Column.utf8_in_set table ~column ~values:[]);
+  Column.utf8_length table ~column
+  |> Bigarray.Array1.to_array
+  |> [%sexp_of: int32 array]
+  |> print_s;
+  let filtered = Table.filter table (Column.utf8_starts_with table ~column ~prefix:"ap") in
+  Table.read filtered Int ~column:(`Name "x") |> [%sexp_of: int array] |> print_s;
+  [%expect
+    {|
+    00100001000
+    10010000100
+    00100001000
+    00100001000
+    10111101111
+    10010000100
+    10001000010
+    00000000000
+    (5 0 6 7 3 0 0 6 7 3 0)
+    (0 3 3) |}]